@@ -288,6 +288,24 @@ project "filter"
 
 -- ==============================================================================
 
+project "query"
+
+    ConfigureApp("query")
+
+-- ==============================================================================
+
+project "diff"
+
+    ConfigureApp("diff")
+
+-- ==============================================================================
+
+project "inspect"
+
+    ConfigureApp("inspect")
+
+-- ==============================================================================
+
 project "viewer"
 
     ConfigureApp("viewer")
@@ -12,6 +12,9 @@
 #include "common/OpFoundation.h"
 #include "common/OpEventUnpacker.h"
 
+#include <fcntl.h>
+#include <io.h>
+
 #include "PsFileBuffer.h"
 #include "PsSocket.h"
 
@@ -26,7 +29,7 @@ namespace cmdline
     {
         CLI::App app{ "opvd-capture" };
 
-        app.add_option( "-o,--out",     cmdline::PxDOutput,     "filename to write captured data to" );
+        app.add_option( "-o,--out",     cmdline::PxDOutput,     "filename to write captured data to, or - for stdout" );
         app.add_option( "-p,--port",    PvPort,                 "port to listen on" );
         app.add_option( "-b,--buf",     BufferSizeKb,           "transmission buffer, in KB" );
 
@@ -85,24 +88,90 @@ struct MemoryReader
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
-int main( int argc, char** argv )
+// captured data goes either to a PXD2 file or, given "-", straight to stdout so that it can be piped into opvd-filter
+// without the unfiltered stream ever landing on disk
+struct CaptureOutput
 {
-    spdlog::set_pattern( "[%^%L%$] %v" );
+    static constexpr std::size_t cPipeBufferSize = 4 * 1024 * 1024;
+
+    CaptureOutput( const std::string& filename )
+    {
+        if ( filename == "-" )
+        {
+            _setmode( _fileno( stdout ), _O_BINARY );
+            setvbuf( stdout, nullptr, _IOFBF, cPipeBufferSize );
+        }
+        else
+        {
+            m_file = std::make_unique< physx::PsFileBuffer >( filename.c_str(), physx::general_PxIOStream2::PxFileBuf::OPEN_WRITE_ONLY );
+        }
+    }
+
+    bool isOpen() const
+    {
+        return m_file == nullptr || m_file->getOpenMode() != physx::general_PxIOStream2::PxFileBuf::OPEN_FILE_NOT_FOUND;
+    }
+
+    // returns false if the data could not all be written out; a full disk or a closed pipe leaves the capture
+    // incomplete, so there is no point carrying on
+    bool write( const uint8_t* data, const uint32_t size )
+    {
+        if ( m_file != nullptr )
+            return m_file->write( data, size ) == size;
+
+        return fwrite( data, 1, size, stdout ) == size;
+    }
+
+    // push out anything still buffered; for stdout this is where a closed pipe shows up
+    bool flush()
+    {
+        if ( m_file != nullptr )
+        {
+            m_file->flush();
+            return true;
+        }
+        return fflush( stdout ) == 0;
+    }
 
+    std::unique_ptr< physx::PsFileBuffer >  m_file;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
     if ( int cmdr = cmdline::parse( argc, argv ) )
         return cmdr;
 
+    // stdout may be carrying the capture itself, so keep all logging on stderr in that case
+    if ( cmdline::PxDOutput == "-" )
+        spdlog::set_default_logger( spdlog::stderr_color_mt( "stderr" ) );
+
+    spdlog::set_pattern( "[%^%L%$] %v" );
+
     Op::Foundation opFoundation;
     {
         spdlog::info( "Waiting for PVD connection from client ..." );
 
         physx::shdfnd::Socket mSocket;
-        mSocket.listen( cmdline::PvPort );
-        mSocket.accept( true );
+        if ( !mSocket.listen( cmdline::PvPort ) )
+        {
+            spdlog::error( "unable to listen on port {} (socket error {})", cmdline::PvPort, WSAGetLastError() );
+            return 1;
+        }
+        if ( !mSocket.accept( true ) )
+        {
+            spdlog::error( "failed accepting a connection on port {} (socket error {})", cmdline::PvPort, WSAGetLastError() );
+            return 1;
+        }
 
         spdlog::info( "Connection established, streaming data to [{}] ...", cmdline::PxDOutput );
 
-        auto PxDFileOut = physx::PsFileBuffer( cmdline::PxDOutput.c_str(), physx::general_PxIOStream2::PxFileBuf::OPEN_WRITE_ONLY );
+        CaptureOutput PxDFileOut( cmdline::PxDOutput );
+        if ( !PxDFileOut.isOpen() )
+        {
+            spdlog::error( "unable to open [{}] for writing", cmdline::PxDOutput );
+            return 1;
+        }
 
         const uint32_t recvBufferSize = cmdline::BufferSizeKb * 1024;
         uint8_t* recvBuffer = (uint8_t*)_aligned_malloc( recvBufferSize, 16 );
@@ -113,6 +182,7 @@ int main( int argc, char** argv )
         uint32_t eventLargestData = 0;
         ProcessingState processingState = ProcessingState::WaitingOnInit;
 
+        bool bWriteFailed   = false;
         bool bStreamingData = true;
         while ( bStreamingData )
         {
@@ -208,8 +278,12 @@ int main( int argc, char** argv )
 
                 // write out what we got to the PXD file
                 const auto bytesToWrite = bytesRead - recvBufferOffset;
-                if ( bytesToWrite > 0 )
-                    PxDFileOut.write( recvBuffer, bytesToWrite );
+                if ( bytesToWrite > 0 && !PxDFileOut.write( recvBuffer, bytesToWrite ) )
+                {
+                    spdlog::error( "failed writing captured data to [{}]", cmdline::PxDOutput );
+                    bWriteFailed = true;
+                    break;
+                }
 
                 // move the remaining bytes to the front of the buffer
                 memcpy( offloadBuffer, &recvBuffer[bytesToWrite], recvBufferOffset );
@@ -219,6 +293,17 @@ int main( int argc, char** argv )
         _aligned_free( offloadBuffer );
         _aligned_free( recvBuffer );
 
+        if ( !bWriteFailed && !PxDFileOut.flush() )
+        {
+            spdlog::error( "failed writing captured data to [{}]", cmdline::PxDOutput );
+            bWriteFailed = true;
+        }
+
         spdlog::info( "Closing ..." );
+
+        if ( bWriteFailed )
+            return 1;
     }
+
+    return 0;
 }
@@ -0,0 +1,49 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// diff tool compares two PXD2 captures of the same simulation, finding the first frame where the physics state
+// diverges and showing which instances and properties differ; exits with 0 if they match, 2 if they don't
+//
+
+#include "pch.h"
+#include "common/OpFoundation.h"
+
+#include "diff/CaptureDiff.h"
+
+// ---------------------------------------------------------------------------------------------------------------------
+namespace cmdline
+{
+    static std::string PxDInputA;
+    static std::string PxDInputB;
+    static uint32_t MaxReported     = 20;
+
+    int parse( int argc, char** argv )
+    {
+        CLI::App app{ "opvd-diff" };
+
+        app.add_option( "a", PxDInputA, "first PXD2 capture" )->required()->check( CLI::ExistingFile );
+        app.add_option( "b", PxDInputB, "second PXD2 capture" )->required()->check( CLI::ExistingFile );
+        app.add_option( "-n,--max-instances", MaxReported, "most differing instances to show" );
+
+        CLI11_PARSE( app, argc, argv );
+
+        return 0;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+    spdlog::set_pattern( "[%^%L%$] %v" );
+
+    if ( int cmdr = cmdline::parse( argc, argv ) )
+        return cmdr;
+
+    Op::Foundation opFoundation;
+
+    return runCaptureDiff( cmdline::PxDInputA, cmdline::PxDInputB, cmdline::MaxReported );
+}
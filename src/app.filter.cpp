@@ -9,13 +9,31 @@
 //
 
 #include "pch.h"
+
+#include <fcntl.h>
+#include <io.h>
+
 #include "common/OpFoundation.h"
+#include "common/OpBlockReader.h"
 #include "common/OpEventBreaker.h"
-#include "common/OpEventUnpacker.h"
+#include "common/OpEventDecoder.h"
+#include "common/OpEventWriter.h"
+#include "common/OpStatePrelude.h"
+#include "common/OpFrameDecimator.h"
+#include "common/OpPropertyIndex.h"
+#include "common/OpFrameStatistics.h"
+#include "common/OpLifetimeReport.h"
+#include "common/OpPayloadReport.h"
+#include "common/OpProfileTrace.h"
+#include "common/OpStreamResync.h"
+
+#include "filter/DecodeBenchmark.h"
+#include "filter/DefinitionPruner.h"
 
 #include "PxPvdCommStreamEvents.h"
 #include "PxPvdDefaultFileTransport.h"
 #include "PxPvdDefaultSocketTransport.h"
+#include "PsSocket.h"
 
 // ---------------------------------------------------------------------------------------------------------------------
 namespace cmdline
@@ -31,8 +49,36 @@ namespace cmdline
     static std::string PxDOutput    = "testdata/filtered.pxd2";
     static std::string PxDAddress   = "127.0.0.1";
     static uint16_t PvPort          = 5425;
+    static uint16_t ListenPort      = 0;
 
     static int32_t TriMeshLimit     = -1;
+    static uint32_t MeshTriangles   = 0;
+    static std::vector< std::string > SizeBudgets;
+    static bool DedupeGeometry      = false;
+    static bool PruneDefinitions    = false;
+    static bool DenseHandles        = false;
+    static std::vector< std::string > CascadeClasses;
+    static std::vector< std::string > StripProperties;
+    static std::vector< std::string > StubProperties;
+
+    static uint64_t FromFrame       = 0;
+    static uint64_t ToFrame         = 0;
+    static uint32_t DecimateFrames  = 0;
+    static bool DropUnchanged       = false;
+    static std::string RegionAABB;
+
+    static bool BuildIndex          = false;
+    static std::string FrameStatsOutput;
+    static bool ReportLifetimes     = false;
+    static std::string LifetimesOutput;
+    static std::string ChromeTraceOutput;
+    static bool ReportTopPayloads       = false;
+    static uint32_t TopPayloads         = 20;
+    static std::string FoldedOutput;
+    static uint32_t FoldedBucketFrames  = 100;
+    static bool Resync                  = false;
+
+    static uint32_t BenchmarkRounds = 0;
 
     static OutputMode AppOutputMode = OutputMode::None;
 
@@ -40,8 +86,33 @@ namespace cmdline
     {
         CLI::App app{ "OpenPVD" };
 
-        app.add_option( "-p,--pxd", PxDInput, "path to a PXD2 capture file to parse" )->check( CLI::ExistingFile );
+        auto* optInput  = app.add_option( "-p,--pxd", PxDInput, "path to a PXD2 capture file to parse, or - for stdin" )->check( CLI::ExistingFile | CLI::IsMember( { "-" } ) );
+        auto* optListen = app.add_option( "-l,--listen", ListenPort, "act as a PVD server on this port and filter the live stream" );
+        optListen->excludes( optInput );
         app.add_option( "--meshlimit", TriMeshLimit, "limit of trimesh instances to allow")->check( CLI::PositiveNumber );
+        app.add_option( "--budget", SizeBudgets, "Class=SIZE pairs (eg. PxTriangleMesh=500MB) capping the property payload kept per class, dropping the largest instances first" );
+        app.add_flag( "--dedupe", DedupeGeometry, "fold mesh / heightfield instances with identical contents into one, redirecting references to it" );
+        app.add_option( "--simplify-meshes", MeshTriangles, "rebuild triangle meshes with more than this many triangles at a lower density" )->check( CLI::PositiveNumber );
+        app.add_option( "--strip", StripProperties, "Class.Property pairs whose updates are removed from the output, keeping the instance" );
+        app.add_option( "--stub", StubProperties, "Class.Property pairs whose updates are kept with an empty payload" );
+        app.add_option( "--cascade", CascadeClasses, "class names (eg. PxShape) whose instances are dropped when something they reference as a property value, everything they reference, or everything referencing them, has been filtered" );
+        auto* optFrom = app.add_option( "--from-frame", FromFrame, "first frame to keep; the state of the scene going into it is rebuilt in a prelude" );
+        auto* optTo   = app.add_option( "--to-frame", ToFrame, "last frame to keep, stops reading the input once it is passed" );
+        app.add_option( "--decimate", DecimateFrames, "only keep every Nth frame, coalescing property updates from the frames in between" )->check( CLI::PositiveNumber );
+        app.add_option( "--aabb", RegionAABB, "minx,miny,minz,maxx,maxy,maxz - only keep actors whose position is inside this box" );
+        app.add_flag( "--drop-unchanged", DropUnchanged, "drop property updates whose payload is identical to the previous one" );
+        auto* optPrune = app.add_flag( "--prune", PruneDefinitions, "make a second pass over the written file, removing string handles and class definitions nothing uses any more" );
+        app.add_flag( "--dense-handles", DenseHandles, "when pruning, also renumber the remaining string handles into a dense range" )->needs( optPrune );
+        app.add_flag( "--index", BuildIndex, "write a property change index next to the input file, for looking up values at any frame" );
+        app.add_option( "--frame-stats", FrameStatsOutput, "write per-frame event, byte and instance counts of the input to this CSV file" );
+        app.add_flag( "--lifetimes", ReportLifetimes, "report instance creation / destruction churn per class, and what is still alive at the end" );
+        app.add_option( "--survivors", LifetimesOutput, "write the instances alive at the end of the stream to this CSV file, by class and creation frame" );
+        app.add_option( "--chrome-trace", ChromeTraceOutput, "export PhysX profile zone timings to this Chrome trace JSON file, for chrome://tracing or Perfetto" );
+        auto* optTop = app.add_option( "--top", TopPayloads, "report the N largest property payload events, and the N classes / properties contributing the most bytes; also the length of the report that goes with --folded" )->check( CLI::PositiveNumber )->capture_default_str();
+        app.add_option( "--folded", FoldedOutput, "write payload bytes as folded stacks (class;property;frames bytes) to this file, for flamegraph tools" );
+        app.add_option( "--folded-bucket", FoldedBucketFrames, "number of frames grouped into each bucket of the folded stacks" )->check( CLI::PositiveNumber )->capture_default_str();
+        app.add_flag( "--resync", Resync, "on a corrupt or unknown event, skip forward to the next plausible event group rather than stopping" );
+        app.add_option( "--benchmark", BenchmarkRounds, "compare decoder throughput over N rounds, then exit" );
 
         // optional output mode selection
         CLI::App* outToFile = app.add_subcommand( "to_file", "" );
@@ -55,13 +126,36 @@ namespace cmdline
 
         CLI11_PARSE( app, argc, argv );
 
+        ReportTopPayloads = ( optTop->count() > 0 );
+
+        if ( *optFrom && *optTo && ToFrame < FromFrame )
+        {
+            spdlog::error( "--to-frame ({}) must not be before --from-frame ({})", ToFrame, FromFrame );
+            return 1;
+        }
+
         if ( *outToFile )
             AppOutputMode = OutputMode::File;
+        if ( PruneDefinitions && AppOutputMode != OutputMode::File )
+        {
+            spdlog::error( "--prune rewrites the output file, so needs to_file" );
+            return 1;
+        }
         if ( *outToNet )
             AppOutputMode = OutputMode::Network;
 
         return 0;
     }
+
+    inline bool inputIsStdin()
+    {
+        return PxDInput == "-";
+    }
+
+    inline bool inputIsSocket()
+    {
+        return ListenPort != 0;
+    }
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -92,18 +186,61 @@ int main( int argc, char** argv )
     if ( int cmdr = cmdline::parse( argc, argv ) )
         return cmdr;
 
-    if ( !fs::exists( cmdline::PxDInput ) )
+    if ( !cmdline::inputIsStdin() && !cmdline::inputIsSocket() && !fs::exists( cmdline::PxDInput ) )
     {
         spdlog::error( "Cannot find PXD file [{}]", cmdline::PxDInput );
         exit( 1 );
     }
 
     Op::Foundation opFoundation;
+
+    if ( cmdline::BenchmarkRounds > 0 )
     {
-        spdlog::info( "Loading : {}", cmdline::PxDInput );
-        auto PxDFile = physx::PsFileBuffer( cmdline::PxDInput.c_str(), physx::general_PxIOStream2::PxFileBuf::OPEN_READ_ONLY );
+        if ( cmdline::inputIsStdin() || cmdline::inputIsSocket() )
+        {
+            spdlog::error( "benchmarking requires a capture file" );
+            return 1;
+        }
+        return runDecodeBenchmark( cmdline::PxDInput, cmdline::BenchmarkRounds );
+    }
+
+    {
+        physx::shdfnd::Socket pxdSocket;
+
+        std::unique_ptr< Op::BlockSource > pxdSource;
+        if ( cmdline::inputIsSocket() )
+        {
+            spdlog::info( "Waiting for PVD connection from client on port {} ...", cmdline::ListenPort );
+
+            if ( !pxdSocket.listen( cmdline::ListenPort ) )
+            {
+                spdlog::error( "unable to listen on port {} (socket error {})", cmdline::ListenPort, WSAGetLastError() );
+                return 1;
+            }
+            if ( !pxdSocket.accept( true ) )
+            {
+                spdlog::error( "failed accepting a connection on port {} (socket error {})", cmdline::ListenPort, WSAGetLastError() );
+                return 1;
+            }
+
+            spdlog::info( "Connection established, filtering live stream" );
+            pxdSource = std::make_unique< Op::SocketBlockSource >( pxdSocket );
+        }
+        else if ( cmdline::inputIsStdin() )
+        {
+            spdlog::info( "Loading : <stdin>" );
 
-        auto eventUnpacker = Op::EventUnpacker< physx::PsFileBuffer >( PxDFile );
+            _setmode( _fileno( stdin ), _O_BINARY );
+            pxdSource = std::make_unique< Op::PipeBlockSource >( _fileno( stdin ) );
+        }
+        else
+        {
+            spdlog::info( "Loading : {}", cmdline::PxDInput );
+            pxdSource = Op::FileBlockSource::open( cmdline::PxDInput );
+        }
+        Op::BlockReader pxdReader( std::move( pxdSource ) );
+
+        auto eventDecoder = Op::EventDecoder< Op::BlockReader >( pxdReader );
 
         Op::EventBreaker eventBreaker;
 
@@ -111,13 +248,18 @@ int main( int argc, char** argv )
         physx::PxPvdTransport* outboundTransport = &NullTransport::Instance;
         bool bSerialize = false;
 
+        // when pruning, the filtered stream is written to an intermediate file first, then pruned into the real output
+        std::string filteredOutput = cmdline::PxDOutput;
+        if ( cmdline::PruneDefinitions )
+            filteredOutput += ".unpruned";
+
         if ( cmdline::AppOutputMode == cmdline::OutputMode::File )
         {
             if ( !cmdline::PxDOutput.empty() )
             {
-                spdlog::info( "Writing to file : {}", cmdline::PxDOutput );
+                spdlog::info( "Writing to file : {}", filteredOutput );
 
-                outboundTransport = physx::PxDefaultPvdFileTransportCreate( cmdline::PxDOutput.c_str() );
+                outboundTransport = physx::PxDefaultPvdFileTransportCreate( filteredOutput.c_str() );
                 bSerialize = true;
             }
         }
@@ -134,7 +276,7 @@ int main( int argc, char** argv )
 
         // read the stream input block
         physx::pvdsdk::StreamInitialization init;
-        init.serialize( eventUnpacker );
+        eventDecoder.decode( init );
 
         // check the id/version is what we expect
         if ( init.mStreamId != physx::pvdsdk::StreamInitialization::getStreamId() )
@@ -158,8 +300,14 @@ int main( int argc, char** argv )
             outboundTransport->unlock();
         }
 
-        // create the data dump log file next to the input file
-        auto pxdLogFile = fs::path( cmdline::PxDInput ).replace_extension( ".stream.log" );
+        // create the data dump log file next to the input file (or in the working directory, when reading stdin / live)
+        std::string pxdLogName = cmdline::PxDInput;
+        if ( cmdline::inputIsSocket() )
+            pxdLogName = "live";
+        else if ( cmdline::inputIsStdin() )
+            pxdLogName = "stdin";
+
+        auto pxdLogFile = fs::path( pxdLogName ).replace_extension( ".stream.log" );
         eventBreaker.m_verboseLog = spdlog::basic_logger_mt( "stream_logger", pxdLogFile.string(), true );
 
         // setup any filtering required
@@ -169,38 +317,355 @@ int main( int argc, char** argv )
             spdlog::info( "Limiting [PxTriangleMesh] instances to {}", cmdline::TriMeshLimit );
             opFilterState.m_instanceLimits["PxTriangleMesh"] = cmdline::TriMeshLimit;
         }
+        if ( !cmdline::SizeBudgets.empty() )
+        {
+            if ( cmdline::inputIsStdin() || cmdline::inputIsSocket() )
+            {
+                spdlog::error( "--budget needs to scan the input ahead of filtering, so requires a capture file" );
+                return 1;
+            }
+
+            opFilterState.m_sizeBudget = std::make_unique< Op::SizeBudget >();
+            for ( const auto& budgetRule : cmdline::SizeBudgets )
+            {
+                std::string budgetClass;
+                uint64_t budgetBytes = 0;
+                if ( !Op::SizeBudget::parse( budgetRule, budgetClass, budgetBytes ) )
+                {
+                    spdlog::error( "invalid --budget [{}], expected Class=SIZE", budgetRule );
+                    return 1;
+                }
+                spdlog::info( "Budgeting [{}] to {} bytes", budgetClass, budgetBytes );
+                opFilterState.m_sizeBudget->addBudget( budgetClass, budgetBytes );
+            }
+
+            spdlog::info( "Scanning {} for instance sizes ...", cmdline::PxDInput );
+            if ( !opFilterState.m_sizeBudget->scan( cmdline::PxDInput, cmdline::FromFrame, cmdline::ToFrame, cmdline::Resync ) )
+            {
+                spdlog::error( "unable to scan {} for --budget", cmdline::PxDInput );
+                return 1;
+            }
+        }
+        if ( cmdline::DedupeGeometry )
+        {
+            spdlog::info( "Deduplicating identical mesh and heightfield instances" );
+            opFilterState.m_deduplicator = std::make_unique< Op::PayloadDeduplicator >();
+        }
+        if ( cmdline::MeshTriangles > 0 )
+        {
+            opFilterState.m_meshSimplifier = std::make_unique< Op::MeshSimplifier >( cmdline::MeshTriangles );
+            spdlog::info( "Simplifying [PxTriangleMesh] instances to at most {} triangles, on {} worker threads", cmdline::MeshTriangles, opFilterState.m_meshSimplifier->workerCount() );
+        }
+        for ( const auto& stripRule : cmdline::StripProperties )
+        {
+            if ( !opFilterState.m_propertyRules.addRule( stripRule, Op::PropertyAction::Strip ) )
+            {
+                spdlog::error( "invalid --strip rule [{}], expected Class.Property", stripRule );
+                return 1;
+            }
+            spdlog::info( "Stripping [{}] updates", stripRule );
+        }
+        for ( const auto& stubRule : cmdline::StubProperties )
+        {
+            if ( !opFilterState.m_propertyRules.addRule( stubRule, Op::PropertyAction::Stub ) )
+            {
+                spdlog::error( "invalid --stub rule [{}], expected Class.Property", stubRule );
+                return 1;
+            }
+            spdlog::info( "Stubbing [{}] updates", stubRule );
+        }
+        if ( cmdline::DropUnchanged )
+        {
+            spdlog::info( "Dropping unchanged property updates" );
+            opFilterState.m_updateSuppressor = std::make_unique< Op::UpdateSuppressor >();
+        }
+        if ( !cmdline::RegionAABB.empty() )
+        {
+            Op::RegionBounds regionBounds;
+            if ( !Op::RegionBounds::parse( cmdline::RegionAABB, regionBounds ) )
+            {
+                spdlog::error( "invalid --aabb [{}], expected minx,miny,minz,maxx,maxy,maxz", cmdline::RegionAABB );
+                return 1;
+            }
+            spdlog::info( "Keeping actors inside {{ {}, {}, {} }} - {{ {}, {}, {} }}",
+                regionBounds.m_min[0], regionBounds.m_min[1], regionBounds.m_min[2],
+                regionBounds.m_max[0], regionBounds.m_max[1], regionBounds.m_max[2] );
+
+            opFilterState.m_regionFilter = std::make_unique< Op::RegionFilter >( regionBounds );
+
+            // dropped actors should take their shapes with them
+            if ( cmdline::CascadeClasses.empty() )
+                cmdline::CascadeClasses.emplace_back( "PxShape" );
+        }
+        for ( const auto& cascadeClass : cmdline::CascadeClasses )
+        {
+            spdlog::info( "Cascading filtering into [{}] instances", cascadeClass );
+            opFilterState.m_cascadeClasses.emplace( cascadeClass );
+        }
+
+        // the index describes the input, so it sees every event ahead of any filtering
+        std::unique_ptr< Op::PropertyIndexBuilder > propertyIndex;
+        if ( cmdline::BuildIndex )
+        {
+            if ( cmdline::inputIsStdin() || cmdline::inputIsSocket() )
+            {
+                spdlog::error( "--index is written next to the capture, so requires a capture file" );
+                return 1;
+            }
+
+            const std::string indexFilename = Op::PropertyIndexBuilder::indexPathFor( cmdline::PxDInput );
+            spdlog::info( "Writing property index : {}", indexFilename );
+
+            propertyIndex = std::make_unique< Op::PropertyIndexBuilder >();
+            if ( !propertyIndex->open( indexFilename ) )
+                return 1;
+        }
+
+        std::unique_ptr< Op::FrameStatistics > frameStatistics;
+        if ( !cmdline::FrameStatsOutput.empty() )
+        {
+            spdlog::info( "Writing frame statistics : {}", cmdline::FrameStatsOutput );
+
+            frameStatistics = std::make_unique< Op::FrameStatistics >();
+            if ( !frameStatistics->open( cmdline::FrameStatsOutput ) )
+                return 1;
+        }
+
+        std::unique_ptr< Op::LifetimeReport > lifetimeReport;
+        if ( cmdline::ReportLifetimes || !cmdline::LifetimesOutput.empty() )
+        {
+            lifetimeReport = std::make_unique< Op::LifetimeReport >();
+        }
+
+        std::unique_ptr< Op::PayloadReport > payloadReport;
+        if ( cmdline::ReportTopPayloads || !cmdline::FoldedOutput.empty() )
+        {
+            payloadReport = std::make_unique< Op::PayloadReport >( cmdline::TopPayloads );
+            if ( !cmdline::FoldedOutput.empty() )
+            {
+                spdlog::info( "Writing folded payload stacks : {}", cmdline::FoldedOutput );
+                if ( !payloadReport->openFolded( cmdline::FoldedOutput, cmdline::FoldedBucketFrames ) )
+                    return 1;
+            }
+        }
+
+        std::unique_ptr< Op::ProfileTraceExporter > profileTrace;
+        if ( !cmdline::ChromeTraceOutput.empty() )
+        {
+            spdlog::info( "Writing profile trace : {}", cmdline::ChromeTraceOutput );
+
+            profileTrace = std::make_unique< Op::ProfileTraceExporter >();
+            if ( !profileTrace->open( cmdline::ChromeTraceOutput ) )
+                return 1;
+        }
+
+        // analysis of the input sees every event, ahead of any filtering; it runs once the event breaker has taken the
+        // event in, so string handles and frame sections are already accounted for in its string table and frame count
+        const auto observeEvent = [&]( const auto& _event )
+        {
+            if ( propertyIndex )
+                propertyIndex->record( eventBreaker, eventBreaker.m_currentFrame, _event );
+            if ( frameStatistics )
+                frameStatistics->record( eventBreaker, eventBreaker.m_currentFrame, _event );
+            if ( lifetimeReport )
+                lifetimeReport->record( eventBreaker, eventBreaker.m_currentFrame, _event );
+            if ( payloadReport )
+                payloadReport->record( eventBreaker, eventBreaker.m_currentFrame, _event );
+            if ( profileTrace )
+                profileTrace->record( _event );
+        };
 
         uint32_t numEventsProcessed = 0;
-        physx::pvdsdk::EventStreamifier<physx::PxPvdTransport> streamOut( outboundTransport->lock() );
-        for ( ;; )
+        Op::EventWriter eventWriter( outboundTransport->lock() );
+
+        // when cutting out a frame window, everything ahead of it is folded down into a state prelude rather than written
+        Op::StatePrelude statePrelude;
+        bool bRecordingPrelude = ( cmdline::FromFrame > 1 );
+        bool bWindowComplete = false;
+
+        if ( cmdline::FromFrame > 0 || cmdline::ToFrame > 0 )
         {
+            spdlog::info( "Keeping frames {} to {}", std::max( cmdline::FromFrame, uint64_t( 1 ) ), ( cmdline::ToFrame > 0 ) ? fmt::format( "{}", cmdline::ToFrame ) : "end" );
+        }
+
+        Op::FrameDecimator frameDecimator( cmdline::DecimateFrames );
+        if ( frameDecimator.enabled() )
+        {
+            spdlog::info( "Decimating to every {} frames", cmdline::DecimateFrames );
+        }
+
+        // called after each event has been seen by the event breaker, which tracks the current frame
+        const auto updateFrameWindow = [&]( const physx::pvdsdk::EventGroup& _group )
+        {
+            if ( bRecordingPrelude && eventBreaker.m_currentFrame >= cmdline::FromFrame )
+            {
+                spdlog::info( "Reached frame {}, writing prelude with {} live instances", eventBreaker.m_currentFrame, statePrelude.liveInstanceCount() );
+
+                if ( bSerialize )
+                    statePrelude.emit( eventWriter, _group );
+
+                statePrelude.clear();
+                bRecordingPrelude = false;
+            }
+            if ( cmdline::ToFrame > 0 && eventBreaker.m_currentFrame > cmdline::ToFrame )
+            {
+                bWindowComplete = true;
+            }
+
+            // decimation applies from the start of the window onwards; the prelude already coalesces everything before it
+            if ( !bRecordingPrelude )
+            {
+                frameDecimator.onFrame( eventBreaker.m_currentFrame );
+            }
+        };
+
+        // kept events either go into the prelude, get deferred by decimation or go out to the transport
+        const auto emitEvent = [&]( const physx::pvdsdk::EventGroup& _group, auto& _event )
+        {
+            if ( frameDecimator.defer( _group, _event ) || !bSerialize )
+                return;
+
+            if ( bRecordingPrelude )
+                statePrelude.record( _event );
+            else
+                eventWriter.write( _group, _event );
+        };
+
+        // finished mesh simplifications are written out ahead of the next kept event, which may be the mesh's destroy
+        const auto emitSimplifiedMeshes = [&]( const physx::pvdsdk::EventGroup& _group, const bool waitForAll )
+        {
+            if ( opFilterState.m_meshSimplifier )
+            {
+                opFilterState.m_meshSimplifier->drain( [&]( physx::pvdsdk::SetPropertyValue& _event )
+                {
+                    emitEvent( _group, _event );
+                }, waitForAll );
+            }
+        };
+
+        // last chance to rewrite or drop an event before it goes out
+        const auto rewriteAndEmit = [&]( const physx::pvdsdk::EventGroup& _group, auto& _event )
+        {
+            if ( eventBreaker.rewriteEvent( opFilterState, _event ) )
+            {
+                emitSimplifiedMeshes( _group, false );
+                emitEvent( _group, _event );
+            }
+        };
+
+        // region filtering holds back new actors until they have been placed; deduplication may hold an event back (or
+        // drop it), and may release earlier held events that must go first
+        const auto keepEvent = [&]( const physx::pvdsdk::EventGroup& _group, auto& _event )
+        {
+            if ( opFilterState.m_regionFilter && opFilterState.m_regionFilter->accept( _event ) )
+                return;
+
+            if ( opFilterState.m_deduplicator )
+            {
+                const bool bTaken = opFilterState.m_deduplicator->accept( _event );
+                opFilterState.m_deduplicator->release( [&]( auto& _released )
+                {
+                    rewriteAndEmit( _group, _released );
+                } );
+
+                if ( bTaken )
+                    return;
+            }
+            rewriteAndEmit( _group, _event );
+        };
+
+        // actors the region filter has stopped holding back go out ahead of the event that settled them (the end of
+        // their first frame), so they appear in the frame they were created in
+        const auto releaseRegionHeld = [&]( const physx::pvdsdk::EventGroup& _group )
+        {
+            if ( opFilterState.m_regionFilter && opFilterState.m_regionFilter->hasReleased() )
+            {
+                opFilterState.m_regionFilter->release( [&]( auto& _released )
+                {
+                    keepEvent( _group, _released );
+                } );
+            }
+        };
+
+        physx::pvdsdk::EventGroup lastGroup;
+        lastGroup.mStreamId  = 0;
+        lastGroup.mTimestamp = 0;
+
+        Op::StreamResync streamResync;
+
+        // damaged input either stops the run or, with --resync, skips to the next plausible event group; returns
+        // true if decoding can carry on. consumed are the bytes already read from corruptStart onwards
+        const auto recoverFromCorruption = [&]( const uint64_t corruptStart, const uint8_t* consumed, const std::size_t consumedSize )
+        {
+            if ( !cmdline::Resync )
+            {
+                spdlog::error( "stream is corrupt at byte {:#x}; stopping (--resync would skip past it)", corruptStart );
+                return false;
+            }
+
+            eventDecoder.releaseEventData();
+            if ( !streamResync.resync( pxdReader, corruptStart, consumed, consumedSize, lastGroup.mTimestamp ) )
+            {
+                spdlog::warn( "stream is corrupt at byte {:#x}; no event group found after it", corruptStart );
+                return false;
+            }
+
+            spdlog::warn( "stream is corrupt at byte {:#x}; resuming at {:#x}", corruptStart, pxdReader.position() );
+            return true;
+        };
+
+        while ( !bWindowComplete )
+        {
+            const uint64_t groupStart = pxdReader.position();
+
             physx::pvdsdk::EventGroup eg;
-            eg.serialize( eventUnpacker );
+            eventDecoder.decode( eg );
+
+            if ( Op::StreamResync::implausibleGroup( eg ) )
+            {
+                uint8_t consumed[Op::StreamResync::cGroupHeaderSize];
+                Op::StreamResync::serializeGroup( eg, consumed );
+                if ( recoverFromCorruption( groupStart, consumed, sizeof( consumed ) ) )
+                    continue;
+                break;
+            }
 
             // no events seems to signify the end of a stream
             if ( eg.mNumEvents == 0 )
                 break;
 
+            lastGroup = eg;
+
+            if ( frameStatistics )
+                frameStatistics->onGroup( eg );
+
+            bool bCorrupt   = false;
+            bool bRecovered = false;
+
             // for each event in the group (which is usually 1), decode and pass over to the event breaker logic
-            for ( auto eventIndex = 0U; eventIndex < eg.mNumEvents; eventIndex++, numEventsProcessed++ )
+            for ( auto eventIndex = 0U; eventIndex < eg.mNumEvents && !bWindowComplete && !bCorrupt; eventIndex++, numEventsProcessed++ )
             {
                 Op::PvdEventType eventType;
-                eventUnpacker.read( eventType );
+                eventDecoder.decode( eventType );
 
                 switch ( eventType )
                 {
-                    // if the event breaker returns true to indicate the event should be kept, and we're 
-                    // actively serializing, write the type + data back out into the outbound transport
+                    // if the event breaker returns true to indicate the event should be kept, and it is inside
+                    // the frame window, pass it on to be deduplicated, rewritten and written out
 #define DECLARE_PVD_COMM_STREAM_EVENT(x)            case Op::PvdEventType::x: {             \
                     physx::pvdsdk::x _ev;                                                   \
-                    _ev.serialize( eventUnpacker );                                         \
+                    eventDecoder.decode( _ev );                                             \
                     eventBreaker.logStartEvent( #x );                                       \
-                    if ( eventBreaker.handleEvent( opFilterState, eg, _ev ) && bSerialize ) \
+                    const bool bKeep = eventBreaker.handleEvent( opFilterState, eg, _ev );  \
+                    observeEvent( _ev );                                                    \
+                    updateFrameWindow( eg );                                                \
+                    if ( !bWindowComplete )                                                 \
                     {                                                                       \
-                        eg.serialize( streamOut );                                          \
-                        const auto u8EventType = (uint8_t)eventType;                        \
-                        streamOut.write( u8EventType );                                     \
-                        _ev.serialize( streamOut );                                         \
+                        releaseRegionHeld( eg );                                            \
+                    }                                                                       \
+                    if ( bKeep && !bWindowComplete )                                        \
+                    {                                                                       \
+                        keepEvent( eg, _ev );                                               \
                     }                                                                       \
                 } break;
 
@@ -211,9 +676,85 @@ int main( int argc, char** argv )
 
                 default:
                     spdlog::error( "Unhandled Event : {}", (int32_t)eventType );
-                    __debugbreak();
+                    bCorrupt = true;
+                    break;
+                }
+
+                // an event whose length prefix runs past the end of its group was left unread, so decoding is no longer
+                // on an event boundary; as with the group end check below, the scan resumes from where decoding got to
+                if ( !bCorrupt && eventDecoder.overran() )
+                {
+                    spdlog::error( "event {} in the group at {:#x} claims more data than the group holds", eventIndex, groupStart );
+                    bCorrupt   = true;
+                    bRecovered = recoverFromCorruption( groupStart, nullptr, 0 );
+                    break;
+                }
+
+                if ( bCorrupt )
+                {
+                    // a bad first event condemns its group header too; further into a group, only the type byte
+                    // itself is known to be bad
+                    if ( eventIndex == 0 )
+                    {
+                        uint8_t consumed[Op::StreamResync::cProbeSize];
+                        Op::StreamResync::serializeGroup( eg, consumed );
+                        consumed[Op::StreamResync::cGroupHeaderSize] = static_cast<uint8_t>( eventType );
+                        bRecovered = recoverFromCorruption( groupStart, consumed, sizeof( consumed ) );
+                    }
+                    else
+                    {
+                        const uint8_t consumed = static_cast<uint8_t>( eventType );
+                        bRecovered = recoverFromCorruption( pxdReader.position() - 1, &consumed, 1 );
+                    }
                     break;
                 }
+
+                // instances dropped by a cascade after already being written need retracting from the output
+                if ( opFilterState.hasPendingEvents() )
+                {
+                    for ( auto& removeRef : opFilterState.m_pendingRemoveRefs )
+                        keepEvent( eg, removeRef );
+                    for ( auto& destroy : opFilterState.m_pendingDestroys )
+                        keepEvent( eg, destroy );
+
+                    opFilterState.clearPendingEvents();
+                }
+
+                // a kept frame has just opened; bring it up to date with whatever the skipped frames changed
+                if ( frameDecimator.flushDue() )
+                {
+                    frameDecimator.flush( bSerialize ? &eventWriter : nullptr, eg );
+                }
+
+                // event has been handled and written out, its dynamic data can be recycled
+                eventDecoder.releaseEventData();
+
+                // when proxying a live connection, push data on at every section boundary rather than whenever
+                // the transport decides to, keeping latency to the downstream PVD bounded
+                if ( cmdline::inputIsSocket() && eventType == Op::PvdEventType::EndSection )
+                    outboundTransport->flush();
+            }
+
+            // a corrupt length inside an event body sends decoding off past the end of its group (or leaves it short),
+            // and the events after it can't be trusted; the bytes read since the group started are gone, so the scan
+            // for the next group starts from wherever decoding got to
+            if ( !bCorrupt && !bWindowComplete )
+            {
+                const uint64_t groupEnd = groupStart + Op::StreamResync::cGroupHeaderSize + eg.mDataSize;
+                if ( pxdReader.position() != groupEnd )
+                {
+                    spdlog::error( "event group at {:#x} should end at {:#x}, but its events end at {:#x}", groupStart, groupEnd, pxdReader.position() );
+                    bCorrupt   = true;
+                    bRecovered = recoverFromCorruption( groupStart, nullptr, 0 );
+                }
+            }
+
+            // a recovered stream carries on from the next plausible event group
+            if ( bCorrupt )
+            {
+                if ( bRecovered )
+                    continue;
+                break;
             }
 
             if ( numEventsProcessed % 5000 == 0 )
@@ -222,10 +763,104 @@ int main( int argc, char** argv )
             }
         }
         
+        if ( bRecordingPrelude )
+            spdlog::warn( "stream ended before reaching frame {}, nothing was written", cmdline::FromFrame );
+
+        // anything still held for region placement, deduplication or being simplified goes out before the final
+        // decimation flush
+        if ( opFilterState.m_regionFilter && !bWindowComplete )
+        {
+            opFilterState.m_regionFilter->finish();
+            releaseRegionHeld( lastGroup );
+        }
+        if ( opFilterState.m_deduplicator )
+        {
+            opFilterState.m_deduplicator->finish();
+            opFilterState.m_deduplicator->release( [&]( auto& _released )
+            {
+                rewriteAndEmit( lastGroup, _released );
+            } );
+        }
+        emitSimplifiedMeshes( lastGroup, true );
+
+        // leave the output showing the final state, even if the last few frames were skipped
+        if ( frameDecimator.enabled() )
+        {
+            frameDecimator.flush( bSerialize ? &eventWriter : nullptr, lastGroup );
+        }
+
+        if ( propertyIndex )
+        {
+            if ( !propertyIndex->finish() )
+                spdlog::error( "failed writing the property index" );
+        }
+        if ( frameStatistics )
+            frameStatistics->finish();
+        if ( profileTrace )
+        {
+            if ( !profileTrace->finish() )
+                spdlog::error( "failed writing the profile trace" );
+        }
+
         spdlog::info( "- - - - - - - - - - - - - - - -" );
         eventBreaker.logSummary();
+        eventBreaker.logFilterSummary( opFilterState );
+        if ( frameDecimator.enabled() )
+        {
+            spdlog::info( "{:>32} = {} ", "decimated frame sections", frameDecimator.droppedSections() );
+            spdlog::info( "{:>32} = {} -> {} ", "coalesced updates", frameDecimator.deferredEvents(), frameDecimator.flushedEvents() );
+        }
+        if ( propertyIndex )
+        {
+            spdlog::info( "{:>32} = {} ", "indexed property changes", propertyIndex->changeCount() );
+            spdlog::info( "{:>32} = {} bytes ", "indexed value heap", propertyIndex->heapBytes() );
+        }
+        if ( frameStatistics )
+        {
+            spdlog::info( "{:>32} = {} ", "frame statistics rows", frameStatistics->framesWritten() );
+        }
+        if ( profileTrace )
+        {
+            spdlog::info( "{:>32} = {} ", "profile spans exported", profileTrace->spansWritten() );
+            if ( profileTrace->undecodedBuffers() > 0 )
+                spdlog::warn( "{:>32} = {} ", "undecoded profile buffers", profileTrace->undecodedBuffers() );
+        }
+        if ( !streamResync.skippedRanges().empty() )
+        {
+            spdlog::info( "- - - - - - - - - - - - - - - -" );
+            streamResync.logSummary();
+        }
+        if ( lifetimeReport )
+        {
+            spdlog::info( "- - - - - - - - - - - - - - - -" );
+            lifetimeReport->logSummary();
+
+            if ( !cmdline::LifetimesOutput.empty() )
+            {
+                spdlog::info( "Writing surviving instances : {}", cmdline::LifetimesOutput );
+                if ( !lifetimeReport->writeSurvivors( cmdline::LifetimesOutput ) )
+                    spdlog::error( "failed writing the surviving instances" );
+            }
+        }
+        if ( payloadReport )
+        {
+            spdlog::info( "- - - - - - - - - - - - - - - -" );
+            payloadReport->logSummary( eventBreaker );
+        }
 
         outboundTransport->unlock();
         outboundTransport->flush();
+
+        if ( cmdline::PruneDefinitions && bSerialize )
+        {
+            outboundTransport->release();
+
+            spdlog::info( "Pruning unused definitions : {}", cmdline::PxDOutput );
+            if ( !pruneDefinitions( filteredOutput, cmdline::PxDOutput, cmdline::DenseHandles ) )
+                return 1;
+
+            std::error_code removeError;
+            fs::remove( filteredOutput, removeError );
+        }
     }
 }
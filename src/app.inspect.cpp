@@ -0,0 +1,44 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// inspect tool gives a fast summary of a PXD2 capture - stream version, frame count, event type histogram and
+// size breakdown - by walking the event group headers rather than decoding the whole stream
+//
+
+#include "pch.h"
+
+#include "inspect/CaptureInspector.h"
+
+// ---------------------------------------------------------------------------------------------------------------------
+namespace cmdline
+{
+    static std::string PxDInput;
+    static uint32_t TopClasses      = 10;
+
+    int parse( int argc, char** argv )
+    {
+        CLI::App app{ "opvd-inspect" };
+
+        app.add_option( "input", PxDInput, "PXD2 capture to summarise" )->required()->check( CLI::ExistingFile );
+        app.add_option( "-c,--classes", TopClasses, "how many classes to list by instances created" );
+
+        CLI11_PARSE( app, argc, argv );
+
+        return 0;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+    spdlog::set_pattern( "[%^%L%$] %v" );
+
+    if ( int cmdr = cmdline::parse( argc, argv ) )
+        return cmdr;
+
+    return runCaptureInspect( cmdline::PxDInput, cmdline::TopClasses );
+}
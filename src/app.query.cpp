@@ -0,0 +1,137 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// query tool runs filter / aggregate queries over the instances and properties in a PXD2 capture, or looks up
+// single property values at a given frame from the index opvd-filter --index writes
+//
+
+#include "pch.h"
+#include "common/OpFoundation.h"
+#include "common/OpPropertyIndex.h"
+
+#include "query/QueryEngine.h"
+
+// ---------------------------------------------------------------------------------------------------------------------
+namespace cmdline
+{
+    static std::string PxDInput;
+    static std::string ResultsOutput;
+
+    static QuerySpec Query;
+    static std::string Predicate;
+    static std::string AggregateName    = "max";
+    static std::string FormatName       = "csv";
+    static uint32_t ThreadCount         = 0;
+
+    static std::string PointQuery;
+
+    int parse( int argc, char** argv )
+    {
+        CLI::App app{ "opvd-query" };
+
+        app.add_option( "-p,--pxd", PxDInput, "path to a PXD2 capture file to query" )->required()->check( CLI::ExistingFile );
+        app.add_option( "--property", Query.m_property, "name of the property to query (eg. linearVelocity)" )->required();
+        app.add_option( "--class", Query.m_classes, "only include instances of these classes; default is every class with the property" );
+        app.add_option( "--component", Query.m_component, "which float of the property value to use (eg. 5 for the y position of a PxTransform)" );
+        app.add_flag( "--length", Query.m_length, "use the length of the 3-vector starting at --component instead" );
+        app.add_option( "--where", Predicate, "only include values passing this comparison, eg. \"<-1000\"" );
+        app.add_option( "--agg", AggregateName, "count, min, max, sum, mean - or frames, to list every frame with a matching instance" );
+        app.add_option( "--bucket", Query.m_bucketFrames, "number of frames aggregated into each result row" )->check( CLI::PositiveNumber );
+        app.add_option( "--format", FormatName, "results as csv or json" )->check( CLI::IsMember( { "csv", "json" } ) );
+        app.add_option( "-o,--out", ResultsOutput, "file to write results to, default is stdout" );
+        app.add_option( "-j,--threads", ThreadCount, "number of worker threads, default is one per core" );
+        app.add_option( "--at", PointQuery, "INSTANCE@FRAME - look up the property of one instance from the capture's index instead" );
+
+        CLI11_PARSE( app, argc, argv );
+
+        if ( !Predicate.empty() && !QuerySpec::parsePredicate( Predicate, Query ) )
+        {
+            spdlog::error( "invalid --where [{}], expected a comparison like <-1000 or >=0.5", Predicate );
+            return 1;
+        }
+        if ( !QuerySpec::parseAggregate( AggregateName, Query.m_aggregate ) )
+        {
+            spdlog::error( "invalid --agg [{}]", AggregateName );
+            return 1;
+        }
+        Query.m_format = ( FormatName == "json" ) ? QuerySpec::Format::JSON : QuerySpec::Format::CSV;
+
+        return 0;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// answer an INSTANCE@FRAME lookup from the property index; instance IDs may be given in hex (0x...) or decimal
+int runPointQuery()
+{
+    const auto separator = cmdline::PointQuery.find( '@' );
+    if ( separator == std::string::npos )
+    {
+        spdlog::error( "invalid --at [{}], expected INSTANCE@FRAME", cmdline::PointQuery );
+        return 1;
+    }
+
+    const uint64_t instanceID = std::strtoull( cmdline::PointQuery.substr( 0, separator ).c_str(), nullptr, 0 );
+    const uint64_t frame      = std::strtoull( cmdline::PointQuery.substr( separator + 1 ).c_str(), nullptr, 10 );
+
+    const std::string indexFilename = Op::PropertyIndexBuilder::indexPathFor( cmdline::PxDInput );
+    Op::PropertyIndex propertyIndex;
+    if ( !propertyIndex.load( indexFilename ) )
+    {
+        spdlog::error( "no property index for [{}], build one with opvd-filter -p {} --index", cmdline::PxDInput, cmdline::PxDInput );
+        return 1;
+    }
+
+    std::vector< uint8_t > value;
+    uint64_t changedFrame = 0;
+    if ( !propertyIndex.valueAt( instanceID, cmdline::Query.m_property, frame, value, &changedFrame ) )
+    {
+        spdlog::info( "{:#x}.{} has no value at frame {}", instanceID, cmdline::Query.m_property, frame );
+        return 0;
+    }
+
+    spdlog::info( "{:#x}.{} at frame {} (set on frame {}), {} bytes", instanceID, cmdline::Query.m_property, frame, changedFrame, value.size() );
+
+    // most properties are made of floats, show them that way as well as raw
+    std::string asFloats;
+    for ( std::size_t offset = 0; offset + sizeof( float ) <= value.size(); offset += sizeof( float ) )
+    {
+        float component;
+        std::memcpy( &component, value.data() + offset, sizeof( float ) );
+        asFloats += fmt::format( "{}{}", asFloats.empty() ? "" : ", ", component );
+    }
+    std::string asBytes;
+    for ( const uint8_t byte : value )
+        asBytes += fmt::format( "{:02x}", byte );
+
+    spdlog::info( "  floats : {}", asFloats );
+    spdlog::info( "   bytes : {}", asBytes );
+    return 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+    spdlog::set_pattern( "[%^%L%$] %v" );
+
+    if ( int cmdr = cmdline::parse( argc, argv ) )
+        return cmdr;
+
+    // results go to stdout unless told otherwise, keep the log out of their way
+    if ( cmdline::ResultsOutput.empty() && cmdline::PointQuery.empty() )
+    {
+        spdlog::set_default_logger( spdlog::stderr_color_mt( "stderr" ) );
+        spdlog::set_pattern( "[%^%L%$] %v" );
+    }
+
+    Op::Foundation opFoundation;
+
+    if ( !cmdline::PointQuery.empty() )
+        return runPointQuery();
+
+    return runQuery( cmdline::PxDInput, cmdline::Query, cmdline::ResultsOutput, cmdline::ThreadCount );
+}
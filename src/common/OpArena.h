@@ -0,0 +1,123 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// decoded events point into dynamically sized data (strings, DataRef payloads) that only needs to live until the
+// next event is read; Op::Arena is a simple bump allocator that hands out that memory from a few large blocks and
+// can be reset wholesale between events, so a steady-state decode loop does no heap allocation at all
+//
+
+#pragma once
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    struct Arena
+    {
+        static constexpr std::size_t cDefaultBlockSize = 4 * 1024 * 1024;
+
+        explicit Arena( const std::size_t blockSize = cDefaultBlockSize )
+            : m_blockSize( blockSize )
+        {
+        }
+
+        ~Arena()
+        {
+            for ( auto& block : m_blocks )
+                _aligned_free( block.m_data );
+        }
+
+        Arena( const Arena& ) = delete;
+        Arena& operator=( const Arena& ) = delete;
+
+        // all allocations are 16b aligned, matching what the physx allocator callbacks expect
+        inline void* allocate( const std::size_t size )
+        {
+            const std::size_t alignedSize = ( size + 15 ) & ~std::size_t( 15 );
+
+            if ( m_activeBlock < m_blocks.size() )
+            {
+                Block& block = m_blocks[m_activeBlock];
+                if ( block.m_used + alignedSize <= block.m_size )
+                {
+                    void* result = block.m_data + block.m_used;
+                    block.m_used += alignedSize;
+                    return result;
+                }
+            }
+            return allocateSlow( alignedSize );
+        }
+
+        template< typename _mType >
+        inline _mType* allocate( const std::size_t quantity )
+        {
+            return static_cast<_mType*>( allocate( sizeof( _mType ) * quantity ) );
+        }
+
+        // forget everything handed out so far; blocks are kept around for reuse
+        inline void reset()
+        {
+            for ( auto& block : m_blocks )
+                block.m_used = 0;
+
+            m_activeBlock = 0;
+        }
+
+        [[nodiscard]] inline std::size_t bytesReserved() const
+        {
+            std::size_t total = 0;
+            for ( const auto& block : m_blocks )
+                total += block.m_size;
+            return total;
+        }
+
+    private:
+
+        struct Block
+        {
+            uint8_t*        m_data = nullptr;
+            std::size_t     m_size = 0;
+            std::size_t     m_used = 0;
+        };
+
+        void* allocateSlow( const std::size_t alignedSize )
+        {
+            // move on to the next retained block if it can fit the request, otherwise insert a fresh one
+            // (sized up for oversized requests, eg. a single huge trimesh payload)
+            if ( m_activeBlock + 1 < m_blocks.size() && m_blocks[m_activeBlock + 1].m_size >= alignedSize )
+            {
+                m_activeBlock++;
+            }
+            else
+            {
+                Block newBlock;
+                newBlock.m_size = std::max( m_blockSize, alignedSize );
+                newBlock.m_data = static_cast<uint8_t*>( _aligned_malloc( newBlock.m_size, 16 ) );
+
+                if ( m_blocks.empty() )
+                {
+                    m_blocks.push_back( newBlock );
+                    m_activeBlock = 0;
+                }
+                else
+                {
+                    m_activeBlock++;
+                    m_blocks.insert( m_blocks.begin() + m_activeBlock, newBlock );
+                }
+            }
+
+            Block& block = m_blocks[m_activeBlock];
+            void* result = block.m_data + block.m_used;
+            block.m_used += alignedSize;
+            return result;
+        }
+
+        std::vector< Block >    m_blocks;
+        std::size_t             m_activeBlock = 0;
+        const std::size_t       m_blockSize;
+    };
+
+} // namespace Op
@@ -0,0 +1,291 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpBlockReader.h"
+
+#include <io.h>
+
+#include "PsSocket.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr< FileBlockSource > FileBlockSource::open( const std::string& filename )
+    {
+        FILE* file = fopen( filename.c_str(), "rb" );
+        if ( file == nullptr )
+        {
+            spdlog::error( "unable to open [{}] for reading", filename );
+            return nullptr;
+        }
+
+        // we only ever ask for huge blocks, no point having stdio copy them through its own buffer first
+        setvbuf( file, nullptr, _IONBF, 0 );
+
+        return std::unique_ptr< FileBlockSource >( new FileBlockSource( file ) );
+    }
+
+    FileBlockSource::~FileBlockSource()
+    {
+        if ( m_file != nullptr )
+            fclose( m_file );
+    }
+
+    std::size_t FileBlockSource::readBlock( uint8_t* destination, std::size_t maxBytes )
+    {
+        return fread( destination, 1, maxBytes, m_file );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    PipeBlockSource::~PipeBlockSource()
+    {
+        if ( m_readingThread != nullptr )
+            CloseHandle( m_readingThread );
+    }
+
+    std::size_t PipeBlockSource::readBlock( uint8_t* destination, std::size_t maxBytes )
+    {
+        // a real handle to this thread, so cancel() can interrupt the read from another one
+        if ( m_readingThread == nullptr )
+        {
+            HANDLE threadHandle = nullptr;
+            DuplicateHandle( GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &threadHandle, 0, FALSE, DUPLICATE_SAME_ACCESS );
+            m_readingThread = threadHandle;
+        }
+
+        m_inRead = true;
+        if ( m_cancelled )
+        {
+            m_inRead = false;
+            return 0;
+        }
+
+        // _read returns as soon as anything is available in the pipe
+        const unsigned int clampedRead = static_cast<unsigned int>( std::min< std::size_t >( maxBytes, INT_MAX ) );
+        const int bytesRead = _read( m_fileDescriptor, destination, clampedRead );
+
+        m_inRead = false;
+
+        return ( bytesRead > 0 && !m_cancelled ) ? static_cast<std::size_t>( bytesRead ) : 0;
+    }
+
+    void PipeBlockSource::cancel()
+    {
+        m_cancelled = true;
+
+        // the reading thread may be just about to enter _read when the first cancel lands, so keep at it until the
+        // read has returned
+        while ( m_inRead )
+        {
+            if ( m_readingThread != nullptr )
+                CancelSynchronousIo( m_readingThread );
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    std::size_t SocketBlockSource::readBlock( uint8_t* destination, std::size_t maxBytes )
+    {
+        const uint32_t clampedRead = static_cast<uint32_t>( std::min< std::size_t >( maxBytes, UINT32_MAX ) );
+
+        if ( !m_socket.isConnected() )
+            return 0;
+
+        // the socket is accepted in blocking mode, so a read only comes back empty once the client has shut the
+        // connection down (or it failed); either way that is the end of the stream, and retrying would spin forever
+        return m_socket.read( destination, clampedRead );
+    }
+
+    void SocketBlockSource::cancel()
+    {
+        m_socket.disconnect();
+    }
+
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    BlockReader::BlockReader( std::unique_ptr< BlockSource > source, const std::size_t blockSize, const uint32_t blockCount )
+        : m_source( std::move( source ) )
+        , m_blockSize( blockSize )
+    {
+        // need at least one block being decoded and one being filled
+        const uint32_t totalBlocks = std::max( blockCount, 2U );
+
+        m_blocks.reserve( totalBlocks );
+        m_freeBlocks.reserve( totalBlocks );
+        m_filledBlocks.reserve( totalBlocks );
+
+        for ( uint32_t idx = 0; idx < totalBlocks; idx++ )
+        {
+            m_blocks.push_back( static_cast<uint8_t*>( _aligned_malloc( m_blockSize, 16 ) ) );
+            m_freeBlocks.push_back( idx );
+        }
+
+        if ( m_source != nullptr )
+            m_readAhead = std::thread( &BlockReader::readAheadThread, this );
+        else
+            m_eof = true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    BlockReader::~BlockReader()
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_stopping = true;
+        }
+        m_blockFreed.notify_all();
+
+        if ( m_readAhead.joinable() )
+        {
+            m_source->cancel();
+            m_readAhead.join();
+        }
+
+        for ( auto* block : m_blocks )
+            _aligned_free( block );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void BlockReader::readAheadThread()
+    {
+        for ( ;; )
+        {
+            uint32_t blockIndex;
+            {
+                std::unique_lock< std::mutex > lock( m_mutex );
+                m_blockFreed.wait( lock, [this] { return m_stopping || !m_freeBlocks.empty(); } );
+
+                if ( m_stopping )
+                    return;
+
+                blockIndex = m_freeBlocks.back();
+                m_freeBlocks.pop_back();
+            }
+
+            const std::size_t bytesRead = m_source->readBlock( m_blocks[blockIndex], m_blockSize );
+
+            {
+                std::lock_guard< std::mutex > lock( m_mutex );
+                m_filledBlocks.push_back( { blockIndex, bytesRead } );
+            }
+            m_blockFilled.notify_one();
+
+            // nothing more will arrive after the end-of-stream marker
+            if ( bytesRead == 0 )
+                return;
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void BlockReader::unread( const uint8_t* data, const std::size_t size )
+    {
+        if ( size == 0 )
+            return;
+
+        const uint64_t currentPosition = position();
+
+        // already serving put-back bytes; the new ones go in front of whatever of those is left
+        if ( m_replaying )
+        {
+            std::vector< uint8_t > replay( data, data + size );
+            replay.insert( replay.end(), m_cursor, m_end );
+            m_replay = std::move( replay );
+        }
+        else
+        {
+            m_savedBegin    = m_begin;
+            m_savedCursor   = m_cursor;
+            m_savedEnd      = m_end;
+            m_savedConsumed = m_consumedBeforeBlock;
+            m_replay.assign( data, data + size );
+            m_replaying     = true;
+        }
+
+        m_begin  = m_replay.data();
+        m_cursor = m_begin;
+        m_end    = m_begin + m_replay.size();
+        m_consumedBeforeBlock = currentPosition - size;
+    }
+
+    bool BlockReader::acquireNextBlock()
+    {
+        if ( m_eof )
+            return false;
+
+        m_consumedBeforeBlock += static_cast<uint64_t>( m_end - m_begin );
+
+        FilledBlock nextBlock;
+        {
+            std::unique_lock< std::mutex > lock( m_mutex );
+
+            // hand the exhausted block back to be refilled
+            if ( m_currentBlock >= 0 )
+            {
+                m_freeBlocks.push_back( static_cast<uint32_t>( m_currentBlock ) );
+                m_currentBlock = -1;
+                m_blockFreed.notify_one();
+            }
+
+            m_blockFilled.wait( lock, [this] { return !m_filledBlocks.empty(); } );
+
+            nextBlock = m_filledBlocks.front();
+            m_filledBlocks.erase( m_filledBlocks.begin() );
+        }
+
+        m_currentBlock = static_cast<int32_t>( nextBlock.m_index );
+        m_begin  = m_blocks[nextBlock.m_index];
+        m_cursor = m_begin;
+        m_end    = m_begin + nextBlock.m_size;
+
+        if ( nextBlock.m_size == 0 )
+        {
+            m_eof = true;
+            return false;
+        }
+        return true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    uint32_t BlockReader::readSlow( uint8_t* buffer, const uint32_t size )
+    {
+        uint32_t bytesCopied = 0;
+
+        while ( bytesCopied < size )
+        {
+            const std::size_t available = static_cast<std::size_t>( m_end - m_cursor );
+            if ( available == 0 )
+            {
+                if ( m_replaying )
+                {
+                    m_begin     = m_savedBegin;
+                    m_cursor    = m_savedCursor;
+                    m_end       = m_savedEnd;
+                    m_consumedBeforeBlock = m_savedConsumed;
+                    m_replaying = false;
+                    continue;
+                }
+                if ( !acquireNextBlock() )
+                    break;
+                continue;
+            }
+
+            const uint32_t toCopy = static_cast<uint32_t>( std::min< std::size_t >( available, size - bytesCopied ) );
+            std::memcpy( buffer + bytesCopied, m_cursor, toCopy );
+            m_cursor    += toCopy;
+            bytesCopied += toCopy;
+        }
+
+        if ( bytesCopied < size )
+            std::memset( buffer + bytesCopied, 0, size - bytesCopied );
+
+        return bytesCopied;
+    }
+
+} // namespace Op
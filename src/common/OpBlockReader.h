@@ -0,0 +1,168 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// decoding pulls data out of the stream a handful of bytes at a time; rather than have every one of those turn into
+// a library call on a file handle, BlockReader keeps a small ring of large blocks filled by a helper thread and
+// serves reads straight out of memory with an inline bounds check. Where the bytes come from is abstracted behind
+// BlockSource, so files, pipes and sockets all decode through the same path
+//
+
+#pragma once
+
+namespace physx { namespace shdfnd { class Socket; } }
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    // a producer of raw stream bytes; only ever called from the BlockReader helper thread
+    struct BlockSource
+    {
+        virtual ~BlockSource() = default;
+
+        // read up to maxBytes into destination, returning how many were read; 0 signifies the end of the stream.
+        // sources that are fed incrementally (pipes, sockets) should return whatever is available rather than
+        // waiting to fill the whole request, keeping latency down on live streams
+        virtual std::size_t readBlock( uint8_t* destination, std::size_t maxBytes ) = 0;
+
+        // called when the reader is being torn down, to unblock any readBlock() call that is waiting on more data
+        virtual void cancel() {}
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // regular files, read in full blocks with stdio buffering disabled
+    struct FileBlockSource final : public BlockSource
+    {
+        static std::unique_ptr< FileBlockSource > open( const std::string& filename );
+
+        ~FileBlockSource() override;
+
+        std::size_t readBlock( uint8_t* destination, std::size_t maxBytes ) override;
+
+    private:
+        FileBlockSource( FILE* file ) : m_file( file ) {}
+
+        FILE*   m_file = nullptr;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // an already open file descriptor that may not be seekable, eg. stdin
+    struct PipeBlockSource final : public BlockSource
+    {
+        PipeBlockSource( const int fileDescriptor ) : m_fileDescriptor( fileDescriptor ) {}
+        ~PipeBlockSource() override;
+
+        std::size_t readBlock( uint8_t* destination, std::size_t maxBytes ) override;
+
+        // a pipe that never closes leaves the helper thread blocked in _read; cancel its pending I/O
+        void cancel() override;
+
+    private:
+        int                     m_fileDescriptor = -1;
+
+        void*                   m_readingThread  = nullptr;     // HANDLE of the thread calling readBlock()
+        std::atomic< bool >     m_inRead         = false;
+        std::atomic< bool >     m_cancelled      = false;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // a connected PVD client socket
+    struct SocketBlockSource final : public BlockSource
+    {
+        SocketBlockSource( physx::shdfnd::Socket& socket ) : m_socket( socket ) {}
+
+        std::size_t readBlock( uint8_t* destination, std::size_t maxBytes ) override;
+        void cancel() override;
+
+    private:
+        physx::shdfnd::Socket&  m_socket;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    class BlockReader
+    {
+    public:
+
+        static constexpr std::size_t cDefaultBlockSize  = 8 * 1024 * 1024;
+        static constexpr uint32_t    cDefaultBlockCount = 3;
+
+        BlockReader( std::unique_ptr< BlockSource > source, const std::size_t blockSize = cDefaultBlockSize, const uint32_t blockCount = cDefaultBlockCount );
+        ~BlockReader();
+
+        BlockReader( const BlockReader& ) = delete;
+        BlockReader& operator=( const BlockReader& ) = delete;
+
+        // matches the PsFileBuffer::read signature so this can be dropped into EventUnpacker / EventDecoder; any bytes
+        // requested past the end of the stream are zeroed, so a truncated stream decodes as an empty event group
+        inline uint32_t read( void* buffer, const uint32_t size )
+        {
+            if ( static_cast<std::size_t>( m_end - m_cursor ) >= size )
+            {
+                std::memcpy( buffer, m_cursor, size );
+                m_cursor += size;
+                return size;
+            }
+            return readSlow( static_cast<uint8_t*>( buffer ), size );
+        }
+
+        // total number of bytes consumed through read() so far
+        [[nodiscard]] inline uint64_t position() const
+        {
+            return m_consumedBeforeBlock + static_cast<uint64_t>( m_cursor - m_begin );
+        }
+
+        // true once a read has run off the end of the stream
+        [[nodiscard]] inline bool eof() const { return m_eof; }
+
+        // puts bytes back in front of the read position, to be served by the following reads before the stream
+        // continues; used when resynchronising, where the scan has to read past the point decoding picks up from.
+        // the bytes are copied, and must be the ones that immediately preceded the current position
+        void unread( const uint8_t* data, const std::size_t size );
+
+    private:
+
+        struct FilledBlock
+        {
+            uint32_t        m_index;
+            std::size_t     m_size;         // 0 marks the end of the stream
+        };
+
+        uint32_t readSlow( uint8_t* buffer, const uint32_t size );
+        bool acquireNextBlock();
+        void readAheadThread();
+
+        std::unique_ptr< BlockSource >  m_source;
+        const std::size_t               m_blockSize;
+        std::vector< uint8_t* >         m_blocks;
+
+        // consumer-side state, only touched by the thread calling read()
+        const uint8_t*                  m_begin                 = nullptr;
+        const uint8_t*                  m_cursor                = nullptr;
+        const uint8_t*                  m_end                   = nullptr;
+        int32_t                         m_currentBlock          = -1;
+        uint64_t                        m_consumedBeforeBlock   = 0;
+        bool                            m_eof                   = false;
+
+        // unread() bytes are served as if they were a block, with the real block's window stashed until they run out
+        std::vector< uint8_t >          m_replay;
+        bool                            m_replaying             = false;
+        const uint8_t*                  m_savedBegin            = nullptr;
+        const uint8_t*                  m_savedCursor           = nullptr;
+        const uint8_t*                  m_savedEnd              = nullptr;
+        uint64_t                        m_savedConsumed         = 0;
+
+        // shared with the read-ahead thread
+        std::mutex                      m_mutex;
+        std::condition_variable         m_blockFilled;
+        std::condition_variable         m_blockFreed;
+        std::vector< uint32_t >         m_freeBlocks;
+        std::vector< FilledBlock >      m_filledBlocks;     // FIFO, consumed from the front
+        bool                            m_stopping              = false;
+
+        std::thread                     m_readAhead;
+    };
+
+} // namespace Op
@@ -43,6 +43,93 @@ namespace Op
             }
     }
 
+    // ---------------------------------------------------------------------------------------------------------------------
+    void FilterState::dropInstance( const uint64_t instanceID, const bool alreadyWritten )
+    {
+        addInstance( instanceID );
+
+        if ( !cascadeEnabled() )
+        {
+            if ( alreadyWritten )
+                retractInstance( instanceID );
+            return;
+        }
+
+        m_cascadeScratch.clear();
+        m_references.filter( instanceID, m_cascadeScratch );
+
+        // mark everything as filtered before retracting, so no RemoveObjectRef is generated for owners that are
+        // themselves going away
+        for ( const uint64_t cascadedID : m_cascadeScratch )
+            addInstance( cascadedID );
+
+        m_cascadedInstanceCount += m_cascadeScratch.size();
+
+        if ( alreadyWritten )
+            retractInstance( instanceID );
+
+        // cascades only ever reach instances that were live, so they have all been written out already
+        for ( const uint64_t cascadedID : m_cascadeScratch )
+            retractInstance( cascadedID );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void FilterState::onFrameEnd()
+    {
+        if ( m_regionFilter )
+        {
+            m_regionScratch.clear();
+            m_regionWithheldScratch.clear();
+            m_regionFilter->evaluateFrame( m_regionScratch, m_regionWithheldScratch );
+
+            for ( const uint64_t outsideID : m_regionScratch )
+            {
+                if ( isInstanceFiltered( outsideID ) )
+                    continue;
+
+                dropInstance( outsideID, true );
+                m_regionDroppedInstances++;
+            }
+
+            // actors that started outside were held back for their first frame and never reached the output
+            for ( const uint64_t outsideID : m_regionWithheldScratch )
+            {
+                if ( isInstanceFiltered( outsideID ) )
+                    continue;
+
+                dropInstance( outsideID, false );
+                m_regionDroppedInstances++;
+            }
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void FilterState::retractInstance( const uint64_t instanceID )
+    {
+        m_references.forEachOwner( instanceID, [&]( const uint64_t ownerID, const uint32_t property, const uint32_t count )
+            {
+                if ( isInstanceFiltered( ownerID ) )
+                    return;
+
+                physx::pvdsdk::RemoveObjectRef removeRef;
+                removeRef.mInstanceId = ownerID;
+                removeRef.mProperty   = property;
+                removeRef.mObjectRef  = instanceID;
+
+                for ( uint32_t pushed = 0; pushed < count; pushed++ )
+                    m_pendingRemoveRefs.push_back( removeRef );
+            });
+
+        // any geometry still held back for the instance has to be written ahead of the synthesized destroy
+        if ( m_meshSimplifier )
+            m_meshSimplifier->onDestroyInstance( instanceID );
+
+        physx::pvdsdk::DestroyInstance destroy;
+        destroy.mInstanceId = instanceID;
+        m_pendingDestroys.push_back( destroy );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
     void EventBreaker::logSummary()
     {
         spdlog::info( "{:>32} = {} ", "number of frames", m_currentFrame );
@@ -54,6 +141,53 @@ namespace Op
         }
     }
 
+    void EventBreaker::logFilterSummary( const FilterState& _filtering )
+    {
+        if ( _filtering.m_sizeBudget )
+        {
+            _filtering.m_sizeBudget->forEachClass( []( const std::string& className, const SizeBudget::ClassBudget& budget )
+                {
+                    spdlog::info( "{:>32} = {} of {} kept, budget {} ", fmt::format( "budgeted {}", className ),
+                        humaniseByteSize( budget.m_totalBytes - budget.m_droppedBytes ), humaniseByteSize( budget.m_totalBytes ), humaniseByteSize( budget.m_budget ) );
+                    spdlog::info( "{:>32} = {} of {} ", "instances dropped", budget.m_droppedInstances, budget.m_instances );
+                });
+        }
+        if ( !_filtering.m_propertyRules.empty() )
+        {
+            spdlog::info( "{:>32} = {} ", "stripped property events", _filtering.m_strippedPropertyEvents );
+            spdlog::info( "{:>32} = {} ", "stripped property payload", humaniseByteSize( _filtering.m_strippedPropertyBytes ) );
+        }
+        if ( _filtering.m_regionFilter )
+        {
+            spdlog::info( "{:>32} = {} ", "instances outside region", _filtering.m_regionDroppedInstances );
+            spdlog::info( "{:>32} = {} ", "actors inside region", _filtering.m_regionFilter->insideCount() );
+        }
+        if ( _filtering.m_updateSuppressor )
+        {
+            spdlog::info( "{:>32} = {} ", "unchanged updates dropped", _filtering.m_suppressedUpdateEvents );
+            spdlog::info( "{:>32} = {} ", "unchanged update payload", humaniseByteSize( _filtering.m_suppressedUpdateBytes ) );
+            spdlog::info( "{:>32} = {} ", "update table evictions", _filtering.m_updateSuppressor->evictions() );
+        }
+        if ( _filtering.m_deduplicator )
+        {
+            spdlog::info( "{:>32} = {} ", "canonical geometry instances", _filtering.m_deduplicator->canonicalInstances() );
+            spdlog::info( "{:>32} = {} ", "duplicate geometry dropped", _filtering.m_deduplicator->duplicateInstances() );
+            spdlog::info( "{:>32} = {} ", "redirected references", _filtering.m_deduplicator->redirectedReferences() );
+            spdlog::info( "{:>32} = {} ", "duplicate payload saved", humaniseByteSize( _filtering.m_deduplicator->bytesSaved() ) );
+        }
+        if ( _filtering.m_meshSimplifier )
+        {
+            spdlog::info( "{:>32} = {} ", "simplified meshes", _filtering.m_meshSimplifier->meshesSimplified() );
+            spdlog::info( "{:>32} = {} -> {} ", "simplified mesh triangles", _filtering.m_meshSimplifier->trianglesBefore(), _filtering.m_meshSimplifier->trianglesAfter() );
+            spdlog::info( "{:>32} = {} ", "simplified mesh payload saved", humaniseByteSize( _filtering.m_meshSimplifier->bytesSaved() ) );
+        }
+        if ( _filtering.cascadeEnabled() )
+        {
+            spdlog::info( "{:>32} = {} ", "cascaded instance drops", _filtering.m_cascadedInstanceCount );
+            spdlog::info( "{:>32} = {} / {} ", "reference graph nodes / edges", _filtering.m_references.numNodes(), _filtering.m_references.numEdges() );
+        }
+    }
+
     void EventBreaker::logStartEvent( const char* eventTitle )
     {
         if ( m_verboseLog != nullptr )
@@ -68,6 +202,15 @@ namespace Op
     {
         addFromStringHandleEvent( _event );
 
+        if ( !_filtering.m_propertyRules.empty() )
+            _filtering.m_propertyRules.onStringHandle( _event );
+        if ( _filtering.m_regionFilter )
+            _filtering.m_regionFilter->onStringHandle( _event );
+        if ( _filtering.m_meshSimplifier )
+            _filtering.m_meshSimplifier->onStringHandle( _event );
+        if ( _filtering.m_deduplicator )
+            _filtering.m_deduplicator->onStringHandle( _event );
+
         if ( m_verboseLog != nullptr )
         {
             m_verboseLog->info( "[{}]           <= \"{}\"", _event.mHandle, _event.mString );
@@ -91,6 +234,9 @@ namespace Op
         const auto nsParent = lookupNamespace( _event.mParent );
         const auto nsChild = lookupNamespace( _event.mChild );
 
+        if ( _filtering.m_regionFilter )
+            _filtering.m_regionFilter->onDeriveClass( nsParent.mName, nsChild.mName );
+
         if ( m_verboseLog != nullptr )
         {
             m_verboseLog->info( "mParent         : [{}.{}]", nsParent.mNamespace, nsParent.mName );
@@ -121,6 +267,13 @@ namespace Op
         const auto propClass = lookupNamespace( _event.mClass );
         const auto propMsg = lookupNamespace( _event.mMessageName );
 
+        if ( !_filtering.m_propertyRules.empty() )
+            _filtering.m_propertyRules.onCreatePropertyMessage( _event );
+        if ( _filtering.m_regionFilter )
+            _filtering.m_regionFilter->onCreatePropertyMessage( _event );
+        if ( _filtering.m_deduplicator )
+            _filtering.m_deduplicator->onCreatePropertyMessage( _event );
+
         if ( m_verboseLog != nullptr )
         {
             m_verboseLog->info( "mClass          : [{}.{}]", propClass.mNamespace, propClass.mName );
@@ -156,10 +309,31 @@ namespace Op
         {
             shouldFilter = (m_instanceCount[instClass.mName] >= it->second);
         }
+        if ( _filtering.m_sizeBudget && _filtering.m_sizeBudget->onCreateInstance( _event.mInstanceId ) )
+        {
+            shouldFilter = true;
+        }
+
+        if ( _filtering.cascadeEnabled() )
+        {
+            _filtering.m_references.addInstance( _event.mInstanceId, _filtering.m_cascadeClasses.contains( instClass.mName ) );
+        }
+        if ( !_filtering.m_propertyRules.empty() )
+        {
+            _filtering.m_propertyRules.onCreateInstance( _event );
+        }
+        if ( _filtering.m_updateSuppressor )
+        {
+            _filtering.m_updateSuppressor->onCreateInstance( _event.mInstanceId );
+        }
+        if ( _filtering.m_meshSimplifier )
+        {
+            _filtering.m_meshSimplifier->onCreateInstance( _event.mInstanceId, instClass.mName == "PxTriangleMesh" );
+        }
 
         if ( shouldFilter )
         {
-            _filtering.addInstance( _event.mInstanceId );
+            _filtering.dropInstance( _event.mInstanceId, false );
             if ( m_verboseLog != nullptr )
                 m_verboseLog->info( "== filtered ==" );
         }
@@ -167,6 +341,9 @@ namespace Op
         {
             m_instanceTypeMap.emplace( _event.mInstanceId, instClass.mName );
             m_instanceCount[instClass.mName] ++;
+
+            if ( _filtering.m_regionFilter )
+                _filtering.m_regionFilter->onCreateInstance( _event.mInstanceId, instClass.mName );
         }
 
 
@@ -189,12 +366,26 @@ namespace Op
         if ( !isFiltered )
         {
             m_instanceDataSizes[instanceType] += _event.mData.size();
+
+            if ( _filtering.m_regionFilter )
+                _filtering.m_regionFilter->onPropertyValue( _event.mInstanceId, _event.mPropertyName, _event.mData );
+        }
+
+        // object references held in property values (an actor's shapes, a shape's geometry) are edges too
+        bool cascades = false;
+        if ( _filtering.cascadeEnabled() && propTypeName.mName == "ObjectRef" )
+        {
+            cascades = _filtering.m_references.setValueReferences( _event.mInstanceId, _event.mPropertyName, _event.mData );
+            if ( cascades )
+                _filtering.dropInstance( _event.mInstanceId, true );
         }
 
         if ( m_verboseLog != nullptr )
         {
             if ( isFiltered )
                 m_verboseLog->info( "== filtered ==" );
+            if ( cascades )
+                m_verboseLog->info( "== cascaded ==" );
 
             m_verboseLog->info( "mInstanceId     : {:#x} ({})", _event.mInstanceId, instanceType );
             m_verboseLog->info( "mPropertyName   : {}", propName );
@@ -265,6 +456,9 @@ namespace Op
         const auto nsMessage = lookupNamespace( _event.mMessageName );
         const bool isFiltered = _filtering.isInstanceFiltered( _event.mInstanceId );
 
+        if ( !isFiltered && _filtering.m_regionFilter )
+            _filtering.m_regionFilter->onPropertyMessage( _event.mInstanceId, _event.mMessageName, _event.mData );
+
         if ( m_verboseLog != nullptr )
         {
             if ( isFiltered )
@@ -282,6 +476,8 @@ namespace Op
     {
         const auto nsMessage = lookupNamespace( _event.mMsgName );
 
+        _filtering.m_groupMessageName = _event.mMsgName;
+
         if ( m_verboseLog != nullptr )
         {
             m_verboseLog->info( "mMsgName        : [{}.{}]", nsMessage.mNamespace, nsMessage.mName );
@@ -291,12 +487,20 @@ namespace Op
 
     bool EventBreaker::handleEvent( FilterState& _filtering, const physx::pvdsdk::EventGroup& _group, const physx::pvdsdk::SendPropertyMessageFromGroup& _event )
     {
+        const bool isFiltered = _filtering.isInstanceFiltered( _event.mInstance );
+
+        if ( !isFiltered && _filtering.m_regionFilter )
+            _filtering.m_regionFilter->onPropertyMessage( _event.mInstance, _filtering.m_groupMessageName, _event.mData );
+
         if ( m_verboseLog != nullptr )
         {
+            if ( isFiltered )
+                m_verboseLog->info( "== filtered ==" );
+
             m_verboseLog->info( "mInstance       : {:#x}", _event.mInstance );
             m_verboseLog->info( "mData.size()    : {}", _event.mData.size() );
         }
-        return true;
+        return !isFiltered;
     }
 
     bool EventBreaker::handleEvent( FilterState& _filtering, const physx::pvdsdk::EventGroup& _group, const physx::pvdsdk::EndPropertyMessageGroup& _event )
@@ -320,6 +524,17 @@ namespace Op
         if ( isFiltered )
             _filtering.removeInstance( _event.mInstanceId );
 
+        if ( _filtering.cascadeEnabled() )
+            _filtering.m_references.removeInstance( _event.mInstanceId );
+        if ( !_filtering.m_propertyRules.empty() )
+            _filtering.m_propertyRules.onDestroyInstance( _event.mInstanceId );
+        if ( _filtering.m_updateSuppressor )
+            _filtering.m_updateSuppressor->onDestroyInstance( _event.mInstanceId );
+        if ( _filtering.m_regionFilter )
+            _filtering.m_regionFilter->onDestroyInstance( _event.mInstanceId );
+        if ( _filtering.m_meshSimplifier )
+            _filtering.m_meshSimplifier->onDestroyInstance( _event.mInstanceId );
+
         m_instanceTypeMap.erase( _event.mInstanceId );
 
         return !isFiltered;
@@ -330,12 +545,24 @@ namespace Op
         const auto instanceType         = getInstanceTypeFromID( _event.mInstanceId );
         const auto instanceTypeObject   = getInstanceTypeFromID( _event.mObjectRef );
         const auto propName             = lookupStringByHandle( _event.mProperty );
-        const bool isFiltered           = _filtering.isInstanceFiltered( _event.mObjectRef );
+        const bool isFiltered           = _filtering.isInstanceFiltered( _event.mObjectRef ) ||
+                                          _filtering.isInstanceFiltered( _event.mInstanceId );
+
+        // an owner that now only refers to filtered objects may need to go too
+        bool cascades = false;
+        if ( _filtering.cascadeEnabled() )
+        {
+            cascades = _filtering.m_references.addReference( _event.mInstanceId, _event.mProperty, _event.mObjectRef );
+            if ( cascades )
+                _filtering.dropInstance( _event.mInstanceId, true );
+        }
 
         if ( m_verboseLog != nullptr )
         {
             if ( isFiltered )
                 m_verboseLog->info( "== filtered ==" );
+            if ( cascades )
+                m_verboseLog->info( "== cascaded ==" );
 
             m_verboseLog->info( "mInstanceId     : {:#x} ({})", _event.mInstanceId, instanceType );
             m_verboseLog->info( "mPropertyName   : {}", propName );
@@ -349,7 +576,11 @@ namespace Op
     {
         const auto instanceType         = getInstanceTypeFromID( _event.mInstanceId );
         const auto propName             = lookupStringByHandle( _event.mProperty );
-        const bool isFiltered           = _filtering.isInstanceFiltered( _event.mObjectRef );
+        const bool isFiltered           = _filtering.isInstanceFiltered( _event.mObjectRef ) ||
+                                          _filtering.isInstanceFiltered( _event.mInstanceId );
+
+        if ( _filtering.cascadeEnabled() )
+            _filtering.m_references.removeReference( _event.mInstanceId, _event.mProperty, _event.mObjectRef );
 
         if ( m_verboseLog != nullptr )
         {
@@ -398,6 +629,10 @@ namespace Op
             m_verboseLog->info( "mTimestamp      : {}", _event.mTimestamp );
             m_verboseLog->info( "{:-^120}", "/\\" );
         }
+        if ( sectionName == "frame" )
+        {
+            _filtering.onFrameEnd();
+        }
 
         return true;
     }
@@ -495,4 +730,114 @@ namespace Op
 
         return true;
     }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool EventBreaker::rewriteEvent( FilterState& _filtering, physx::pvdsdk::SetPropertyValue& _event )
+    {
+        const auto action = _filtering.m_propertyRules.actionFor( _event.mInstanceId, _event.mPropertyName );
+        if ( action == PropertyAction::Keep )
+        {
+            // mesh geometry taken away for simplification is written back out later by the caller
+            if ( _filtering.m_meshSimplifier && !_filtering.m_meshSimplifier->rewrite( _event ) )
+                return false;
+
+            return !isUnchangedUpdate( _filtering, _event.mInstanceId, UpdateSuppressor::UpdateKind::Property, _event.mPropertyName, _event.mData );
+        }
+
+        _filtering.m_strippedPropertyEvents++;
+        _filtering.m_strippedPropertyBytes += _event.mData.size();
+
+        if ( m_verboseLog != nullptr )
+            m_verboseLog->info( ( action == PropertyAction::Strip ) ? "== stripped ==" : "== stubbed ==" );
+
+        if ( action == PropertyAction::Strip )
+            return false;
+
+        _event.mData = physx::pvdsdk::DataRef<const uint8_t>();
+        _event.mNumItems = 0;
+        return !isUnchangedUpdate( _filtering, _event.mInstanceId, UpdateSuppressor::UpdateKind::Property, _event.mPropertyName, _event.mData );
+    }
+
+    bool EventBreaker::rewriteEvent( FilterState& _filtering, physx::pvdsdk::BeginSetPropertyValue& _event )
+    {
+        // multi-part sets aren't compared, but they do make whatever we last saw for the property stale
+        if ( _filtering.m_updateSuppressor )
+            _filtering.m_updateSuppressor->invalidate( _event.mInstanceId, UpdateSuppressor::UpdateKind::Property, _event.mPropertyName );
+
+        // a stubbed sequence keeps its Begin / End pair but loses all the appended data in between
+        _filtering.m_activeSetPropertyAction = _filtering.m_propertyRules.actionFor( _event.mInstanceId, _event.mPropertyName );
+        if ( _filtering.m_activeSetPropertyAction != PropertyAction::Keep )
+            _filtering.m_strippedPropertyEvents++;
+
+        return ( _filtering.m_activeSetPropertyAction != PropertyAction::Strip );
+    }
+
+    bool EventBreaker::rewriteEvent( FilterState& _filtering, physx::pvdsdk::AppendPropertyValueData& _event )
+    {
+        if ( _filtering.m_activeSetPropertyAction == PropertyAction::Keep )
+            return true;
+
+        _filtering.m_strippedPropertyBytes += _event.mData.size();
+        return false;
+    }
+
+    bool EventBreaker::rewriteEvent( FilterState& _filtering, physx::pvdsdk::EndSetPropertyValue& _event )
+    {
+        const bool keep = ( _filtering.m_activeSetPropertyAction != PropertyAction::Strip );
+        _filtering.m_activeSetPropertyAction = PropertyAction::Keep;
+        return keep;
+    }
+
+    bool EventBreaker::rewriteEvent( FilterState& _filtering, physx::pvdsdk::SetPropertyMessage& _event )
+    {
+        const auto* ranges = _filtering.m_propertyRules.empty() ? nullptr : _filtering.m_propertyRules.messageRangesFor( _event.mMessageName );
+        if ( ranges == nullptr )
+            return !isUnchangedUpdate( _filtering, _event.mInstanceId, UpdateSuppressor::UpdateKind::Message, messageKey( _event.mMessageName ), _event.mData );
+
+        // messages are fixed layout blocks, so properties can't be removed from them - blank them out instead
+        const auto dataSize = _event.mData.size();
+        _filtering.m_messageScratch.assign( _event.mData.begin(), _event.mData.begin() + dataSize );
+
+        for ( const auto& range : *ranges )
+        {
+            if ( range.m_offset >= dataSize )
+                continue;
+
+            const auto clampedSize = std::min( range.m_size, dataSize - range.m_offset );
+            std::memset( _filtering.m_messageScratch.data() + range.m_offset, 0, clampedSize );
+            _filtering.m_strippedPropertyBytes += clampedSize;
+        }
+        _filtering.m_strippedPropertyEvents++;
+
+        _event.mData = physx::pvdsdk::DataRef<const uint8_t>( _filtering.m_messageScratch.data(), dataSize );
+        return !isUnchangedUpdate( _filtering, _event.mInstanceId, UpdateSuppressor::UpdateKind::Message, messageKey( _event.mMessageName ), _event.mData );
+    }
+
+    bool EventBreaker::rewriteEvent( FilterState& _filtering, physx::pvdsdk::SendPropertyMessageFromGroup& _event )
+    {
+        // grouped messages are never suppressed, but they still update the last-seen payload for any
+        // SetPropertyMessage that follows
+        if ( _filtering.m_updateSuppressor )
+            _filtering.m_updateSuppressor->isUnchanged( _event.mInstance, UpdateSuppressor::UpdateKind::Message, messageKey( _filtering.m_groupMessageName ), _event.mData.begin(), _event.mData.size() );
+
+        return true;
+    }
+
+    bool EventBreaker::isUnchangedUpdate( FilterState& _filtering, const uint64_t instanceID, const UpdateSuppressor::UpdateKind kind, const uint64_t name, const physx::pvdsdk::DataRef<const uint8_t>& data )
+    {
+        if ( !_filtering.m_updateSuppressor )
+            return false;
+
+        if ( !_filtering.m_updateSuppressor->isUnchanged( instanceID, kind, name, data.begin(), data.size() ) )
+            return false;
+
+        _filtering.m_suppressedUpdateEvents++;
+        _filtering.m_suppressedUpdateBytes += data.size();
+
+        if ( m_verboseLog != nullptr )
+            m_verboseLog->info( "== unchanged ==" );
+
+        return true;
+    }
+
 } // namespace Op
\ No newline at end of file
@@ -11,6 +11,13 @@
 #pragma once
 
 #include "common/OpMasterStringTable.h"
+#include "common/OpReferenceGraph.h"
+#include "common/OpPropertyRules.h"
+#include "common/OpUpdateSuppressor.h"
+#include "common/OpRegionFilter.h"
+#include "common/OpMeshSimplifier.h"
+#include "common/OpSizeBudget.h"
+#include "common/OpPayloadDeduplicator.h"
 
 namespace Op
 {
@@ -18,10 +25,74 @@ namespace Op
     {
         using InstanceSet = ankerl::unordered_dense::set< uint64_t >;
         using InstanceLimit = ankerl::unordered_dense::map < std::string, uint64_t >;
+        using ClassSet = ankerl::unordered_dense::set< std::string >;
 
         InstanceSet     m_filteredInstanceIDs;
         InstanceLimit   m_instanceLimits;
 
+        // per-class byte budgets, with the instances to drop already chosen by a scan of the input
+        std::unique_ptr< SizeBudget >   m_sizeBudget;
+
+        // instances of these classes are dropped along with the filtered objects they exist to use (or that exist
+        // only to be used by them); the reference graph is only maintained when this is non-empty
+        ClassSet        m_cascadeClasses;
+        ReferenceGraph  m_references;
+        uint64_t        m_cascadedInstanceCount = 0;
+
+        physx::pvdsdk::StreamNamespacedName     m_groupMessageName;             // of the active property message group
+
+        // instances that were dropped after their CreateInstance had already been written out leave behind these
+        // synthesized events, which the caller must emit (then clear) to keep the output stream consistent
+        std::vector< physx::pvdsdk::RemoveObjectRef >   m_pendingRemoveRefs;
+        std::vector< physx::pvdsdk::DestroyInstance >   m_pendingDestroys;
+
+        // ( class, property ) strip / stub rules, applied by EventBreaker::rewriteEvent()
+        PropertyRules   m_propertyRules;
+        PropertyAction  m_activeSetPropertyAction   = PropertyAction::Keep;    // for the current Begin/Append/End sequence
+        uint64_t        m_strippedPropertyBytes     = 0;
+        uint64_t        m_strippedPropertyEvents    = 0;
+        std::vector< uint8_t >  m_messageScratch;                               // rewritten SetPropertyMessage payload
+
+        // when set, property updates identical to the previous one for the same instance are dropped
+        std::unique_ptr< UpdateSuppressor >     m_updateSuppressor;
+        uint64_t        m_suppressedUpdateEvents    = 0;
+        uint64_t        m_suppressedUpdateBytes     = 0;
+
+        // when set, actors found outside the region at the end of a frame are dropped; new actors are held back by it
+        // until their first frame has been tested, and every kept event is offered to it by the caller first
+        std::unique_ptr< RegionFilter >         m_regionFilter;
+        uint64_t        m_regionDroppedInstances    = 0;
+
+        // when set, triangle mesh geometry is rebuilt at a lower density off the main thread; the caller drains the
+        // finished meshes back into the output between events
+        std::unique_ptr< MeshSimplifier >       m_meshSimplifier;
+
+        // when set, geometry instances with identical contents are folded into one; every kept event is offered to
+        // it by the caller before being rewritten
+        std::unique_ptr< PayloadDeduplicator >  m_deduplicator;
+
+
+        inline bool cascadeEnabled() const
+        {
+            return !m_cascadeClasses.empty();
+        }
+
+        // filter an instance that may already have been written out, cascading through the reference graph
+        void dropInstance( const uint64_t instanceID, const bool alreadyWritten );
+
+        // end of a frame; apply any decisions that are made per-frame
+        void onFrameEnd();
+
+        inline bool hasPendingEvents() const
+        {
+            return !m_pendingRemoveRefs.empty() || !m_pendingDestroys.empty();
+        }
+
+        inline void clearPendingEvents()
+        {
+            m_pendingRemoveRefs.clear();
+            m_pendingDestroys.clear();
+        }
 
         void addInstance( const uint64_t instanceID )
         {
@@ -37,6 +108,16 @@ namespace Op
         {
             m_filteredInstanceIDs.erase( instanceID );
         }
+
+    private:
+
+        std::vector< uint64_t >     m_regionScratch;
+        std::vector< uint64_t >     m_regionWithheldScratch;
+
+        // queue the events that retract an already-written instance from the output
+        void retractInstance( const uint64_t instanceID );
+
+        std::vector< uint64_t >     m_cascadeScratch;
     };
 
     struct EventBreaker : public MasterStringTable
@@ -64,6 +145,7 @@ namespace Op
         }
 
         void logSummary();
+        void logFilterSummary( const FilterState& _filtering );
 
         inline std::string getInstanceTypeFromID( const uint64_t id ) const
         {
@@ -104,5 +186,30 @@ namespace Op
         bool handleEvent( FilterState& _filtering, const physx::pvdsdk::EventGroup& _group, const physx::pvdsdk::StreamEndEvent& _event );
         bool handleEvent( FilterState& _filtering, const physx::pvdsdk::EventGroup& _group, const physx::pvdsdk::ErrorMessage& _event );
         bool handleEvent( FilterState& _filtering, const physx::pvdsdk::EventGroup& _group, const physx::pvdsdk::OriginShift& _event );
+
+        // called for events that handleEvent() chose to keep, giving the filter a chance to modify them before they are
+        // written out; returns false if the event should be dropped after all
+        bool rewriteEvent( FilterState& _filtering, physx::pvdsdk::SetPropertyValue& _event );
+        bool rewriteEvent( FilterState& _filtering, physx::pvdsdk::BeginSetPropertyValue& _event );
+        bool rewriteEvent( FilterState& _filtering, physx::pvdsdk::AppendPropertyValueData& _event );
+        bool rewriteEvent( FilterState& _filtering, physx::pvdsdk::EndSetPropertyValue& _event );
+        bool rewriteEvent( FilterState& _filtering, physx::pvdsdk::SetPropertyMessage& _event );
+        bool rewriteEvent( FilterState& _filtering, physx::pvdsdk::SendPropertyMessageFromGroup& _event );
+
+        template< typename TEvent >
+        inline bool rewriteEvent( FilterState& _filtering, TEvent& _event )
+        {
+            return true;
+        }
+
+    private:
+
+        // true if update suppression is enabled and this payload matches the last one for the same key
+        bool isUnchangedUpdate( FilterState& _filtering, const uint64_t instanceID, const UpdateSuppressor::UpdateKind kind, const uint64_t name, const physx::pvdsdk::DataRef<const uint8_t>& data );
+
+        static inline uint64_t messageKey( const physx::pvdsdk::StreamNamespacedName& messageName )
+        {
+            return ( static_cast<uint64_t>( messageName.mNamespace ) << 32 ) | messageName.mName;
+        }
     };
 }
\ No newline at end of file
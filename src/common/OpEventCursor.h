@@ -0,0 +1,273 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// pull-based iteration over a PXD2 stream for tools that just want to consume decoded events without writing a
+// handler for every single type; each call to next() fills a caller-owned EventView with the group header, the
+// event type and the decoded event itself stored in a std::variant. Dynamic data (strings, DataRef payloads) lives
+// in the decoder's arena and is only valid until the following call to next()
+//
+//  Op::EventCursor< physx::PsFileBuffer > cursor( fileBuffer );
+//  cursor.readInitialization( init );
+//
+//  Op::EventView view;
+//  while ( cursor.next( view ) )
+//  {
+//      if ( const auto* createInstance = view.as< pvd::CreateInstance >() )
+//          ...
+//  }
+//
+// Reading through a BlockReader, a cursor can be given a StreamResync; it then recovers from corrupt input exactly
+// as opvd-filter --resync does, so a pre-pass over the same capture sees the same events the filtering pass will
+//
+
+#pragma once
+
+#include "common/OpEventDecoder.h"
+#include "common/OpStreamResync.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    // one alternative per PVD event type, in the same order as PvdEventType - so variant::index() == (size_t)PvdEventType,
+    // with std::monostate filling the Unknown slot
+    using PvdEventVariant = std::variant< std::monostate,
+#define DECLARE_PVD_COMM_STREAM_EVENT(x) pvd::x,
+#define DECLARE_PVD_COMM_STREAM_EVENT_NO_COMMA(x) pvd::x
+        DECLARE_COMM_STREAM_EVENTS
+#undef DECLARE_PVD_COMM_STREAM_EVENT_NO_COMMA
+#undef DECLARE_PVD_COMM_STREAM_EVENT
+    >;
+
+    static_assert( std::variant_size_v< PvdEventVariant > == static_cast<std::size_t>( PvdEventType::Last ), "PvdEventVariant out of sync with PvdEventType" );
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    struct EventView
+    {
+        pvd::EventGroup     m_group;                                // header of the group this event was read from
+        uint32_t            m_indexInGroup  = 0;                    // which event within that group (usually 0)
+        PvdEventType        m_type          = PvdEventType::Unknown;
+        PvdEventVariant     m_event;
+
+        template< typename TEvent >
+        [[nodiscard]] inline const TEvent* as() const
+        {
+            return std::get_if< TEvent >( &m_event );
+        }
+
+        template< typename TEvent >
+        [[nodiscard]] inline TEvent* as()
+        {
+            return std::get_if< TEvent >( &m_event );
+        }
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    template <typename TStreamType>
+    class EventCursor
+    {
+    public:
+
+        explicit EventCursor( TStreamType& stream )
+            : m_decoder( stream )
+        {
+        }
+
+        // read and validate the stream header; must be called once before iterating with next()
+        bool readInitialization( pvd::StreamInitialization& init )
+        {
+            m_decoder.decode( init );
+
+            if ( init.mStreamId != pvd::StreamInitialization::getStreamId() )
+            {
+                spdlog::error( "stream ID invalid; got {}, expected {}", init.mStreamId, pvd::StreamInitialization::getStreamId() );
+                m_failed = true;
+            }
+            else if ( init.mStreamVersion != pvd::StreamInitialization::getStreamVersion() )
+            {
+                spdlog::error( "stream version invalid; got {}, expected {}", init.mStreamVersion, pvd::StreamInitialization::getStreamVersion() );
+                m_failed = true;
+            }
+            return !m_failed;
+        }
+
+        // skip over corrupt input rather than failing on it; only available when reading through a BlockReader
+        void setResync( StreamResync* resync )
+        {
+            static_assert( std::is_same_v< TStreamType, BlockReader >, "resynchronising needs a BlockReader" );
+            m_resync = resync;
+        }
+
+        // decode the next event into _view; returns false at the end of the stream or if the stream could not be decoded
+        bool next( EventView& _view )
+        {
+            if ( m_failed || m_finished )
+                return false;
+
+            m_decoder.releaseEventData();
+
+            for ( ;; )
+            {
+                if ( m_eventsLeftInGroup == 0 )
+                {
+                    // a corrupt length inside an event body leaves decoding off the end of its group (or short of it)
+                    if ( m_groupOpen )
+                    {
+                        m_groupOpen = false;
+                        if ( m_resync != nullptr && streamPosition() != groupEnd() )
+                        {
+                            if ( !recover( m_groupStart, nullptr, 0 ) )
+                                return false;
+                        }
+                    }
+
+                    m_groupStart = streamPosition();
+                    m_decoder.decode( m_group );
+
+                    if ( m_resync != nullptr && StreamResync::implausibleGroup( m_group ) )
+                    {
+                        uint8_t consumed[StreamResync::cGroupHeaderSize];
+                        StreamResync::serializeGroup( m_group, consumed );
+                        if ( !recover( m_groupStart, consumed, sizeof( consumed ) ) )
+                            return false;
+                        continue;
+                    }
+
+                    // no events seems to signify the end of a stream
+                    if ( m_group.mNumEvents == 0 )
+                    {
+                        m_finished = true;
+                        return false;
+                    }
+                    m_eventsLeftInGroup = m_group.mNumEvents;
+                    m_groupOpen         = true;
+                    m_lastTimestamp     = m_group.mTimestamp;
+                }
+
+                _view.m_group        = m_group;
+                _view.m_indexInGroup = m_group.mNumEvents - m_eventsLeftInGroup;
+                m_eventsLeftInGroup--;
+
+                m_decoder.decode( _view.m_type );
+
+                bool bKnownType = true;
+                switch ( _view.m_type )
+                {
+#define DECLARE_PVD_COMM_STREAM_EVENT(x)            case PvdEventType::x:                       \
+                    m_decoder.decode( _view.m_event.template emplace< pvd::x >() );             \
+                    break;
+#define DECLARE_PVD_COMM_STREAM_EVENT_NO_COMMA(x)   DECLARE_PVD_COMM_STREAM_EVENT(x)
+                    DECLARE_COMM_STREAM_EVENTS
+#undef DECLARE_PVD_COMM_STREAM_EVENT_NO_COMMA
+#undef DECLARE_PVD_COMM_STREAM_EVENT
+
+                default:
+                    bKnownType = false;
+                    break;
+                }
+
+                if ( !bKnownType )
+                {
+                    _view.m_event.template emplace< std::monostate >();
+                    if ( m_resync == nullptr )
+                    {
+                        spdlog::error( "Unhandled Event : {}", (int32_t)_view.m_type );
+                        m_failed = true;
+                        return false;
+                    }
+
+                    // a bad first event condemns its group header too; further into a group, only the type byte
+                    // itself is known to be bad
+                    bool bRecovered;
+                    if ( _view.m_indexInGroup == 0 )
+                    {
+                        uint8_t consumed[StreamResync::cProbeSize];
+                        StreamResync::serializeGroup( m_group, consumed );
+                        consumed[StreamResync::cGroupHeaderSize] = static_cast<uint8_t>( _view.m_type );
+                        bRecovered = recover( m_groupStart, consumed, sizeof( consumed ) );
+                    }
+                    else
+                    {
+                        const uint8_t consumed = static_cast<uint8_t>( _view.m_type );
+                        bRecovered = recover( streamPosition() - 1, &consumed, 1 );
+                    }
+                    if ( !bRecovered )
+                        return false;
+                    continue;
+                }
+
+                if ( m_decoder.overran() )
+                {
+                    if ( m_resync == nullptr )
+                    {
+                        spdlog::error( "event {} in its group claims more data than the group holds", _view.m_indexInGroup );
+                        m_failed = true;
+                        return false;
+                    }
+                    if ( !recover( m_groupStart, nullptr, 0 ) )
+                        return false;
+                    continue;
+                }
+
+                m_eventsRead++;
+                return true;
+            }
+        }
+
+        [[nodiscard]] inline bool     failed() const        { return m_failed; }
+        [[nodiscard]] inline bool     finished() const      { return m_finished; }
+        [[nodiscard]] inline uint64_t eventsRead() const    { return m_eventsRead; }
+
+        // access to the underlying decoder, eg. to read raw data from the stream directly
+        [[nodiscard]] inline EventDecoder< TStreamType >& decoder() { return m_decoder; }
+
+    private:
+
+        // only meaningful with a resync set, ie. when reading through a BlockReader
+        inline uint64_t streamPosition()
+        {
+            if constexpr ( std::is_same_v< TStreamType, BlockReader > )
+                return m_decoder.mBuffer.position();
+            else
+                return 0;
+        }
+
+        inline uint64_t groupEnd() const
+        {
+            return m_groupStart + StreamResync::cGroupHeaderSize + m_group.mDataSize;
+        }
+
+        // skip to the next plausible group; if there isn't one, the stream is over
+        bool recover( const uint64_t corruptStart, const uint8_t* consumed, const std::size_t consumedSize )
+        {
+            m_eventsLeftInGroup = 0;
+            m_groupOpen         = false;
+
+            if constexpr ( std::is_same_v< TStreamType, BlockReader > )
+            {
+                m_decoder.releaseEventData();
+                if ( m_resync->resync( m_decoder.mBuffer, corruptStart, consumed, consumedSize, m_lastTimestamp ) )
+                    return true;
+            }
+
+            m_finished = true;
+            return false;
+        }
+
+        EventDecoder< TStreamType >     m_decoder;
+        pvd::EventGroup                 m_group;
+        uint32_t                        m_eventsLeftInGroup = 0;
+        uint64_t                        m_eventsRead        = 0;
+        bool                            m_failed            = false;
+        bool                            m_finished          = false;
+
+        StreamResync*                   m_resync            = nullptr;
+        uint64_t                        m_groupStart        = 0;
+        uint64_t                        m_lastTimestamp     = 0;
+        bool                            m_groupOpen         = false;
+    };
+
+} // namespace Op
@@ -0,0 +1,310 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// EventUnpacker drives the PVD types' own serialize() functions, which costs a virtual streamify() call and a
+// separate stream read for every scalar field. EventDecoder instead knows the wire layout of the hot event types
+// at compile time; each run of fixed-size fields is pulled with a single read into a stack staging buffer and
+// unpacked with memcpy, only branching out for the variable-length String / DataRef members. Arrays whose wire
+// layout matches their in-memory layout are bulk-read in one go.
+//
+// Rarely seen events fall back to the original serialize() path through an embedded EventUnpacker.
+//
+
+#pragma once
+
+#include <limits>
+
+#include "common/OpEventUnpacker.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    // how a field is represented on the wire; by default a straight copy of its bytes, with the exceptions being the
+    // types that PvdEventSerializer narrows down to a single byte
+    template< typename TField >
+    struct WireField
+    {
+        static_assert( std::is_trivially_copyable_v< TField >, "wire fields must be trivially copyable" );
+
+        static constexpr std::size_t cSize = sizeof( TField );
+
+        static inline void load( TField& field, const uint8_t* source )
+        {
+            std::memcpy( &field, source, sizeof( TField ) );
+        }
+    };
+
+    template<>
+    struct WireField< bool >
+    {
+        static constexpr std::size_t cSize = 1;
+
+        static inline void load( bool& field, const uint8_t* source )
+        {
+            field = ( source[0] != 0 );
+        }
+    };
+
+    template<>
+    struct WireField< pvd::PropertyType::Enum >
+    {
+        static constexpr std::size_t cSize = 1;
+
+        static inline void load( pvd::PropertyType::Enum& field, const uint8_t* source )
+        {
+            field = static_cast<pvd::PropertyType::Enum>( source[0] );
+        }
+    };
+
+    // arrays that get bulk-read straight into memory rely on the structures having no padding
+    static_assert( sizeof( pvd::StringHandle ) == 4,                "unexpected StringHandle layout" );
+    static_assert( sizeof( pvd::StreamNamespacedName ) == 8,        "unexpected StreamNamespacedName layout" );
+    static_assert( sizeof( pvd::NameHandleValue ) == 8,             "unexpected NameHandleValue layout" );
+    static_assert( sizeof( pvd::StreamPropMessageArg ) == 20,       "unexpected StreamPropMessageArg layout" );
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    template <typename TStreamType>
+    struct EventDecoder
+    {
+        TStreamType&                    mBuffer;
+        Arena                           m_allocations;
+        EventUnpacker< TStreamType >    m_fallback;         // for events without a specialised decode()
+        uint32_t                        m_groupBytesLeft;   // upper bound on what is left of the current group's data
+        bool                            m_bOverran;         // a length prefix claimed more than the group had left
+
+        EventDecoder( TStreamType& buf )
+            : mBuffer( buf )
+            , m_fallback( buf )
+            , m_groupBytesLeft( std::numeric_limits< uint32_t >::max() )
+            , m_bOverran( false )
+        {
+        }
+
+        // true if a length prefix read since the last group header ran past the end of the group; the oversized
+        // data was not read, so the stream position is no longer at an event boundary
+        [[nodiscard]] inline bool overran() const { return m_bOverran; }
+
+        // dynamic data (strings, DataRef contents) of any previously decoded events is invalid after calling this
+        inline void releaseEventData()
+        {
+            m_allocations.reset();
+            m_fallback.releaseEventData();
+        }
+
+        // read a run of fixed-size fields with a single stream read; sizes and offsets are resolved at compile time
+        template< typename... TFields >
+        inline void readFixed( TFields&... fields )
+        {
+            constexpr std::size_t cTotalSize = ( WireField< TFields >::cSize + ... );
+
+            uint8_t staging[cTotalSize];
+            mBuffer.read( staging, static_cast<uint32_t>( cTotalSize ) );
+            consumeGroupBytes( static_cast<uint32_t>( cTotalSize ) );
+
+            const uint8_t* cursor = staging;
+            ( ( WireField< TFields >::load( fields, cursor ), cursor += WireField< TFields >::cSize ), ... );
+        }
+
+        inline void consumeGroupBytes( const uint32_t amount )
+        {
+            m_groupBytesLeft = ( m_groupBytesLeft > amount ) ? ( m_groupBytesLeft - amount ) : 0;
+        }
+
+        // a corrupt length prefix would otherwise have us allocate and read gigabytes; nothing inside a group can be
+        // larger than what the group header says is left of it
+        [[nodiscard]] inline bool claimGroupBytes( const uint64_t amount )
+        {
+            if ( amount > m_groupBytesLeft )
+            {
+                m_bOverran = true;
+                return false;
+            }
+            m_groupBytesLeft -= static_cast<uint32_t>( amount );
+            return true;
+        }
+
+        inline void readString( pvd::String& val )
+        {
+            uint32_t len = 0;
+            readFixed( len );
+
+            if ( !claimGroupBytes( len ) )
+            {
+                val = "";
+                return;
+            }
+
+            char* newVal = m_allocations.allocate< char >( len );
+            mBuffer.read( newVal, len );
+            val = newVal;
+        }
+
+        inline void readData( pvd::DataRef<const uint8_t>& data )
+        {
+            uint32_t amount = 0;
+            readFixed( amount );
+
+            if ( amount == 0 || !claimGroupBytes( amount ) )
+            {
+                data = pvd::DataRef<const uint8_t>();
+                return;
+            }
+
+            uint8_t* dataIn = m_allocations.allocate< uint8_t >( amount );
+            mBuffer.read( dataIn, amount );
+
+            data = pvd::DataRef<const uint8_t>( dataIn, amount );
+        }
+
+        // only valid for types whose wire representation is identical to their memory layout
+        template< typename TDataType >
+        inline void readArray( pvd::DataRef<TDataType>& data )
+        {
+            uint32_t amount = 0;
+            readFixed( amount );
+
+            if ( amount == 0 || !claimGroupBytes( static_cast<uint64_t>( amount ) * sizeof( TDataType ) ) )
+            {
+                data = pvd::DataRef<TDataType>();
+                return;
+            }
+
+            TDataType* dataIn = m_allocations.allocate< TDataType >( amount );
+            mBuffer.read( dataIn, static_cast<uint32_t>( amount * sizeof( TDataType ) ) );
+
+            data = pvd::DataRef<TDataType>( dataIn, amount );
+        }
+
+        // -----------------------------------------------------------------------------------------------------------------
+
+        inline void decode( PvdEventType& val )
+        {
+            uint8_t detyped = 0;
+            readFixed( detyped );
+            val = static_cast<PvdEventType>( detyped );
+        }
+
+        inline void decode( pvd::EventGroup& ev )
+        {
+            readFixed( ev.mDataSize, ev.mNumEvents, ev.mStreamId, ev.mTimestamp );
+
+            m_groupBytesLeft = ev.mDataSize;
+            m_bOverran       = false;
+        }
+
+        inline void decode( pvd::StringHandleEvent& ev )
+        {
+            readString( ev.mString );
+            readFixed( ev.mHandle );
+        }
+
+        inline void decode( pvd::CreateClass& ev )
+        {
+            readFixed( ev.mName );
+        }
+
+        inline void decode( pvd::DeriveClass& ev )
+        {
+            readFixed( ev.mParent, ev.mChild );
+        }
+
+        inline void decode( pvd::CreateProperty& ev )
+        {
+            readFixed( ev.mClass, ev.mName, ev.mSemantic, ev.mDatatypeName, ev.mPropertyType );
+            readArray( ev.mValues );
+        }
+
+        inline void decode( pvd::CreatePropertyMessage& ev )
+        {
+            readFixed( ev.mClass, ev.mMessageName );
+            readArray( ev.mMessageEntries );
+            readFixed( ev.mMessageByteSize );
+        }
+
+        inline void decode( pvd::CreateInstance& ev )
+        {
+            readFixed( ev.mClass, ev.mInstanceId );
+        }
+
+        inline void decode( pvd::SetPropertyValue& ev )
+        {
+            readFixed( ev.mInstanceId, ev.mPropertyName, ev.mIncomingTypeName, ev.mNumItems );
+            readData( ev.mData );
+        }
+
+        inline void decode( pvd::BeginSetPropertyValue& ev )
+        {
+            readFixed( ev.mInstanceId, ev.mPropertyName, ev.mIncomingTypeName );
+        }
+
+        inline void decode( pvd::AppendPropertyValueData& ev )
+        {
+            readData( ev.mData );
+            readFixed( ev.mNumItems );
+        }
+
+        inline void decode( pvd::EndSetPropertyValue& )
+        {
+        }
+
+        inline void decode( pvd::SetPropertyMessage& ev )
+        {
+            readFixed( ev.mInstanceId, ev.mMessageName );
+            readData( ev.mData );
+        }
+
+        inline void decode( pvd::BeginPropertyMessageGroup& ev )
+        {
+            readFixed( ev.mMsgName );
+        }
+
+        inline void decode( pvd::SendPropertyMessageFromGroup& ev )
+        {
+            readFixed( ev.mInstance );
+            readData( ev.mData );
+        }
+
+        inline void decode( pvd::EndPropertyMessageGroup& )
+        {
+        }
+
+        inline void decode( pvd::DestroyInstance& ev )
+        {
+            readFixed( ev.mInstanceId );
+        }
+
+        inline void decode( pvd::PushBackObjectRef& ev )
+        {
+            readFixed( ev.mInstanceId, ev.mProperty, ev.mObjectRef );
+        }
+
+        inline void decode( pvd::RemoveObjectRef& ev )
+        {
+            readFixed( ev.mInstanceId, ev.mProperty, ev.mObjectRef );
+        }
+
+        inline void decode( pvd::BeginSection& ev )
+        {
+            readFixed( ev.mSectionId, ev.mName, ev.mTimestamp );
+        }
+
+        inline void decode( pvd::EndSection& ev )
+        {
+            readFixed( ev.mSectionId, ev.mName, ev.mTimestamp );
+        }
+
+        // everything else is rare enough to go through the generic serializer
+        template< typename TEvent >
+        inline void decode( TEvent& ev )
+        {
+            ev.serialize( m_fallback );
+        }
+
+        EventDecoder& operator=( const EventDecoder& ) = delete;
+    };
+
+} // namespace Op
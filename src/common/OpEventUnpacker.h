@@ -21,6 +21,8 @@
 #include "PxPvdCommStreamEvents.h"
 #include "PxPvdCommStreamTypes.h"
 
+#include "common/OpArena.h"
+
 namespace pvd = physx::pvdsdk;
 
 namespace Op
@@ -50,6 +52,16 @@ namespace Op
         return "<unknown>";
     }
 
+    // map from a PVD event structure back to its PvdEventType, eg. EventTypeOf< pvd::CreateInstance >::cType
+    template< typename TEvent >
+    struct EventTypeOf;
+
+#define DECLARE_PVD_COMM_STREAM_EVENT(x) template<> struct EventTypeOf< pvd::x > { static constexpr PvdEventType cType = PvdEventType::x; };
+#define DECLARE_PVD_COMM_STREAM_EVENT_NO_COMMA(x) DECLARE_PVD_COMM_STREAM_EVENT(x)
+    DECLARE_COMM_STREAM_EVENTS
+#undef DECLARE_PVD_COMM_STREAM_EVENT_NO_COMMA
+#undef DECLARE_PVD_COMM_STREAM_EVENT
+
     // used to check if a resolved event is actually known 
     inline bool eventTypeValid( const PvdEventType evt )
     {
@@ -71,16 +83,13 @@ namespace Op
     struct EventUnpacker : public pvd::PvdEventSerializer
     {
         std::size_t             m_allocatedMemorySize = 0;
-        std::vector< void* >    m_allocations;
+        Arena                   m_allocations;
 
         template< typename _mType >
         inline _mType* allocate( std::size_t quantity )
         {
             m_allocatedMemorySize += sizeof( _mType ) * quantity;
-            void* newAlloc = _aligned_malloc( sizeof( _mType ) * quantity, 16 );
-            m_allocations.push_back( newAlloc );
-
-            return (_mType*)newAlloc;
+            return m_allocations.allocate< _mType >( quantity );
         }
 
         TStreamType& mBuffer;
@@ -88,7 +97,11 @@ namespace Op
         {
         }
 
-        // TODO deallocate from m_allocations
+        // dynamic data (strings, DataRef contents) of any previously decoded events is invalid after calling this
+        inline void releaseEventData()
+        {
+            m_allocations.reset();
+        }
 
         template <typename TDataType>
         void read( TDataType& type )
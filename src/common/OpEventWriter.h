@@ -0,0 +1,123 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// writes events back out to a PVD transport, each wrapped in its own single-event group. The event is serialised
+// into a scratch buffer first so the group header always carries the correct mDataSize - which matters as soon as
+// events are dropped out of multi-event groups, rewritten or synthesized from scratch by the filters
+//
+
+#pragma once
+
+#include "common/OpEventUnpacker.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    // growable in-memory sink with the write() signature EventStreamifier expects
+    struct MemoryStream
+    {
+        std::vector< uint8_t >  m_data;
+
+        inline uint32_t write( const uint8_t* source, const uint32_t size )
+        {
+            m_data.insert( m_data.end(), source, source + size );
+            return size;
+        }
+
+        inline void clear() { m_data.clear(); }
+        [[nodiscard]] inline uint32_t size() const { return static_cast<uint32_t>( m_data.size() ); }
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // a run of events stored in their wire form (type byte + body) back to back, for filters that need to hold on to
+    // events beyond the lifetime of the decoder's arena
+    struct EncodedEvents
+    {
+        MemoryStream                m_bytes;
+        std::vector< uint32_t >     m_ends;         // end offset of each event within m_bytes
+
+        template< typename TEvent >
+        void append( TEvent& _event )
+        {
+            pvd::EventStreamifier< MemoryStream > streamifier( m_bytes );
+
+            const auto u8EventType = static_cast<uint8_t>( EventTypeOf< TEvent >::cType );
+            streamifier.write( u8EventType );
+            _event.serialize( streamifier );
+
+            m_ends.push_back( m_bytes.size() );
+        }
+
+        inline void clear()
+        {
+            m_bytes.clear();
+            m_ends.clear();
+        }
+
+        [[nodiscard]] inline bool empty() const { return m_ends.empty(); }
+        [[nodiscard]] inline std::size_t count() const { return m_ends.size(); }
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    class EventWriter
+    {
+    public:
+
+        explicit EventWriter( physx::PxPvdTransport& transport )
+            : m_transport( transport )
+        {
+        }
+
+        // _sourceGroup provides the stream id and timestamp to stamp on the new group header
+        template< typename TEvent >
+        void write( const pvd::EventGroup& _sourceGroup, TEvent& _event )
+        {
+            m_scratch.clear();
+            m_scratch.append( _event );
+
+            writeEncoded( _sourceGroup, m_scratch.m_bytes.m_data.data(), m_scratch.m_bytes.size() );
+        }
+
+        // write out every event of an encoded run, each in its own group
+        void writeEncoded( const pvd::EventGroup& _sourceGroup, const EncodedEvents& _events )
+        {
+            uint32_t begin = 0;
+            for ( const uint32_t end : _events.m_ends )
+            {
+                writeEncoded( _sourceGroup, _events.m_bytes.m_data.data() + begin, end - begin );
+                begin = end;
+            }
+        }
+
+        [[nodiscard]] inline uint64_t eventsWritten() const { return m_eventsWritten; }
+
+        EventWriter& operator=( const EventWriter& ) = delete;
+
+    private:
+
+        // eventBytes is a single event in wire form, including its leading type byte
+        void writeEncoded( const pvd::EventGroup& _sourceGroup, const uint8_t* eventBytes, const uint32_t eventSize )
+        {
+            pvd::EventGroup group;
+            group.mDataSize     = eventSize;
+            group.mNumEvents    = 1;
+            group.mStreamId     = _sourceGroup.mStreamId;
+            group.mTimestamp    = _sourceGroup.mTimestamp;
+
+            pvd::EventStreamifier< physx::PxPvdTransport > streamOut( m_transport );
+            group.serialize( streamOut );
+            m_transport.write( eventBytes, eventSize );
+
+            m_eventsWritten++;
+        }
+
+        physx::PxPvdTransport&                  m_transport;
+        EncodedEvents                           m_scratch;
+        uint64_t                                m_eventsWritten = 0;
+    };
+
+} // namespace Op
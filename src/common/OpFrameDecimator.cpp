@@ -0,0 +1,213 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpFrameDecimator.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    void FrameDecimator::onFrame( const uint64_t frame )
+    {
+        if ( !enabled() || frame == m_frame )
+            return;
+
+        m_frame = frame;
+        if ( m_frame == 0 )
+            return;
+
+        if ( m_firstFrame == 0 )
+            m_firstFrame = m_frame;
+
+        m_skipping = ( ( m_frame - m_firstFrame ) % m_interval ) != 0;
+
+        if ( !m_skipping && !m_pending.empty() )
+            m_flushDue = true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    EncodedEvents& FrameDecimator::replacePending( const PendingKey& key )
+    {
+        auto [it, inserted] = m_pending.try_emplace( key );
+        if ( inserted )
+            m_pendingByInstance[key.m_instance].push_back( key );
+        else
+            it->second.m_events.clear();
+
+        // a replaced value moves to the back of the queue, behind anything set since its previous value
+        it->second.m_sequence = m_nextSequence++;
+
+        m_deferredEvents++;
+        return it->second.m_events;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::SetPropertyValue& _event )
+    {
+        if ( !m_skipping )
+            return false;
+
+        replacePending( { _event.mInstanceId, _event.mPropertyName, PendingKind::Property } ).append( _event );
+        return true;
+    }
+
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::BeginSetPropertyValue& _event )
+    {
+        m_sequenceActive = m_skipping;
+        if ( !m_sequenceActive )
+            return false;
+
+        m_sequenceKey = { _event.mInstanceId, _event.mPropertyName, PendingKind::Property };
+        replacePending( m_sequenceKey ).append( _event );
+        return true;
+    }
+
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::AppendPropertyValueData& _event )
+    {
+        // sequences are deferred (or not) as a whole, based on where they began
+        if ( !m_sequenceActive )
+            return false;
+
+        if ( auto it = m_pending.find( m_sequenceKey ); it != m_pending.end() )
+            it->second.m_events.append( _event );
+        return true;
+    }
+
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::EndSetPropertyValue& _event )
+    {
+        if ( !m_sequenceActive )
+            return false;
+
+        if ( auto it = m_pending.find( m_sequenceKey ); it != m_pending.end() )
+            it->second.m_events.append( _event );
+
+        m_sequenceActive = false;
+        return true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::SetPropertyMessage& _event )
+    {
+        if ( !m_skipping )
+            return false;
+
+        const uint64_t messageKey = ( static_cast<uint64_t>( _event.mMessageName.mNamespace ) << 32 ) | _event.mMessageName.mName;
+        replacePending( { _event.mInstanceId, messageKey, PendingKind::Message } ).append( _event );
+        return true;
+    }
+
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::BeginPropertyMessageGroup& _event )
+    {
+        m_groupMessageName = _event.mMsgName;
+        return m_skipping;
+    }
+
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::SendPropertyMessageFromGroup& _event )
+    {
+        if ( !m_skipping )
+            return false;
+
+        // grouped messages get coalesced as standalone SetPropertyMessage events
+        pvd::SetPropertyMessage message;
+        message.mInstanceId  = _event.mInstance;
+        message.mMessageName = m_groupMessageName;
+        message.mData        = _event.mData;
+
+        return defer( _group, message );
+    }
+
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::EndPropertyMessageGroup& _event )
+    {
+        return m_skipping;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::SetIsTopLevel& _event )
+    {
+        if ( !m_skipping )
+            return false;
+
+        replacePending( { _event.mInstanceId, static_cast<uint64_t>( PvdEventType::SetIsTopLevel ), PendingKind::Attribute } ).append( _event );
+        return true;
+    }
+
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::SetPickable& _event )
+    {
+        if ( !m_skipping )
+            return false;
+
+        replacePending( { _event.mInstanceId, static_cast<uint64_t>( PvdEventType::SetPickable ), PendingKind::Attribute } ).append( _event );
+        return true;
+    }
+
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::SetColor& _event )
+    {
+        if ( !m_skipping )
+            return false;
+
+        replacePending( { _event.mInstanceId, static_cast<uint64_t>( PvdEventType::SetColor ), PendingKind::Attribute } ).append( _event );
+        return true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::BeginSection& _event )
+    {
+        if ( m_skipping )
+            m_droppedSections++;
+
+        return m_skipping;
+    }
+
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::EndSection& _event )
+    {
+        return m_skipping;
+    }
+
+    bool FrameDecimator::defer( const pvd::EventGroup& _group, pvd::DestroyInstance& _event )
+    {
+        // anything still pending for a destroyed instance is now moot; the destroy itself always passes through
+        if ( const auto it = m_pendingByInstance.find( _event.mInstanceId ); it != m_pendingByInstance.end() )
+        {
+            for ( const auto& key : it->second )
+                m_pending.erase( key );
+
+            m_pendingByInstance.erase( it );
+        }
+        return false;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void FrameDecimator::flush( EventWriter* _writer, const pvd::EventGroup& _group )
+    {
+        if ( _writer != nullptr )
+        {
+            // the map's iteration order says nothing about when values were set; a later update to one field may
+            // depend on (or override) an earlier one to another, eg. a property message after a property value
+            m_flushOrder.clear();
+            for ( const auto& pending : m_pending )
+                m_flushOrder.push_back( &pending.second );
+
+            std::sort( m_flushOrder.begin(), m_flushOrder.end(), []( const PendingValue* lhs, const PendingValue* rhs )
+                {
+                    return lhs->m_sequence < rhs->m_sequence;
+                });
+
+            for ( const PendingValue* pending : m_flushOrder )
+            {
+                _writer->writeEncoded( _group, pending->m_events );
+                m_flushedEvents += pending->m_events.count();
+            }
+        }
+
+        m_pending.clear();
+        m_pendingByInstance.clear();
+        m_flushDue = false;
+    }
+
+} // namespace Op
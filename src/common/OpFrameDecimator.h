@@ -0,0 +1,137 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// temporal decimation; only every Nth frame section is written out. Structural events inside the skipped frames
+// (instance creation / destruction, object references, definitions) still pass straight through so lifetimes stay
+// intact, but property updates are held back in a pending table keyed by ( instance, property ) that only keeps
+// the most recent value. The table is flushed just after the next kept frame opens, in the order the surviving
+// values were set, so each kept frame shows the scene exactly as it stood at that point
+//
+
+#pragma once
+
+#include "common/OpEventWriter.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class FrameDecimator
+    {
+    public:
+
+        explicit FrameDecimator( const uint32_t interval )
+            : m_interval( interval )
+        {
+        }
+
+        [[nodiscard]] inline bool enabled() const { return m_interval > 1; }
+
+        // track the frame counter; frame 0 is everything before the first frame section, which is always kept. The
+        // first frame seen is the first one kept, with every m_interval'th after it
+        void onFrame( const uint64_t frame );
+
+        // returns true if the event was swallowed - either dropped outright or deferred until the next kept frame
+        bool defer( const pvd::EventGroup& _group, pvd::SetPropertyValue& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::BeginSetPropertyValue& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::AppendPropertyValueData& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::EndSetPropertyValue& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::SetPropertyMessage& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::BeginPropertyMessageGroup& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::SendPropertyMessageFromGroup& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::EndPropertyMessageGroup& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::SetIsTopLevel& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::SetPickable& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::SetColor& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::BeginSection& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::EndSection& _event );
+        bool defer( const pvd::EventGroup& _group, pvd::DestroyInstance& _event );
+
+        // everything else is structural and always passes through
+        template< typename TEvent >
+        inline bool defer( const pvd::EventGroup&, TEvent& )
+        {
+            return false;
+        }
+
+        // true once a kept frame has opened with updates still pending from the skipped frames before it
+        [[nodiscard]] inline bool flushDue() const { return m_flushDue; }
+
+        // write out (or, with a null writer, discard) all pending updates
+        void flush( EventWriter* _writer, const pvd::EventGroup& _group );
+
+        [[nodiscard]] inline uint64_t deferredEvents() const    { return m_deferredEvents; }
+        [[nodiscard]] inline uint64_t flushedEvents() const     { return m_flushedEvents; }
+        [[nodiscard]] inline uint64_t droppedSections() const   { return m_droppedSections; }
+
+    private:
+
+        enum class PendingKind : uint32_t
+        {
+            Property,
+            Message,
+            Attribute,
+        };
+
+        struct PendingKey
+        {
+            uint64_t        m_instance;
+            uint64_t        m_name;             // property handle, message name or event type, depending on kind
+            PendingKind     m_kind;
+
+            bool operator==( const PendingKey& rhs ) const
+            {
+                return m_instance == rhs.m_instance && m_name == rhs.m_name && m_kind == rhs.m_kind;
+            }
+        };
+
+        struct PendingKeyHash
+        {
+            using is_avalanching = void;
+
+            uint64_t operator()( const PendingKey& key ) const noexcept
+            {
+                using namespace ankerl::unordered_dense::detail;
+                return wyhash::mix( wyhash::hash( key.m_instance ) ^ static_cast<uint64_t>( key.m_kind ), wyhash::hash( key.m_name ) );
+            }
+        };
+
+        // the latest deferred update for a key, stamped with when it was set so a flush can replay updates in order
+        struct PendingValue
+        {
+            EncodedEvents   m_events;
+            uint64_t        m_sequence = 0;
+        };
+
+        // fetch the pending slot for a key, emptied and restamped ready for the new value
+        EncodedEvents& replacePending( const PendingKey& key );
+
+        using PendingMap            = ankerl::unordered_dense::map< PendingKey, PendingValue, PendingKeyHash >;
+        using PendingByInstanceMap  = ankerl::unordered_dense::map< uint64_t, std::vector< PendingKey > >;
+
+        const uint32_t          m_interval;
+
+        uint64_t                m_frame             = 0;
+        uint64_t                m_firstFrame        = 0;
+        bool                    m_skipping          = false;
+        bool                    m_flushDue          = false;
+
+        PendingMap              m_pending;
+        PendingByInstanceMap    m_pendingByInstance;        // so a destroyed instance can drop its pending updates
+        uint64_t                m_nextSequence      = 0;
+        std::vector< const PendingValue* >  m_flushOrder;
+
+        // in-flight Begin / Append / EndSetPropertyValue sequence, and property message group
+        bool                        m_sequenceActive    = false;
+        PendingKey                  m_sequenceKey       = {};
+        pvd::StreamNamespacedName   m_groupMessageName;
+
+        uint64_t                m_deferredEvents    = 0;
+        uint64_t                m_flushedEvents     = 0;
+        uint64_t                m_droppedSections   = 0;
+    };
+
+} // namespace Op
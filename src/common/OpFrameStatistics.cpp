@@ -0,0 +1,131 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpFrameStatistics.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    FrameStatistics::~FrameStatistics()
+    {
+        if ( m_frameFile != nullptr )
+            fclose( m_frameFile );
+        if ( m_classFile != nullptr )
+            fclose( m_classFile );
+    }
+
+    bool FrameStatistics::open( const std::string& filename )
+    {
+        const std::string classFilename = fs::path( filename ).replace_extension( ".classes.csv" ).string();
+
+        m_frameFile = fopen( filename.c_str(), "w" );
+        m_classFile = fopen( classFilename.c_str(), "w" );
+        if ( m_frameFile == nullptr || m_classFile == nullptr )
+        {
+            spdlog::error( "unable to write frame statistics to [{}] / [{}]", filename, classFilename );
+            return false;
+        }
+
+        fputs( "frame,groups,group_bytes,largest_group,created,destroyed", m_frameFile );
+        for ( std::size_t type = 1; type < cEventTypeCount; type++ )
+            fmt::print( m_frameFile, ",{}", eventTypeToString( static_cast<PvdEventType>( type ) ) );
+        fputs( "\n", m_frameFile );
+
+        fputs( "frame,class,bytes\n", m_classFile );
+        return true;
+    }
+
+    void FrameStatistics::finish()
+    {
+        if ( m_frameFile == nullptr )
+            return;
+
+        endFrame();
+
+        fclose( m_frameFile );
+        fclose( m_classFile );
+        m_frameFile = nullptr;
+        m_classFile = nullptr;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void FrameStatistics::endFrame()
+    {
+        if ( m_frameFile != nullptr )
+        {
+            fmt::print( m_frameFile, "{},{},{},{},{},{}", m_currentFrame, m_frame.m_groups, m_frame.m_groupBytes, m_frame.m_largestGroup, m_frame.m_created, m_frame.m_destroyed );
+            for ( std::size_t type = 1; type < cEventTypeCount; type++ )
+                fmt::print( m_frameFile, ",{}", m_frame.m_eventCounts[type] );
+            fputs( "\n", m_frameFile );
+
+            std::sort( m_touchedClasses.begin(), m_touchedClasses.end() );
+            for ( const uint32_t classIndex : m_touchedClasses )
+                fmt::print( m_classFile, "{},{},{}\n", m_currentFrame, m_classNames[classIndex], m_classBytes[classIndex] );
+
+            m_framesWritten++;
+        }
+
+        for ( const uint32_t classIndex : m_touchedClasses )
+            m_classBytes[classIndex] = 0;
+        m_touchedClasses.clear();
+
+        m_frame = FrameAccumulator();
+        m_currentFrame++;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void FrameStatistics::observe( const MasterStringTable& _strings, const pvd::CreateInstance& _event )
+    {
+        const uint64_t classKey = ( static_cast<uint64_t>( _event.mClass.mNamespace ) << 32 ) | _event.mClass.mName;
+
+        auto [classIt, bNewClass] = m_classIndices.try_emplace( classKey, static_cast<uint32_t>( m_classNames.size() ) );
+        if ( bNewClass )
+        {
+            m_classNames.push_back( _strings.lookupStringByHandle( _event.mClass.mName ) );
+            m_classBytes.push_back( 0 );
+        }
+
+        m_instanceClasses.insert_or_assign( _event.mInstanceId, classIt->second );
+        m_frame.m_created++;
+    }
+
+    void FrameStatistics::observe( const MasterStringTable&, const pvd::DestroyInstance& _event )
+    {
+        m_instanceClasses.erase( _event.mInstanceId );
+        m_frame.m_destroyed++;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void FrameStatistics::observe( const MasterStringTable&, const pvd::SetPropertyValue& _event )
+    {
+        addClassBytes( _event.mInstanceId, _event.mData.size() );
+    }
+
+    void FrameStatistics::observe( const MasterStringTable&, const pvd::BeginSetPropertyValue& _event )
+    {
+        m_sequenceInstance = _event.mInstanceId;
+    }
+
+    void FrameStatistics::observe( const MasterStringTable&, const pvd::AppendPropertyValueData& _event )
+    {
+        addClassBytes( m_sequenceInstance, _event.mData.size() );
+    }
+
+    void FrameStatistics::observe( const MasterStringTable&, const pvd::SetPropertyMessage& _event )
+    {
+        addClassBytes( _event.mInstanceId, _event.mData.size() );
+    }
+
+    void FrameStatistics::observe( const MasterStringTable&, const pvd::SendPropertyMessageFromGroup& _event )
+    {
+        addClassBytes( _event.mInstance, _event.mData.size() );
+    }
+
+} // namespace Op
@@ -0,0 +1,128 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// per-frame breakdown of a stream, for finding the frames where spikes happen rather than just the totals that
+// EventBreaker::logSummary() gives. Each frame is gathered in a fixed accumulator - a counter per event type, stream
+// bytes, group count / largest group, instances created and destroyed, and property payload bytes per class - and
+// written out as a CSV row as soon as the next frame opens, so recording an event costs a couple of adds.
+//
+// Two files are written; the main one has a row per frame and a column per event type, while payload per class goes
+// into a second long-format file (filename.classes.csv, rows of frame,class,bytes) as the set of classes is only
+// known as the stream goes along. Frame 0 is everything before the first frame section
+//
+
+#pragma once
+
+#include "common/OpEventUnpacker.h"
+#include "common/OpMasterStringTable.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class FrameStatistics
+    {
+    public:
+
+        ~FrameStatistics();
+
+        bool open( const std::string& filename );
+
+        // writes out the final frame and closes the files
+        void finish();
+
+        // once per event group, ahead of its events
+        inline void onGroup( const pvd::EventGroup& _group )
+        {
+            m_pendingGroupBytes = _group.mDataSize;
+            m_bGroupPending     = true;
+        }
+
+        // every event, once the stream's string table and frame count have been brought up to date with it; the frame
+        // section that opens a frame closes the previous one first, so it is counted into the new one
+        template< typename TEvent >
+        inline void record( const MasterStringTable& _strings, const uint64_t _frame, const TEvent& _event )
+        {
+            while ( m_currentFrame < _frame )
+                endFrame();
+
+            observe( _strings, _event );
+
+            m_frame.m_eventCounts[static_cast<std::size_t>( EventTypeOf< TEvent >::cType )]++;
+            if ( m_bGroupPending )
+            {
+                m_frame.m_groups++;
+                m_frame.m_groupBytes  += m_pendingGroupBytes;
+                m_frame.m_largestGroup = std::max( m_frame.m_largestGroup, m_pendingGroupBytes );
+                m_bGroupPending = false;
+            }
+        }
+
+        [[nodiscard]] inline uint64_t framesWritten() const { return m_framesWritten; }
+
+    private:
+
+        static constexpr std::size_t cEventTypeCount = static_cast<std::size_t>( PvdEventType::Last );
+
+        struct FrameAccumulator
+        {
+            std::array< uint32_t, cEventTypeCount > m_eventCounts{};
+            uint64_t    m_groupBytes    = 0;
+            uint32_t    m_groups        = 0;
+            uint32_t    m_largestGroup  = 0;
+            uint32_t    m_created       = 0;
+            uint32_t    m_destroyed     = 0;
+        };
+
+        void observe( const MasterStringTable& _strings, const pvd::CreateInstance& _event );
+        void observe( const MasterStringTable& _strings, const pvd::DestroyInstance& _event );
+        void observe( const MasterStringTable& _strings, const pvd::SetPropertyValue& _event );
+        void observe( const MasterStringTable& _strings, const pvd::BeginSetPropertyValue& _event );
+        void observe( const MasterStringTable& _strings, const pvd::AppendPropertyValueData& _event );
+        void observe( const MasterStringTable& _strings, const pvd::SetPropertyMessage& _event );
+        void observe( const MasterStringTable& _strings, const pvd::SendPropertyMessageFromGroup& _event );
+
+        template< typename TEvent >
+        inline void observe( const MasterStringTable&, const TEvent& ) {}
+
+        inline void addClassBytes( const uint64_t instanceID, const uint64_t bytes )
+        {
+            if ( bytes == 0 )
+                return;
+
+            const auto it = m_instanceClasses.find( instanceID );
+            if ( it == m_instanceClasses.end() )
+                return;
+
+            if ( m_classBytes[it->second] == 0 )
+                m_touchedClasses.push_back( it->second );
+            m_classBytes[it->second] += bytes;
+        }
+
+        void endFrame();
+
+        FILE*                                                   m_frameFile     = nullptr;
+        FILE*                                                   m_classFile     = nullptr;
+
+        FrameAccumulator                                        m_frame;
+        uint64_t                                                m_currentFrame  = 0;
+        uint64_t                                                m_framesWritten = 0;
+
+        uint32_t                                                m_pendingGroupBytes = 0;
+        bool                                                    m_bGroupPending = false;
+
+        // payload bytes per class this frame, indexed like m_classNames; only the touched entries are reset
+        std::vector< uint64_t >                                 m_classBytes;
+        std::vector< uint32_t >                                 m_touchedClasses;
+
+        std::vector< std::string >                              m_classNames;
+        ankerl::unordered_dense::map< uint64_t, uint32_t >      m_classIndices;     // class name key -> m_classNames
+        ankerl::unordered_dense::map< uint64_t, uint32_t >      m_instanceClasses;  // live instance -> m_classNames
+
+        uint64_t                                                m_sequenceInstance  = 0;
+    };
+
+} // namespace Op
@@ -0,0 +1,151 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// fast 64-bit hashing of event payloads, in the style of XXH3's accumulator loop; the input is consumed in 32 byte
+// stripes, each 64-bit lane accumulating its neighbour's input plus a 32x32->64 multiply of the input mixed with a
+// per-stripe key. That maps directly onto SSE2 (_mm_mul_epu32) so two stripes' worth of lanes are processed with a
+// handful of instructions; the scalar version computes exactly the same result, for platforms without SSE2 and to
+// check the vector path against
+//
+
+#pragma once
+
+#if defined( _M_X64 ) || defined( __SSE2__ )
+#define OPVD_HASH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Op
+{
+    namespace hash_detail
+    {
+        static constexpr uint64_t cKeyInit[4] = {
+            0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull };
+
+        // added to each lane's key after every stripe, so identical stripes in different positions hash differently
+        static constexpr uint64_t cKeyStep[4] = {
+            0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0x27d4eb2f165667c5ull };
+
+        static constexpr std::size_t cStripeSize = 32;
+
+        inline uint64_t finalise( const uint64_t ( &acc )[4], const std::size_t size, const uint64_t seed )
+        {
+            using ankerl::unordered_dense::detail::wyhash::mix;
+
+            uint64_t result = mix( static_cast<uint64_t>( size ) ^ cKeyStep[0], seed ^ cKeyInit[0] );
+            result = mix( result ^ acc[0], acc[1] ^ cKeyStep[1] );
+            result = mix( result ^ acc[2], acc[3] ^ cKeyStep[2] );
+            return result;
+        }
+
+        // pad the final partial stripe out with zeros; the total size is folded in at the end, so this is unambiguous
+        inline const uint8_t* tailStripe( const uint8_t* data, const std::size_t size, uint8_t ( &padded )[cStripeSize] )
+        {
+            const std::size_t remaining = size % cStripeSize;
+            std::memset( padded, 0, cStripeSize );
+            std::memcpy( padded, data + size - remaining, remaining );
+            return padded;
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    inline uint64_t hashPayloadScalar( const uint8_t* data, const std::size_t size, const uint64_t seed = 0 )
+    {
+        using namespace hash_detail;
+
+        uint64_t acc[4] = { seed, ~seed, seed ^ cKeyStep[3], ~seed ^ cKeyStep[3] };
+        uint64_t key[4] = { cKeyInit[0], cKeyInit[1], cKeyInit[2], cKeyInit[3] };
+
+        const auto accumulate = [&]( const uint8_t* stripe )
+        {
+            uint64_t input[4];
+            std::memcpy( input, stripe, cStripeSize );
+
+            for ( int lane = 0; lane < 4; lane++ )
+            {
+                const uint64_t keyed = input[lane] ^ key[lane];
+                acc[lane] += ( keyed & 0xffffffffull ) * ( keyed >> 32 );
+                acc[lane ^ 1] += input[lane];
+                key[lane] += cKeyStep[lane];
+            }
+        };
+
+        const std::size_t fullStripes = size / cStripeSize;
+        for ( std::size_t stripe = 0; stripe < fullStripes; stripe++ )
+            accumulate( data + stripe * cStripeSize );
+
+        if ( size % cStripeSize != 0 )
+        {
+            uint8_t padded[cStripeSize];
+            accumulate( tailStripe( data, size, padded ) );
+        }
+
+        return finalise( acc, size, seed );
+    }
+
+#if OPVD_HASH_SSE2
+    // ---------------------------------------------------------------------------------------------------------------------
+    inline uint64_t hashPayloadSSE2( const uint8_t* data, const std::size_t size, const uint64_t seed = 0 )
+    {
+        using namespace hash_detail;
+
+        __m128i acc01 = _mm_set_epi64x( static_cast<int64_t>( ~seed ), static_cast<int64_t>( seed ) );
+        __m128i acc23 = _mm_set_epi64x( static_cast<int64_t>( ~seed ^ cKeyStep[3] ), static_cast<int64_t>( seed ^ cKeyStep[3] ) );
+        __m128i key01 = _mm_set_epi64x( static_cast<int64_t>( cKeyInit[1] ), static_cast<int64_t>( cKeyInit[0] ) );
+        __m128i key23 = _mm_set_epi64x( static_cast<int64_t>( cKeyInit[3] ), static_cast<int64_t>( cKeyInit[2] ) );
+
+        const __m128i step01 = _mm_set_epi64x( static_cast<int64_t>( cKeyStep[1] ), static_cast<int64_t>( cKeyStep[0] ) );
+        const __m128i step23 = _mm_set_epi64x( static_cast<int64_t>( cKeyStep[3] ), static_cast<int64_t>( cKeyStep[2] ) );
+
+        const auto accumulate = [&]( const uint8_t* stripe )
+        {
+            const __m128i input01 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( stripe ) );
+            const __m128i input23 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( stripe + 16 ) );
+
+            // low 32 bits of each lane times its high 32 bits
+            const __m128i keyed01 = _mm_xor_si128( input01, key01 );
+            const __m128i keyed23 = _mm_xor_si128( input23, key23 );
+            const __m128i product01 = _mm_mul_epu32( keyed01, _mm_shuffle_epi32( keyed01, _MM_SHUFFLE( 3, 3, 1, 1 ) ) );
+            const __m128i product23 = _mm_mul_epu32( keyed23, _mm_shuffle_epi32( keyed23, _MM_SHUFFLE( 3, 3, 1, 1 ) ) );
+
+            // each lane also takes in its neighbour's raw input
+            acc01 = _mm_add_epi64( acc01, _mm_add_epi64( product01, _mm_shuffle_epi32( input01, _MM_SHUFFLE( 1, 0, 3, 2 ) ) ) );
+            acc23 = _mm_add_epi64( acc23, _mm_add_epi64( product23, _mm_shuffle_epi32( input23, _MM_SHUFFLE( 1, 0, 3, 2 ) ) ) );
+
+            key01 = _mm_add_epi64( key01, step01 );
+            key23 = _mm_add_epi64( key23, step23 );
+        };
+
+        const std::size_t fullStripes = size / cStripeSize;
+        for ( std::size_t stripe = 0; stripe < fullStripes; stripe++ )
+            accumulate( data + stripe * cStripeSize );
+
+        if ( size % cStripeSize != 0 )
+        {
+            uint8_t padded[cStripeSize];
+            accumulate( tailStripe( data, size, padded ) );
+        }
+
+        uint64_t acc[4];
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( &acc[0] ), acc01 );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( &acc[2] ), acc23 );
+
+        return finalise( acc, size, seed );
+    }
+#endif // OPVD_HASH_SSE2
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    inline uint64_t hashPayload( const uint8_t* data, const std::size_t size, const uint64_t seed = 0 )
+    {
+#if OPVD_HASH_SSE2
+        return hashPayloadSSE2( data, size, seed );
+#else
+        return hashPayloadScalar( data, size, seed );
+#endif
+    }
+
+} // namespace Op
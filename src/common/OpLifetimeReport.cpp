@@ -0,0 +1,182 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpLifetimeReport.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    LifetimeReport::LifetimeReport()
+    {
+        m_retired.reserve( 4096 );
+    }
+
+    void LifetimeReport::endFrame()
+    {
+        for ( const uint32_t classIndex : m_churnedClasses )
+        {
+            ClassLifetimes& lifetimes = m_classes[classIndex];
+            if ( lifetimes.m_frameCreates > lifetimes.m_peakFrameCreates )
+            {
+                lifetimes.m_peakFrameCreates = lifetimes.m_frameCreates;
+                lifetimes.m_peakCreatesFrame = m_currentFrame;
+            }
+            if ( lifetimes.m_frameDestroys > lifetimes.m_peakFrameDestroys )
+            {
+                lifetimes.m_peakFrameDestroys = lifetimes.m_frameDestroys;
+                lifetimes.m_peakDestroysFrame = m_currentFrame;
+            }
+            lifetimes.m_frameCreates  = 0;
+            lifetimes.m_frameDestroys = 0;
+        }
+        m_churnedClasses.clear();
+
+        m_currentFrame++;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void LifetimeReport::observe( const MasterStringTable& _strings, const pvd::CreateInstance& _event )
+    {
+        const uint64_t classKey = ( static_cast<uint64_t>( _event.mClass.mNamespace ) << 32 ) | _event.mClass.mName;
+
+        auto [classIt, bNewClass] = m_classIndices.try_emplace( classKey, static_cast<uint32_t>( m_classes.size() ) );
+        if ( bNewClass )
+        {
+            m_classes.emplace_back().m_name = _strings.lookupStringByHandle( _event.mClass.mName );
+        }
+        const uint32_t classIndex = classIt->second;
+        ClassLifetimes& lifetimes = m_classes[classIndex];
+
+        // only IDs that were properly destroyed are retired, so replacing a live instance isn't a reuse
+        if ( m_retired.erase( _event.mInstanceId ) > 0 )
+            lifetimes.m_reusedIDs++;
+
+        // an ID that is still live is replaced, and stops counting as live against the class it had
+        if ( const auto liveIt = m_live.find( _event.mInstanceId ); liveIt != m_live.end() )
+        {
+            ClassLifetimes& previous = m_classes[liveIt->second.m_class];
+            previous.m_replacedLive++;
+            previous.m_live--;
+            m_live.erase( liveIt );
+        }
+
+        if ( lifetimes.m_frameCreates == 0 && lifetimes.m_frameDestroys == 0 )
+            m_churnedClasses.push_back( classIndex );
+        lifetimes.m_frameCreates++;
+
+        lifetimes.m_created++;
+        lifetimes.m_live++;
+        lifetimes.m_peakLive = std::max( lifetimes.m_peakLive, lifetimes.m_live );
+
+        m_live.emplace( _event.mInstanceId, LiveInstance{ classIndex, static_cast<uint32_t>( m_currentFrame ) } );
+    }
+
+    void LifetimeReport::observe( const MasterStringTable&, const pvd::DestroyInstance& _event )
+    {
+        const auto liveIt = m_live.find( _event.mInstanceId );
+        if ( liveIt == m_live.end() )
+            return;
+
+        const uint32_t classIndex = liveIt->second.m_class;
+        ClassLifetimes& lifetimes = m_classes[classIndex];
+
+        if ( lifetimes.m_frameCreates == 0 && lifetimes.m_frameDestroys == 0 )
+            m_churnedClasses.push_back( classIndex );
+        lifetimes.m_frameDestroys++;
+
+        retire( _event.mInstanceId, lifetimes );
+        m_live.erase( liveIt );
+    }
+
+    void LifetimeReport::retire( const uint64_t instanceID, ClassLifetimes& lifetimes )
+    {
+        lifetimes.m_destroyed++;
+        lifetimes.m_live--;
+
+        m_retired.emplace( instanceID );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void LifetimeReport::logSummary() const
+    {
+        const double frameCount = static_cast<double>( std::max( m_currentFrame, uint64_t( 1 ) ) );
+
+        std::vector< const ClassLifetimes* > ordered;
+        for ( const auto& lifetimes : m_classes )
+            ordered.push_back( &lifetimes );
+
+        // the classes leaving the most behind first
+        std::sort( ordered.begin(), ordered.end(), []( const ClassLifetimes* lhs, const ClassLifetimes* rhs )
+        {
+            return lhs->m_live > rhs->m_live;
+        } );
+
+        spdlog::info( "{:>32}   {:>10} {:>10} {:>10} {:>10} {:>9} {:>9} {:>8} {:>8}", "instance lifetimes", "created", "destroyed", "alive", "peak", "new/frm", "del/frm", "reused", "replaced" );
+        for ( const ClassLifetimes* lifetimes : ordered )
+        {
+            spdlog::info( "{:>32}   {:>10} {:>10} {:>10} {:>10} {:>9.2f} {:>9.2f} {:>8} {:>8}",
+                lifetimes->m_name,
+                lifetimes->m_created,
+                lifetimes->m_destroyed,
+                lifetimes->m_live,
+                lifetimes->m_peakLive,
+                lifetimes->m_created / frameCount,
+                lifetimes->m_destroyed / frameCount,
+                lifetimes->m_reusedIDs,
+                lifetimes->m_replacedLive );
+
+            // the frame in progress hasn't been folded into the peaks yet
+            const bool bCreatesNow  = lifetimes->m_frameCreates > lifetimes->m_peakFrameCreates;
+            const bool bDestroysNow = lifetimes->m_frameDestroys > lifetimes->m_peakFrameDestroys;
+            const uint32_t peakCreates  = bCreatesNow ? lifetimes->m_frameCreates : lifetimes->m_peakFrameCreates;
+            const uint32_t peakDestroys = bDestroysNow ? lifetimes->m_frameDestroys : lifetimes->m_peakFrameDestroys;
+
+            if ( peakCreates > 1 || peakDestroys > 1 )
+            {
+                spdlog::info( "{:>32}   busiest frames : {} created on {}, {} destroyed on {}", "",
+                    peakCreates, bCreatesNow ? m_currentFrame : lifetimes->m_peakCreatesFrame,
+                    peakDestroys, bDestroysNow ? m_currentFrame : lifetimes->m_peakDestroysFrame );
+            }
+        }
+    }
+
+    bool LifetimeReport::writeSurvivors( const std::string& filename ) const
+    {
+        FILE* output = fopen( filename.c_str(), "w" );
+        if ( output == nullptr )
+        {
+            spdlog::error( "unable to write lifetime report to [{}]", filename );
+            return false;
+        }
+
+        // ( class, creation frame ) -> surviving instances
+        ankerl::unordered_dense::map< uint64_t, uint64_t > survivors;
+        for ( const auto& instance : m_live )
+            survivors[( static_cast<uint64_t>( instance.second.m_class ) << 32 ) | instance.second.m_createdFrame]++;
+
+        std::vector< std::pair< uint64_t, uint64_t > > ordered( survivors.begin(), survivors.end() );
+        std::sort( ordered.begin(), ordered.end(), [&]( const auto& lhs, const auto& rhs )
+        {
+            const std::string& lhsName = m_classes[lhs.first >> 32].m_name;
+            const std::string& rhsName = m_classes[rhs.first >> 32].m_name;
+            if ( lhsName != rhsName )
+                return lhsName < rhsName;
+            return ( lhs.first & 0xFFFFFFFF ) < ( rhs.first & 0xFFFFFFFF );
+        } );
+
+        fputs( "class,created_frame,instances\n", output );
+        for ( const auto& [key, count] : ordered )
+            fmt::print( output, "{},{},{}\n", m_classes[key >> 32].m_name, key & 0xFFFFFFFF, count );
+
+        const bool bWritten = ( ferror( output ) == 0 );
+        return ( fclose( output ) == 0 ) && bWritten;
+    }
+
+} // namespace Op
@@ -0,0 +1,93 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// instance lifetime analysis, for tracking down physics objects that are created and never destroyed. Per class it
+// keeps running totals - created, destroyed, peak live count, busiest frame for creates and destroys - and per live
+// instance just its class and creation frame, so memory follows the live set rather than the length of the capture.
+//
+// Instance IDs are object addresses on the SDK side, so they come round again as memory is reused; that is counted
+// per class as well, exactly, from the set of IDs that have been destroyed and not yet created again. An ID leaves
+// the set as soon as it is reused, so it only holds the addresses the SDK has freed and not handed out since. A
+// create on an ID that is still live is counted separately, as it means a destroy went missing.
+//
+// At the end of the stream the instances still alive are written out grouped by class and creation frame
+//
+
+#pragma once
+
+#include "common/OpEventUnpacker.h"
+#include "common/OpMasterStringTable.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class LifetimeReport
+    {
+    public:
+
+        LifetimeReport();
+
+        // every event, once the stream's string table and frame count have been brought up to date with it
+        template< typename TEvent >
+        inline void record( const MasterStringTable& _strings, const uint64_t _frame, const TEvent& _event )
+        {
+            while ( m_currentFrame < _frame )
+                endFrame();
+
+            observe( _strings, _event );
+        }
+
+        // log a per-class summary, and write the surviving instances to a CSV file of class,created_frame,instances
+        void logSummary() const;
+        bool writeSurvivors( const std::string& filename ) const;
+
+    private:
+
+        struct ClassLifetimes
+        {
+            std::string m_name;
+            uint64_t    m_created               = 0;
+            uint64_t    m_destroyed             = 0;
+            uint64_t    m_live                  = 0;
+            uint64_t    m_peakLive              = 0;
+            uint64_t    m_reusedIDs             = 0;
+            uint64_t    m_replacedLive          = 0;        // created over an ID that was never destroyed
+
+            // churn within the current frame, and the worst seen
+            uint32_t    m_frameCreates          = 0;
+            uint32_t    m_frameDestroys         = 0;
+            uint32_t    m_peakFrameCreates      = 0;
+            uint32_t    m_peakFrameDestroys     = 0;
+            uint64_t    m_peakCreatesFrame      = 0;
+            uint64_t    m_peakDestroysFrame     = 0;
+        };
+
+        struct LiveInstance
+        {
+            uint32_t    m_class;
+            uint32_t    m_createdFrame;
+        };
+
+        void observe( const MasterStringTable& _strings, const pvd::CreateInstance& _event );
+        void observe( const MasterStringTable& _strings, const pvd::DestroyInstance& _event );
+
+        template< typename TEvent >
+        inline void observe( const MasterStringTable&, const TEvent& ) {}
+
+        void retire( const uint64_t instanceID, ClassLifetimes& lifetimes );
+        void endFrame();
+
+        std::vector< ClassLifetimes >                           m_classes;
+        std::vector< uint32_t >                                 m_churnedClasses;   // touched this frame
+        ankerl::unordered_dense::map< uint64_t, uint32_t >      m_classIndices;     // class name key -> m_classes
+        ankerl::unordered_dense::map< uint64_t, LiveInstance >  m_live;
+        ankerl::unordered_dense::set< uint64_t >                m_retired;          // destroyed, not yet reused
+
+        uint64_t                                                m_currentFrame      = 0;
+    };
+
+} // namespace Op
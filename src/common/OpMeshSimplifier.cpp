@@ -0,0 +1,504 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpMeshSimplifier.h"
+
+namespace Op
+{
+    namespace
+    {
+        struct ClusteredMesh
+        {
+            std::vector< float >        m_points;
+            std::vector< uint32_t >     m_indices;
+            std::vector< uint32_t >     m_sourceTriangles;
+
+            inline uint32_t triangleCount() const { return static_cast<uint32_t>( m_sourceTriangles.size() ); }
+        };
+
+        struct CandidateTriangle
+        {
+            uint32_t    m_cluster[3];
+            uint32_t    m_source;
+        };
+
+        // snap every vertex onto a resolution^3 grid over the mesh bounds, merging the vertices that share a cell into
+        // their average; triangles that collapse, or that end up as a copy of an earlier one, are dropped
+        void clusterVertices(
+            const std::vector< float >& points,
+            const std::vector< uint32_t >& indices,
+            const float boundsMin[3],
+            const float boundsExtent[3],
+            const uint32_t resolution,
+            ClusteredMesh& result )
+        {
+            const uint32_t numPoints = static_cast<uint32_t>( points.size() / 3 );
+            const uint32_t numTriangles = static_cast<uint32_t>( indices.size() / 3 );
+
+            float cellScale[3];
+            for ( int axis = 0; axis < 3; axis++ )
+                cellScale[axis] = ( boundsExtent[axis] > 0.0f ) ? ( static_cast<float>( resolution ) / boundsExtent[axis] ) : 0.0f;
+
+            ankerl::unordered_dense::map< uint64_t, uint32_t > cells;
+            cells.reserve( numPoints );
+
+            std::vector< uint32_t > vertexCluster( numPoints );
+            std::vector< double >   clusterSums;
+            std::vector< uint32_t > clusterCounts;
+
+            for ( uint32_t vertex = 0; vertex < numPoints; vertex++ )
+            {
+                const float* position = &points[vertex * 3];
+
+                uint64_t cellKey = 0;
+                for ( int axis = 2; axis >= 0; axis-- )
+                {
+                    const uint32_t cell = std::min( resolution - 1, static_cast<uint32_t>( std::max( 0.0f, ( position[axis] - boundsMin[axis] ) * cellScale[axis] ) ) );
+                    cellKey = ( cellKey * resolution ) + cell;
+                }
+
+                const auto [it, inserted] = cells.try_emplace( cellKey, static_cast<uint32_t>( clusterCounts.size() ) );
+                if ( inserted )
+                {
+                    clusterSums.insert( clusterSums.end(), { 0.0, 0.0, 0.0 } );
+                    clusterCounts.push_back( 0 );
+                }
+
+                const uint32_t cluster = it->second;
+                vertexCluster[vertex] = cluster;
+                clusterSums[cluster * 3 + 0] += position[0];
+                clusterSums[cluster * 3 + 1] += position[1];
+                clusterSums[cluster * 3 + 2] += position[2];
+                clusterCounts[cluster]++;
+            }
+
+            // rotate each surviving triangle so its smallest cluster comes first (keeping the winding), which lets
+            // duplicates be found with a sort
+            std::vector< CandidateTriangle > candidates;
+            candidates.reserve( numTriangles );
+
+            for ( uint32_t triangle = 0; triangle < numTriangles; triangle++ )
+            {
+                const uint32_t a = vertexCluster[indices[triangle * 3 + 0]];
+                const uint32_t b = vertexCluster[indices[triangle * 3 + 1]];
+                const uint32_t c = vertexCluster[indices[triangle * 3 + 2]];
+
+                if ( a == b || b == c || a == c )
+                    continue;
+
+                if ( b < a && b < c )
+                    candidates.push_back( { { b, c, a }, triangle } );
+                else if ( c < a && c < b )
+                    candidates.push_back( { { c, a, b }, triangle } );
+                else
+                    candidates.push_back( { { a, b, c }, triangle } );
+            }
+
+            std::sort( candidates.begin(), candidates.end(), []( const CandidateTriangle& lhs, const CandidateTriangle& rhs )
+            {
+                return std::tie( lhs.m_cluster[0], lhs.m_cluster[1], lhs.m_cluster[2], lhs.m_source ) <
+                       std::tie( rhs.m_cluster[0], rhs.m_cluster[1], rhs.m_cluster[2], rhs.m_source );
+            } );
+            candidates.erase( std::unique( candidates.begin(), candidates.end(), []( const CandidateTriangle& lhs, const CandidateTriangle& rhs )
+            {
+                return std::equal( std::begin( lhs.m_cluster ), std::end( lhs.m_cluster ), std::begin( rhs.m_cluster ) );
+            } ), candidates.end() );
+
+            // back into the original order, so the output keeps whatever locality the source mesh had
+            std::sort( candidates.begin(), candidates.end(), []( const CandidateTriangle& lhs, const CandidateTriangle& rhs )
+            {
+                return lhs.m_source < rhs.m_source;
+            } );
+
+            // only clusters still referenced by a triangle become output vertices
+            constexpr uint32_t cUnused = std::numeric_limits< uint32_t >::max();
+            std::vector< uint32_t > clusterVertex( clusterCounts.size(), cUnused );
+
+            result.m_points.clear();
+            result.m_indices.clear();
+            result.m_sourceTriangles.clear();
+            result.m_indices.reserve( candidates.size() * 3 );
+            result.m_sourceTriangles.reserve( candidates.size() );
+
+            for ( const auto& candidate : candidates )
+            {
+                for ( const uint32_t cluster : candidate.m_cluster )
+                {
+                    if ( clusterVertex[cluster] == cUnused )
+                    {
+                        clusterVertex[cluster] = static_cast<uint32_t>( result.m_points.size() / 3 );
+
+                        const double weight = 1.0 / clusterCounts[cluster];
+                        result.m_points.push_back( static_cast<float>( clusterSums[cluster * 3 + 0] * weight ) );
+                        result.m_points.push_back( static_cast<float>( clusterSums[cluster * 3 + 1] * weight ) );
+                        result.m_points.push_back( static_cast<float>( clusterSums[cluster * 3 + 2] * weight ) );
+                    }
+                    result.m_indices.push_back( clusterVertex[cluster] );
+                }
+                result.m_sourceTriangles.push_back( candidate.m_source );
+            }
+        }
+
+    } // anonymous namespace
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void MeshSimplifier::Payload::capture( const physx::pvdsdk::SetPropertyValue& _event )
+    {
+        m_present = true;
+        m_header = _event;
+        m_header.mData = physx::pvdsdk::DataRef<const uint8_t>();
+        m_data.assign( _event.mData.begin(), _event.mData.end() );
+    }
+
+    physx::pvdsdk::SetPropertyValue MeshSimplifier::Payload::event() const
+    {
+        physx::pvdsdk::SetPropertyValue result = m_header;
+        result.mData = physx::pvdsdk::DataRef<const uint8_t>( m_data.data(), static_cast<uint32_t>( m_data.size() ) );
+        return result;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    MeshSimplifier::MeshSimplifier( const uint32_t targetTriangles, const uint32_t threadCount )
+        : m_targetTriangles( targetTriangles )
+        , m_workers( threadCount )
+    {
+    }
+
+    MeshSimplifier::~MeshSimplifier()
+    {
+        // don't leave workers chewing on jobs that are about to be freed
+        for ( auto& job : m_inFlight )
+        {
+            if ( job->m_processed.valid() )
+                job->m_processed.wait();
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void MeshSimplifier::onStringHandle( const physx::pvdsdk::StringHandleEvent& _event )
+    {
+        if ( std::strcmp( _event.mString, "Points" ) == 0 )
+        {
+            m_pointsHandle = _event.mHandle;
+            m_pointsHandleKnown = true;
+        }
+        else if ( std::strcmp( _event.mString, "Triangles" ) == 0 )
+        {
+            m_trianglesHandle = _event.mHandle;
+            m_trianglesHandleKnown = true;
+        }
+        else if ( std::strcmp( _event.mString, "MaterialIndices" ) == 0 )
+        {
+            m_materialsHandle = _event.mHandle;
+            m_materialsHandleKnown = true;
+        }
+    }
+
+    void MeshSimplifier::onCreateInstance( const uint64_t instanceID, const bool isTriangleMesh )
+    {
+        if ( isTriangleMesh )
+            m_meshInstances.emplace( instanceID );
+        else
+            m_meshInstances.erase( instanceID );
+    }
+
+    void MeshSimplifier::onDestroyInstance( const uint64_t instanceID )
+    {
+        if ( !m_meshInstances.erase( instanceID ) )
+            return;
+
+        // whatever is outstanding for the mesh has to be written ahead of its destruction
+        if ( const auto it = m_collecting.find( instanceID ); it != m_collecting.end() )
+        {
+            m_inFlight.emplace_back( std::move( it->second ) );
+            m_collecting.erase( it );
+        }
+        for ( auto& job : m_inFlight )
+        {
+            if ( job->m_instanceID == instanceID )
+                job->m_forced = true;
+        }
+
+        m_triangleMaps.erase( instanceID );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool MeshSimplifier::rewrite( physx::pvdsdk::SetPropertyValue& _event )
+    {
+        if ( !m_meshInstances.contains( _event.mInstanceId ) )
+            return true;
+
+        const uint64_t instanceID = _event.mInstanceId;
+
+        if ( m_pointsHandleKnown && _event.mPropertyName == m_pointsHandle )
+        {
+            // a replacement for a mesh still being processed; the older result has to go out first
+            if ( MeshJob* previous = findInFlight( instanceID ) )
+                previous->m_forced = true;
+
+            auto& job = m_collecting[instanceID];
+            if ( !job )
+            {
+                job = std::make_unique< MeshJob >();
+                job->m_instanceID = instanceID;
+            }
+            job->m_points.capture( _event );
+            return false;
+        }
+
+        if ( m_trianglesHandleKnown && _event.mPropertyName == m_trianglesHandle )
+        {
+            const auto it = m_collecting.find( instanceID );
+            if ( it == m_collecting.end() )
+            {
+                // new triangles for vertices we never saw go through as-is, replacing any layout we produced
+                m_triangleMaps.erase( instanceID );
+                return true;
+            }
+
+            it->second->m_triangles.capture( _event );
+
+            std::unique_ptr< MeshJob > job = std::move( it->second );
+            m_collecting.erase( it );
+            submit( std::move( job ) );
+            return false;
+        }
+
+        if ( m_materialsHandleKnown && _event.mPropertyName == m_materialsHandle )
+        {
+            if ( const auto it = m_collecting.find( instanceID ); it != m_collecting.end() )
+            {
+                it->second->m_materials.capture( _event );
+                return false;
+            }
+
+            // arriving after the mesh was sent for processing; wait for it, then ride along with its output
+            if ( MeshJob* job = findInFlight( instanceID ) )
+            {
+                if ( job->m_processed.valid() )
+                    job->m_processed.wait();
+
+                job->m_materials.capture( _event );
+                if ( job->m_simplified )
+                {
+                    if ( remapPerTriangle( _event, job->m_originalTriangles, job->m_sourceTriangles, m_remapScratch ) )
+                    {
+                        job->m_materials.m_data.swap( m_remapScratch );
+                        job->m_materials.m_header.mNumItems = static_cast<uint32_t>( job->m_sourceTriangles.size() );
+                    }
+                    else
+                    {
+                        job->m_materials.m_present = false;
+                    }
+                }
+                job->m_forced = true;
+                return false;
+            }
+
+            if ( const auto it = m_triangleMaps.find( instanceID ); it != m_triangleMaps.end() )
+            {
+                if ( !remapPerTriangle( _event, it->second.m_originalTriangles, it->second.m_sourceTriangles, m_remapScratch ) )
+                    return false;
+
+                _event.mData = physx::pvdsdk::DataRef<const uint8_t>( m_remapScratch.data(), static_cast<uint32_t>( m_remapScratch.size() ) );
+                _event.mNumItems = static_cast<uint32_t>( it->second.m_sourceTriangles.size() );
+            }
+            return true;
+        }
+
+        return true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void MeshSimplifier::submit( std::unique_ptr< MeshJob > job )
+    {
+        MeshJob* jobPtr = job.get();
+        const uint32_t targetTriangles = m_targetTriangles;
+
+        job->m_processed = m_workers.submit( [jobPtr, targetTriangles]()
+        {
+            process( *jobPtr, targetTriangles );
+        } );
+
+        m_inFlight.emplace_back( std::move( job ) );
+    }
+
+    void MeshSimplifier::retire( MeshJob& job )
+    {
+        if ( !job.m_simplified )
+        {
+            m_triangleMaps.erase( job.m_instanceID );
+            return;
+        }
+
+        const std::size_t simplifiedBytes = job.m_points.m_data.size() + job.m_triangles.m_data.size() + ( job.m_materials.m_present ? job.m_materials.m_data.size() : 0 );
+
+        m_meshesSimplified++;
+        m_trianglesBefore += job.m_originalTriangles;
+        m_trianglesAfter  += job.m_sourceTriangles.size();
+        m_bytesSaved      += ( job.m_originalBytes > simplifiedBytes ) ? ( job.m_originalBytes - simplifiedBytes ) : 0;
+
+        // a mesh destroyed while it was being processed has no further updates to remap
+        if ( m_meshInstances.contains( job.m_instanceID ) )
+        {
+            auto& triangleMap = m_triangleMaps[job.m_instanceID];
+            triangleMap.m_originalTriangles = job.m_originalTriangles;
+            triangleMap.m_sourceTriangles = std::move( job.m_sourceTriangles );
+        }
+    }
+
+    MeshSimplifier::MeshJob* MeshSimplifier::findInFlight( const uint64_t instanceID )
+    {
+        // newest first, so a replaced mesh finds its latest job
+        for ( auto it = m_inFlight.rbegin(); it != m_inFlight.rend(); ++it )
+        {
+            if ( *it && ( *it )->m_instanceID == instanceID )
+                return it->get();
+        }
+        return nullptr;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool MeshSimplifier::remapPerTriangle( const physx::pvdsdk::SetPropertyValue& _event, const uint32_t originalTriangles, const std::vector< uint32_t >& sourceTriangles, std::vector< uint8_t >& output )
+    {
+        const uint32_t dataSize = _event.mData.size();
+        if ( _event.mNumItems != originalTriangles || originalTriangles == 0 || ( dataSize % originalTriangles ) != 0 )
+            return false;
+
+        const uint32_t elementSize = dataSize / originalTriangles;
+        const uint8_t* source = _event.mData.begin();
+
+        output.resize( sourceTriangles.size() * elementSize );
+        uint8_t* destination = output.data();
+        for ( const uint32_t triangle : sourceTriangles )
+        {
+            std::memcpy( destination, source + ( triangle * elementSize ), elementSize );
+            destination += elementSize;
+        }
+        return true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // runs on a worker thread; anything that doesn't look like a mesh we understand is left untouched
+    void MeshSimplifier::process( MeshJob& job, const uint32_t targetTriangles )
+    {
+        if ( !job.m_points.m_present || !job.m_triangles.m_present )
+            return;
+
+        const uint32_t numPoints = job.m_points.m_header.mNumItems;
+        if ( numPoints == 0 || job.m_points.m_data.size() != std::size_t( numPoints ) * 12 )
+            return;
+
+        // indices are either sent as a flat list of PxU32 or as one item per triangle
+        const uint32_t triangleItems = job.m_triangles.m_header.mNumItems;
+        const std::size_t triangleBytes = job.m_triangles.m_data.size();
+        if ( triangleItems == 0 || ( triangleBytes % triangleItems ) != 0 )
+            return;
+
+        const std::size_t itemSize = triangleBytes / triangleItems;
+        if ( itemSize != 4 && itemSize != 12 )
+            return;
+
+        const bool triangleItemsAreTriples = ( itemSize == 12 );
+        const std::size_t indexCount = triangleBytes / 4;
+        if ( ( indexCount % 3 ) != 0 )
+            return;
+
+        const uint32_t numTriangles = static_cast<uint32_t>( indexCount / 3 );
+        if ( numTriangles <= targetTriangles )
+            return;
+
+        std::vector< uint32_t > indices( indexCount );
+        std::memcpy( indices.data(), job.m_triangles.m_data.data(), triangleBytes );
+        for ( const uint32_t index : indices )
+        {
+            if ( index >= numPoints )
+                return;
+        }
+
+        std::vector< float > points( std::size_t( numPoints ) * 3 );
+        std::memcpy( points.data(), job.m_points.m_data.data(), job.m_points.m_data.size() );
+
+        // a NaN or infinite vertex can't be put in a grid cell (the float to cell index conversion would be undefined),
+        // so such a mesh is passed through as it is
+        for ( const float coordinate : points )
+        {
+            if ( !std::isfinite( coordinate ) )
+                return;
+        }
+
+        float boundsMin[3] = { points[0], points[1], points[2] };
+        float boundsMax[3] = { points[0], points[1], points[2] };
+        for ( uint32_t vertex = 1; vertex < numPoints; vertex++ )
+        {
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                boundsMin[axis] = std::min( boundsMin[axis], points[vertex * 3 + axis] );
+                boundsMax[axis] = std::max( boundsMax[axis], points[vertex * 3 + axis] );
+            }
+        }
+        const float boundsExtent[3] = { boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2] };
+
+        // finite points can still span more than a float can hold
+        for ( int axis = 0; axis < 3; axis++ )
+        {
+            if ( !std::isfinite( boundsExtent[axis] ) )
+                return;
+        }
+
+        // a surface gridded at resolution R touches on the order of R^2 cells, so start from there and coarsen
+        // until the result fits
+        uint32_t resolution = std::max( 2U, static_cast<uint32_t>( std::sqrt( static_cast<double>( targetTriangles ) ) ) );
+
+        ClusteredMesh clustered;
+        for ( ;; )
+        {
+            clusterVertices( points, indices, boundsMin, boundsExtent, resolution, clustered );
+
+            if ( clustered.triangleCount() <= targetTriangles || resolution == 2 )
+                break;
+
+            resolution = std::max( 2U, ( resolution * 3 ) / 4 );
+        }
+
+        if ( clustered.triangleCount() == 0 || clustered.triangleCount() >= numTriangles )
+            return;
+
+        job.m_originalTriangles = numTriangles;
+        job.m_originalBytes = job.m_points.m_data.size() + triangleBytes + ( job.m_materials.m_present ? job.m_materials.m_data.size() : 0 );
+
+        if ( job.m_materials.m_present )
+        {
+            std::vector< uint8_t > remapped;
+            if ( remapPerTriangle( job.m_materials.event(), numTriangles, clustered.m_sourceTriangles, remapped ) )
+            {
+                job.m_materials.m_data.swap( remapped );
+                job.m_materials.m_header.mNumItems = clustered.triangleCount();
+            }
+            else
+            {
+                job.m_materials.m_present = false;
+            }
+        }
+
+        const uint32_t newPoints = static_cast<uint32_t>( clustered.m_points.size() / 3 );
+        job.m_points.m_data.resize( clustered.m_points.size() * sizeof( float ) );
+        std::memcpy( job.m_points.m_data.data(), clustered.m_points.data(), job.m_points.m_data.size() );
+        job.m_points.m_header.mNumItems = newPoints;
+
+        job.m_triangles.m_data.resize( clustered.m_indices.size() * sizeof( uint32_t ) );
+        std::memcpy( job.m_triangles.m_data.data(), clustered.m_indices.data(), job.m_triangles.m_data.size() );
+        job.m_triangles.m_header.mNumItems = triangleItemsAreTriples ? clustered.triangleCount() : static_cast<uint32_t>( clustered.m_indices.size() );
+
+        job.m_sourceTriangles = std::move( clustered.m_sourceTriangles );
+        job.m_simplified = true;
+    }
+
+} // namespace Op
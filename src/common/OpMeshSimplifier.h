@@ -0,0 +1,168 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// rebuilds PxTriangleMesh payloads at a reduced density rather than dropping the meshes outright. The Points and
+// Triangles updates for a mesh are taken out of the stream and handed to a worker pool, which re-grids the vertices
+// (vertex clustering, coarsening the grid until the triangle count is under the target) while the main stream keeps
+// flowing; finished meshes are written back out by drain(), which the caller runs between events.
+//
+// A mesh is always finished before anything that depends on its exact triangle layout goes out - its DestroyInstance,
+// or a MaterialIndices update, which is remapped onto the surviving triangles
+//
+
+#pragma once
+
+#include "PxPvdCommStreamEvents.h"
+
+#include "common/OpWorkerPool.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class MeshSimplifier
+    {
+    public:
+
+        explicit MeshSimplifier( const uint32_t targetTriangles, const uint32_t threadCount = 0 );
+        ~MeshSimplifier();
+
+        void onStringHandle( const physx::pvdsdk::StringHandleEvent& _event );
+        void onCreateInstance( const uint64_t instanceID, const bool isTriangleMesh );
+        void onDestroyInstance( const uint64_t instanceID );
+
+        // returns false if the update has been taken over; it will come back out of drain() once processed
+        bool rewrite( physx::pvdsdk::SetPropertyValue& _event );
+
+        // write out the updates for any meshes that have finished processing (or that must be finished now, ahead of
+        // their destruction) through emit( physx::pvdsdk::SetPropertyValue& ); with waitForAll, everything still
+        // outstanding is completed first, for use at the end of the stream
+        template< typename TEmit >
+        void drain( TEmit&& emit, const bool waitForAll = false );
+
+        [[nodiscard]] inline uint32_t workerCount() const       { return m_workers.threadCount(); }
+        [[nodiscard]] inline uint64_t meshesSimplified() const  { return m_meshesSimplified; }
+        [[nodiscard]] inline uint64_t trianglesBefore() const   { return m_trianglesBefore; }
+        [[nodiscard]] inline uint64_t trianglesAfter() const    { return m_trianglesAfter; }
+        [[nodiscard]] inline uint64_t bytesSaved() const        { return m_bytesSaved; }
+
+    private:
+
+        struct Payload
+        {
+            bool                                m_present = false;
+            physx::pvdsdk::SetPropertyValue     m_header;
+            std::vector< uint8_t >              m_data;
+
+            void capture( const physx::pvdsdk::SetPropertyValue& _event );
+            physx::pvdsdk::SetPropertyValue event() const;
+        };
+
+        struct MeshJob
+        {
+            uint64_t                m_instanceID = 0;
+            Payload                 m_points;
+            Payload                 m_triangles;
+            Payload                 m_materials;
+            bool                    m_forced = false;       // must be drained at the next opportunity
+            std::future< void >     m_processed;            // not valid for meshes that are passed through untouched
+
+            // results, filled in by the worker
+            bool                    m_simplified = false;
+            uint32_t                m_originalTriangles = 0;
+            std::size_t             m_originalBytes = 0;
+            std::vector< uint32_t > m_sourceTriangles;      // original triangle index of each one kept
+
+            inline bool ready() const
+            {
+                return !m_processed.valid() || m_processed.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready;
+            }
+        };
+
+        // kept once a simplified mesh has been written, so later material updates can be remapped to match
+        struct TriangleMap
+        {
+            uint32_t                m_originalTriangles = 0;
+            std::vector< uint32_t > m_sourceTriangles;
+        };
+
+        static void process( MeshJob& job, const uint32_t targetTriangles );
+
+        // apply the triangle remapping to a per-triangle payload, returning false if it doesn't match the mesh
+        static bool remapPerTriangle( const physx::pvdsdk::SetPropertyValue& _event, const uint32_t originalTriangles, const std::vector< uint32_t >& sourceTriangles, std::vector< uint8_t >& output );
+
+        void submit( std::unique_ptr< MeshJob > job );
+        void retire( MeshJob& job );
+        MeshJob* findInFlight( const uint64_t instanceID );
+
+        const uint32_t  m_targetTriangles;
+
+        bool            m_pointsHandleKnown     = false;
+        bool            m_trianglesHandleKnown  = false;
+        bool            m_materialsHandleKnown  = false;
+        uint32_t        m_pointsHandle          = 0;
+        uint32_t        m_trianglesHandle       = 0;
+        uint32_t        m_materialsHandle       = 0;
+
+        ankerl::unordered_dense::set< uint64_t >                                m_meshInstances;
+        ankerl::unordered_dense::map< uint64_t, std::unique_ptr< MeshJob > >    m_collecting;   // waiting on their Triangles
+        std::vector< std::unique_ptr< MeshJob > >                               m_inFlight;     // in submission order
+        ankerl::unordered_dense::map< uint64_t, TriangleMap >                   m_triangleMaps;
+        std::vector< uint8_t >                                                  m_remapScratch;
+
+        uint64_t        m_meshesSimplified  = 0;
+        uint64_t        m_trianglesBefore   = 0;
+        uint64_t        m_trianglesAfter    = 0;
+        uint64_t        m_bytesSaved        = 0;
+
+        WorkerPool      m_workers;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    template< typename TEmit >
+    void MeshSimplifier::drain( TEmit&& emit, const bool waitForAll )
+    {
+        if ( waitForAll )
+        {
+            // meshes that never saw their triangles go back out as they came in
+            for ( auto& collecting : m_collecting )
+                m_inFlight.emplace_back( std::move( collecting.second ) );
+            m_collecting.clear();
+        }
+
+        if ( m_inFlight.empty() )
+            return;
+
+        bool anyRetired = false;
+        for ( auto& job : m_inFlight )
+        {
+            if ( !waitForAll && !job->m_forced && !job->ready() )
+                continue;
+
+            if ( job->m_processed.valid() )
+                job->m_processed.get();
+
+            for ( const Payload* payload : { &job->m_points, &job->m_triangles, &job->m_materials } )
+            {
+                if ( payload->m_present )
+                {
+                    physx::pvdsdk::SetPropertyValue _event = payload->event();
+                    emit( _event );
+                }
+            }
+
+            retire( *job );
+            job.reset();
+            anyRetired = true;
+        }
+
+        if ( anyRetired )
+        {
+            m_inFlight.erase( std::remove( m_inFlight.begin(), m_inFlight.end(), nullptr ), m_inFlight.end() );
+        }
+    }
+
+} // namespace Op
@@ -0,0 +1,553 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpPayloadDeduplicator.h"
+#include "OpHash.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    PayloadDeduplicator::PayloadDeduplicator()
+    {
+        m_contents.reserve( 1024 );
+        m_canonicals.reserve( 1024 );
+        m_duplicateOf.reserve( 4096 );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PayloadDeduplicator::onStringHandle( const physx::pvdsdk::StringHandleEvent& _event )
+    {
+        if ( std::strcmp( _event.mString, "PxTriangleMesh" ) == 0 ||
+             std::strcmp( _event.mString, "PxConvexMesh" ) == 0 ||
+             std::strcmp( _event.mString, "PxHeightField" ) == 0 )
+        {
+            m_classHandles.emplace( _event.mHandle );
+        }
+        else if ( std::strcmp( _event.mString, "ObjectRef" ) == 0 )
+        {
+            m_objectRefHandle = _event.mHandle;
+            m_objectRefKnown = true;
+        }
+    }
+
+    void PayloadDeduplicator::onCreatePropertyMessage( const physx::pvdsdk::CreatePropertyMessage& _event )
+    {
+        if ( !m_objectRefKnown )
+            return;
+
+        std::vector< uint32_t > offsets;
+
+        const auto messageCount = _event.mMessageEntries.size();
+        for ( uint32_t idx = 0; idx < messageCount; ++idx )
+        {
+            const auto& entry( const_cast<const physx::pvdsdk::StreamPropMessageArg&>( _event.mMessageEntries[idx] ) );
+            if ( entry.mDatatypeName.mName == m_objectRefHandle && entry.mByteSize == sizeof( uint64_t ) )
+                offsets.push_back( entry.mMessageOffset );
+        }
+
+        if ( offsets.empty() )
+            m_messageRefOffsets.erase( messageKey( _event.mMessageName ) );
+        else
+            m_messageRefOffsets.insert_or_assign( messageKey( _event.mMessageName ), std::move( offsets ) );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    template< typename TEvent >
+    void PayloadDeduplicator::hold( const TEvent& _event, const physx::pvdsdk::DataRef<const uint8_t>* data )
+    {
+        LayoutEntry& entry = m_pending->m_layout.emplace_back();
+        entry.m_event = _event;
+        if ( data != nullptr )
+        {
+            m_pending->m_payload.insert( m_pending->m_payload.end(), data->begin(), data->end() );
+            entry.m_dataSize = data->size();
+        }
+    }
+
+    void PayloadDeduplicator::hashContent( const uint64_t tag, const physx::pvdsdk::DataRef<const uint8_t>& data )
+    {
+        using ankerl::unordered_dense::detail::wyhash::mix;
+
+        m_pending->m_hash = hashPayload( data.begin(), data.size(), mix( m_pending->m_hash, tag ) );
+    }
+
+    void PayloadDeduplicator::completePending()
+    {
+        if ( !m_pending )
+            return;
+
+        std::unique_ptr< PendingInstance > pending = std::move( m_pending );
+
+        const ContentKey content{ pending->m_classHandle, pending->m_hash, pending->m_payload.size() };
+
+        // an instance with no data to speak of isn't worth folding into another
+        if ( content.m_bytes > 0 )
+        {
+            if ( const auto it = m_contents.find( content ); it != m_contents.end() )
+            {
+                const uint64_t canonicalID = it->second;
+                Canonical& canonical = m_canonicals[canonicalID];
+
+                // the hash only says the contents are probably the same; a collision is written out as it is
+                if ( canonical.m_payload == pending->m_payload )
+                {
+                    m_duplicateOf.insert_or_assign( pending->m_instanceID, canonicalID );
+                    canonical.m_liveDuplicates++;
+
+                    m_duplicateInstances++;
+                    m_bytesSaved += content.m_bytes;
+
+                    // the rest of an unfinished property sequence goes the same way
+                    m_droppingSequence = pending->m_inSequence;
+                    return;
+                }
+            }
+            else
+            {
+                m_contents.emplace( content, pending->m_instanceID );
+                releaseLayout( pending->m_layout, pending->m_payload, pending->m_instanceID );
+                m_canonicals.insert_or_assign( pending->m_instanceID, Canonical{ content, 0, false, std::move( pending->m_layout ), std::move( pending->m_payload ) } );
+                m_canonicalInstances++;
+                return;
+            }
+        }
+
+        releaseLayout( pending->m_layout, pending->m_payload, pending->m_instanceID );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    namespace
+    {
+        template< typename TEvent >
+        inline void retarget( TEvent& _event, const uint64_t instanceID )
+        {
+            if constexpr ( std::is_same_v< TEvent, physx::pvdsdk::AppendPropertyValueData > || std::is_same_v< TEvent, physx::pvdsdk::EndSetPropertyValue > )
+                return;
+            else
+                _event.mInstanceId = instanceID;
+        }
+    }
+
+    void PayloadDeduplicator::releaseLayout( const std::vector< LayoutEntry >& layout, const std::vector< uint8_t >& payload, const uint64_t instanceID )
+    {
+        std::size_t offset = 0;
+        for ( const auto& entry : layout )
+        {
+            HeldEvent& held = m_released.emplace_back();
+            held.m_event = entry.m_event;
+            held.m_data.assign( payload.begin() + offset, payload.begin() + offset + entry.m_dataSize );
+            offset += entry.m_dataSize;
+
+            std::visit( [&]( auto& _event ) { retarget( _event, instanceID ); }, held.m_event );
+        }
+    }
+
+    void PayloadDeduplicator::promoteDuplicate( const uint64_t canonicalID, Canonical& canonical )
+    {
+        uint64_t promotedID = 0;
+        for ( auto it = m_duplicateOf.begin(); it != m_duplicateOf.end(); ++it )
+        {
+            if ( it->second == canonicalID )
+            {
+                promotedID = it->first;
+                break;
+            }
+        }
+
+        // the duplicate never made it to the output; it gets the same contents under its own ID
+        releaseLayout( canonical.m_layout, canonical.m_payload, promotedID );
+
+        m_duplicateOf.erase( promotedID );
+        for ( auto& entry : m_duplicateOf )
+        {
+            if ( entry.second == canonicalID )
+                entry.second = promotedID;
+        }
+
+        retargetReferences( canonicalID, promotedID );
+
+        m_contents.try_emplace( canonical.m_content, promotedID );
+        m_canonicals.insert_or_assign( promotedID, Canonical{ canonical.m_content, canonical.m_liveDuplicates - 1, false, std::move( canonical.m_layout ), std::move( canonical.m_payload ) } );
+
+        m_duplicateInstances--;
+        m_canonicalInstances++;
+        m_bytesSaved -= canonical.m_content.m_bytes;
+    }
+
+    void PayloadDeduplicator::retargetReferences( const uint64_t canonicalID, const uint64_t promotedID )
+    {
+        const auto retargetValue = [&]( RedirectedValue& value )
+        {
+            bool retargeted = false;
+            for ( const uint32_t offset : value.m_offsets )
+            {
+                uint64_t reference;
+                std::memcpy( &reference, value.m_data.data() + offset, sizeof( uint64_t ) );
+                if ( reference != canonicalID )
+                    continue;
+
+                std::memcpy( value.m_data.data() + offset, &promotedID, sizeof( uint64_t ) );
+                retargeted = true;
+                m_redirectedReferences++;
+            }
+
+            if ( retargeted )
+                m_released.push_back( { value.m_event, value.m_data } );
+        };
+
+        for ( auto& [referrerID, references] : m_redirectedBy )
+        {
+            for ( auto& property : references.m_properties )
+                retargetValue( property.second );
+            for ( auto& message : references.m_messages )
+                retargetValue( message.second );
+
+            for ( auto& collection : references.m_collections )
+            {
+                if ( collection.mObjectRef != canonicalID )
+                    continue;
+
+                physx::pvdsdk::RemoveObjectRef remove;
+                remove.mInstanceId = collection.mInstanceId;
+                remove.mProperty   = collection.mProperty;
+                remove.mObjectRef  = canonicalID;
+                m_released.push_back( { remove, {} } );
+
+                collection.mObjectRef = promotedID;
+                m_released.push_back( { collection, {} } );
+                m_redirectedReferences++;
+            }
+        }
+    }
+
+    template< typename TEvent >
+    void PayloadDeduplicator::rememberValue( const uint64_t referrerID, const uint64_t key, const TEvent& _event )
+    {
+        if ( m_redirectedOffsets.empty() )
+        {
+            // overwritten with something that needed no redirecting; nothing to write again any more
+            if ( const auto it = m_redirectedBy.find( referrerID ); it != m_redirectedBy.end() )
+            {
+                if constexpr ( std::is_same_v< TEvent, physx::pvdsdk::SetPropertyValue > )
+                    it->second.m_properties.erase( static_cast<uint32_t>( key ) );
+                else
+                    it->second.m_messages.erase( key );
+            }
+            return;
+        }
+
+        RedirectedReferences& references = m_redirectedBy[referrerID];
+        RedirectedValue& value = std::is_same_v< TEvent, physx::pvdsdk::SetPropertyValue > ?
+            references.m_properties[static_cast<uint32_t>( key )] : references.m_messages[key];
+
+        value.m_event = _event;
+        value.m_data.assign( _event.mData.begin(), _event.mData.end() );
+        value.m_offsets = m_redirectedOffsets;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    physx::pvdsdk::DataRef<const uint8_t> PayloadDeduplicator::redirectFields( const physx::pvdsdk::DataRef<const uint8_t>& data, const std::vector< uint32_t >& offsets )
+    {
+        m_redirectedOffsets.clear();
+
+        bool copied = false;
+        for ( const uint32_t offset : offsets )
+        {
+            if ( offset + sizeof( uint64_t ) > data.size() )
+                continue;
+
+            uint64_t reference;
+            std::memcpy( &reference, data.begin() + offset, sizeof( uint64_t ) );
+            if ( !isDuplicate( reference ) )
+                continue;
+
+            if ( !copied )
+            {
+                m_redirectScratch.assign( data.begin(), data.end() );
+                copied = true;
+            }
+
+            const uint64_t canonicalID = redirect( reference );
+            std::memcpy( m_redirectScratch.data() + offset, &canonicalID, sizeof( uint64_t ) );
+            m_redirectedOffsets.push_back( offset );
+            m_redirectedReferences++;
+        }
+
+        if ( !copied )
+            return data;
+
+        return physx::pvdsdk::DataRef<const uint8_t>( m_redirectScratch.data(), static_cast<uint32_t>( m_redirectScratch.size() ) );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool PayloadDeduplicator::accept( physx::pvdsdk::CreateInstance& _event )
+    {
+        completePending();
+
+        // the ID of a canonical instance we kept alive for its duplicates is being reused; it has to go now, and one
+        // of the duplicates steps in so the others aren't left redirecting to whatever takes the ID next
+        if ( const auto it = m_canonicals.find( _event.mInstanceId ); it != m_canonicals.end() && it->second.m_destroyed )
+        {
+            const uint64_t canonicalID = it->first;
+            Canonical canonical = std::move( it->second );
+            m_canonicals.erase( it );
+
+            promoteDuplicate( canonicalID, canonical );
+
+            physx::pvdsdk::DestroyInstance destroy;
+            destroy.mInstanceId = canonicalID;
+            m_released.push_back( { destroy, {} } );
+        }
+
+        if ( !m_classHandles.contains( _event.mClass.mName ) )
+            return false;
+
+        m_pending = std::make_unique< PendingInstance >();
+        m_pending->m_instanceID  = _event.mInstanceId;
+        m_pending->m_classHandle = _event.mClass.mName;
+        hold( _event, nullptr );
+        return true;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::SetPropertyValue& _event )
+    {
+        if ( m_pending && m_pending->m_instanceID == _event.mInstanceId && !m_pending->m_inSequence )
+        {
+            hashContent( ( static_cast<uint64_t>( _event.mPropertyName ) << 32 ) | _event.mNumItems, _event.mData );
+            hold( _event, &_event.mData );
+            return true;
+        }
+
+        completePending();
+
+        if ( isDuplicate( _event.mInstanceId ) )
+            return true;
+
+        if ( m_objectRefKnown && _event.mIncomingTypeName.mName == m_objectRefHandle &&
+             ( !m_duplicateOf.empty() || m_redirectedBy.contains( _event.mInstanceId ) ) )
+        {
+            std::vector< uint32_t > offsets;
+            for ( uint32_t offset = 0; offset + sizeof( uint64_t ) <= _event.mData.size(); offset += sizeof( uint64_t ) )
+                offsets.push_back( offset );
+
+            _event.mData = redirectFields( _event.mData, offsets );
+            rememberValue( _event.mInstanceId, _event.mPropertyName, _event );
+        }
+        return false;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::BeginSetPropertyValue& _event )
+    {
+        if ( m_pending && m_pending->m_instanceID == _event.mInstanceId && !m_pending->m_inSequence )
+        {
+            m_pending->m_inSequence = true;
+            hashContent( ( static_cast<uint64_t>( _event.mPropertyName ) << 32 ) | _event.mIncomingTypeName.mName, {} );
+            hold( _event, nullptr );
+            return true;
+        }
+
+        completePending();
+
+        if ( isDuplicate( _event.mInstanceId ) )
+        {
+            m_droppingSequence = true;
+            return true;
+        }
+        return false;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::AppendPropertyValueData& _event )
+    {
+        if ( m_pending && m_pending->m_inSequence )
+        {
+            hashContent( _event.mNumItems, _event.mData );
+            hold( _event, &_event.mData );
+            return true;
+        }
+        return m_droppingSequence;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::EndSetPropertyValue& _event )
+    {
+        if ( m_pending && m_pending->m_inSequence )
+        {
+            m_pending->m_inSequence = false;
+            hold( _event, nullptr );
+            return true;
+        }
+
+        const bool dropping = m_droppingSequence;
+        m_droppingSequence = false;
+        return dropping;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::SetPropertyMessage& _event )
+    {
+        if ( m_pending && m_pending->m_instanceID == _event.mInstanceId && !m_pending->m_inSequence )
+        {
+            hashContent( messageKey( _event.mMessageName ), _event.mData );
+            hold( _event, &_event.mData );
+            return true;
+        }
+
+        completePending();
+
+        if ( isDuplicate( _event.mInstanceId ) )
+            return true;
+
+        if ( !m_duplicateOf.empty() || m_redirectedBy.contains( _event.mInstanceId ) )
+        {
+            if ( const auto it = m_messageRefOffsets.find( messageKey( _event.mMessageName ) ); it != m_messageRefOffsets.end() )
+            {
+                _event.mData = redirectFields( _event.mData, it->second );
+                rememberValue( _event.mInstanceId, messageKey( _event.mMessageName ), _event );
+            }
+        }
+        return false;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::BeginPropertyMessageGroup& _event )
+    {
+        completePending();
+
+        m_groupMessageName = _event.mMsgName;
+        return false;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::SendPropertyMessageFromGroup& _event )
+    {
+        completePending();
+
+        if ( isDuplicate( _event.mInstance ) )
+            return true;
+
+        if ( !m_duplicateOf.empty() || m_redirectedBy.contains( _event.mInstance ) )
+        {
+            if ( const auto it = m_messageRefOffsets.find( messageKey( m_groupMessageName ) ); it != m_messageRefOffsets.end() )
+            {
+                _event.mData = redirectFields( _event.mData, it->second );
+
+                // written again, if it comes to that, as the SetPropertyMessage it stands for
+                physx::pvdsdk::SetPropertyMessage message;
+                message.mInstanceId  = _event.mInstance;
+                message.mMessageName = m_groupMessageName;
+                message.mData        = _event.mData;
+                rememberValue( _event.mInstance, messageKey( m_groupMessageName ), message );
+            }
+        }
+        return false;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::DestroyInstance& _event )
+    {
+        completePending();
+
+        const uint64_t instanceID = _event.mInstanceId;
+
+        // whatever it was referring to no longer matters
+        m_redirectedBy.erase( instanceID );
+
+        // duplicates never made it to the output, but they were keeping their canonical instance alive
+        if ( const auto duplicate = m_duplicateOf.find( instanceID ); duplicate != m_duplicateOf.end() )
+        {
+            const uint64_t canonicalID = duplicate->second;
+            m_duplicateOf.erase( duplicate );
+
+            if ( const auto canonical = m_canonicals.find( canonicalID ); canonical != m_canonicals.end() )
+            {
+                canonical->second.m_liveDuplicates--;
+                if ( canonical->second.m_destroyed && canonical->second.m_liveDuplicates == 0 )
+                {
+                    physx::pvdsdk::DestroyInstance destroy;
+                    destroy.mInstanceId = canonicalID;
+                    m_released.push_back( { destroy, {} } );
+                    m_canonicals.erase( canonical );
+                }
+            }
+            return true;
+        }
+
+        if ( const auto canonical = m_canonicals.find( instanceID ); canonical != m_canonicals.end() )
+        {
+            // new instances with this content will have to find a new canonical
+            if ( const auto content = m_contents.find( canonical->second.m_content ); content != m_contents.end() && content->second == instanceID )
+                m_contents.erase( content );
+
+            if ( canonical->second.m_liveDuplicates > 0 )
+            {
+                canonical->second.m_destroyed = true;
+                return true;
+            }
+            m_canonicals.erase( canonical );
+        }
+        return false;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::PushBackObjectRef& _event )
+    {
+        completePending();
+
+        if ( isDuplicate( _event.mInstanceId ) )
+            return true;
+
+        if ( isDuplicate( _event.mObjectRef ) )
+        {
+            _event.mObjectRef = redirect( _event.mObjectRef );
+            m_redirectedBy[_event.mInstanceId].m_collections.push_back( _event );
+            m_redirectedReferences++;
+        }
+        return false;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::RemoveObjectRef& _event )
+    {
+        completePending();
+
+        if ( isDuplicate( _event.mInstanceId ) )
+            return true;
+
+        if ( isDuplicate( _event.mObjectRef ) )
+        {
+            _event.mObjectRef = redirect( _event.mObjectRef );
+            m_redirectedReferences++;
+
+            if ( const auto it = m_redirectedBy.find( _event.mInstanceId ); it != m_redirectedBy.end() )
+            {
+                auto& collections = it->second.m_collections;
+                const auto entry = std::find_if( collections.begin(), collections.end(), [&]( const physx::pvdsdk::PushBackObjectRef& pushed )
+                {
+                    return pushed.mProperty == _event.mProperty && pushed.mObjectRef == _event.mObjectRef;
+                } );
+                if ( entry != collections.end() )
+                    collections.erase( entry );
+            }
+        }
+        return false;
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::SetPickable& _event )
+    {
+        completePending();
+        return isDuplicate( _event.mInstanceId );
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::SetColor& _event )
+    {
+        completePending();
+        return isDuplicate( _event.mInstanceId );
+    }
+
+    bool PayloadDeduplicator::accept( physx::pvdsdk::SetIsTopLevel& _event )
+    {
+        completePending();
+        return isDuplicate( _event.mInstanceId );
+    }
+
+} // namespace Op
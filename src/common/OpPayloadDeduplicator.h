@@ -0,0 +1,271 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// content-addressed deduplication of mesh / heightfield instances. A new geometry instance is held back, along with
+// the property data that follows its creation, until the stream moves on to something else; by then its contents
+// are known and hashed (Op::hashPayload). The first instance with a given hash becomes the canonical one and is
+// released to be written out; a later instance whose hash matches and whose payload bytes compare equal is dropped
+// and every reference to it - PushBackObjectRef / RemoveObjectRef targets, ObjectRef property values and ObjectRef
+// fields of property messages - is redirected to the canonical ID instead.
+//
+// The canonical instance is kept alive for as long as anything is still using it through a duplicate; if it is
+// destroyed first, its DestroyInstance is held back until the last of those duplicates goes away. Should the stream
+// reuse its ID before then, one of the live duplicates is written out after all - rebuilt from the canonical's
+// payload - and takes over as canonical for the rest. Every redirected reference that is still in force is then
+// written again, pointing at the promoted instance, so nothing is left referring to the ID that is about to be reused
+//
+
+#pragma once
+
+#include "PxPvdCommStreamEvents.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class PayloadDeduplicator
+    {
+    public:
+
+        PayloadDeduplicator();
+
+        void onStringHandle( const physx::pvdsdk::StringHandleEvent& _event );
+        void onCreatePropertyMessage( const physx::pvdsdk::CreatePropertyMessage& _event );
+
+        // offer every kept event, in stream order; returns true if the deduplicator has taken it - either held back as
+        // part of a geometry instance that isn't complete yet, or dropped as part of a duplicate. Events that are not
+        // taken may have been rewritten to point at canonical instances. Anything that gets released as a result is
+        // available from release() afterwards, and has to be written before the event that was offered
+        bool accept( physx::pvdsdk::CreateInstance& _event );
+        bool accept( physx::pvdsdk::SetPropertyValue& _event );
+        bool accept( physx::pvdsdk::BeginSetPropertyValue& _event );
+        bool accept( physx::pvdsdk::AppendPropertyValueData& _event );
+        bool accept( physx::pvdsdk::EndSetPropertyValue& _event );
+        bool accept( physx::pvdsdk::SetPropertyMessage& _event );
+        bool accept( physx::pvdsdk::BeginPropertyMessageGroup& _event );
+        bool accept( physx::pvdsdk::SendPropertyMessageFromGroup& _event );
+        bool accept( physx::pvdsdk::DestroyInstance& _event );
+        bool accept( physx::pvdsdk::PushBackObjectRef& _event );
+        bool accept( physx::pvdsdk::RemoveObjectRef& _event );
+        bool accept( physx::pvdsdk::SetPickable& _event );
+        bool accept( physx::pvdsdk::SetColor& _event );
+        bool accept( physx::pvdsdk::SetIsTopLevel& _event );
+
+        template< typename TEvent >
+        inline bool accept( TEvent& )
+        {
+            completePending();
+            return false;
+        }
+
+        // end of the stream; decide on whatever is still being held
+        inline void finish()
+        {
+            completePending();
+        }
+
+        // hand each released event to fn( auto& event ), in order
+        template< typename TFunc >
+        void release( TFunc&& fn );
+
+        [[nodiscard]] inline uint64_t canonicalInstances() const    { return m_canonicalInstances; }
+        [[nodiscard]] inline uint64_t duplicateInstances() const    { return m_duplicateInstances; }
+        [[nodiscard]] inline uint64_t bytesSaved() const            { return m_bytesSaved; }
+        [[nodiscard]] inline uint64_t redirectedReferences() const  { return m_redirectedReferences; }
+
+    private:
+
+        using HeldVariant = std::variant<
+            physx::pvdsdk::CreateInstance,
+            physx::pvdsdk::SetPropertyValue,
+            physx::pvdsdk::BeginSetPropertyValue,
+            physx::pvdsdk::AppendPropertyValueData,
+            physx::pvdsdk::EndSetPropertyValue,
+            physx::pvdsdk::SetPropertyMessage,
+            physx::pvdsdk::DestroyInstance,
+            physx::pvdsdk::PushBackObjectRef,
+            physx::pvdsdk::RemoveObjectRef >;
+
+        // an event with a private copy of its payload, if it has one
+        struct HeldEvent
+        {
+            HeldVariant             m_event;
+            std::vector< uint8_t >  m_data;
+        };
+
+        // an event held as part of a geometry instance; its payload, if it has one, is the next m_dataSize bytes of the
+        // instance's payload buffer (the event's own DataRef is left pointing at the stream and is never read)
+        struct LayoutEntry
+        {
+            HeldVariant     m_event;
+            uint32_t        m_dataSize = 0;
+        };
+
+        struct PendingInstance
+        {
+            uint64_t                    m_instanceID    = 0;
+            uint32_t                    m_classHandle   = 0;
+            uint64_t                    m_hash          = 0;
+            bool                        m_inSequence    = false;
+            std::vector< LayoutEntry >  m_layout;
+            std::vector< uint8_t >      m_payload;
+        };
+
+        struct ContentKey
+        {
+            uint32_t    m_classHandle;
+            uint64_t    m_hash;
+            uint64_t    m_bytes;
+
+            bool operator==( const ContentKey& rhs ) const
+            {
+                return m_classHandle == rhs.m_classHandle && m_hash == rhs.m_hash && m_bytes == rhs.m_bytes;
+            }
+        };
+
+        struct ContentKeyHash
+        {
+            using is_avalanching = void;
+
+            uint64_t operator()( const ContentKey& key ) const noexcept
+            {
+                using namespace ankerl::unordered_dense::detail;
+                return wyhash::mix( key.m_hash ^ key.m_classHandle, key.m_bytes );
+            }
+        };
+
+        struct Canonical
+        {
+            ContentKey  m_content;
+            uint32_t    m_liveDuplicates    = 0;
+            bool        m_destroyed         = false;    // its DestroyInstance is being held back
+
+            std::vector< LayoutEntry >  m_layout;       // creation and initial properties, to compare against and to
+            std::vector< uint8_t >      m_payload;      // hand over to a duplicate
+        };
+
+        // the last value written for a property or message whose ObjectRef fields were redirected to a canonical
+        struct RedirectedValue
+        {
+            HeldVariant             m_event;            // SetPropertyValue or SetPropertyMessage
+            std::vector< uint8_t >  m_data;
+            std::vector< uint32_t > m_offsets;          // of the redirected fields
+        };
+
+        // references written out by one instance that point at a canonical on behalf of one of its duplicates
+        struct RedirectedReferences
+        {
+            ankerl::unordered_dense::map< uint32_t, RedirectedValue >   m_properties;
+            ankerl::unordered_dense::map< uint64_t, RedirectedValue >   m_messages;
+            std::vector< physx::pvdsdk::PushBackObjectRef >             m_collections;
+        };
+
+        template< typename TEvent >
+        void hold( const TEvent& _event, const physx::pvdsdk::DataRef<const uint8_t>* data );
+
+        void completePending();
+
+        // queue the events of an instance for writing out under the given ID
+        void releaseLayout( const std::vector< LayoutEntry >& layout, const std::vector< uint8_t >& payload, const uint64_t instanceID );
+
+        // a destroyed canonical's ID is about to be reused; write out one of its duplicates in its place
+        void promoteDuplicate( const uint64_t canonicalID, Canonical& canonical );
+
+        // write again every redirected reference to canonicalID that is still in force, pointing it at promotedID
+        void retargetReferences( const uint64_t canonicalID, const uint64_t promotedID );
+
+        // keep (or forget) the value just written for a property / message, depending on whether redirectFields()
+        // rewrote any of it
+        template< typename TEvent >
+        void rememberValue( const uint64_t referrerID, const uint64_t key, const TEvent& _event );
+
+        // fold one piece of the pending instance's contents into its hash
+        void hashContent( const uint64_t tag, const physx::pvdsdk::DataRef<const uint8_t>& data );
+
+        inline uint64_t redirect( const uint64_t instanceID ) const
+        {
+            const auto it = m_duplicateOf.find( instanceID );
+            return ( it != m_duplicateOf.end() ) ? it->second : instanceID;
+        }
+
+        inline bool isDuplicate( const uint64_t instanceID ) const
+        {
+            return m_duplicateOf.contains( instanceID );
+        }
+
+        // rewrite any duplicate IDs in ObjectRef fields of a payload, returning the payload to write; the offsets of the
+        // fields it rewrote are left in m_redirectedOffsets
+        physx::pvdsdk::DataRef<const uint8_t> redirectFields( const physx::pvdsdk::DataRef<const uint8_t>& data, const std::vector< uint32_t >& offsets );
+
+        static inline uint64_t messageKey( const physx::pvdsdk::StreamNamespacedName& messageName )
+        {
+            return ( static_cast<uint64_t>( messageName.mNamespace ) << 32 ) | messageName.mName;
+        }
+
+        ankerl::unordered_dense::set< uint32_t >                        m_classHandles;         // geometry classes to deduplicate
+        bool                                                            m_objectRefKnown = false;
+        uint32_t                                                        m_objectRefHandle = 0;
+        ankerl::unordered_dense::map< uint64_t, std::vector< uint32_t > > m_messageRefOffsets;  // message -> ObjectRef field offsets
+        physx::pvdsdk::StreamNamespacedName                             m_groupMessageName;
+
+        std::unique_ptr< PendingInstance >                              m_pending;
+        std::vector< HeldEvent >                                        m_released;
+
+        ankerl::unordered_dense::map< ContentKey, uint64_t, ContentKeyHash > m_contents;       // -> canonical instance
+        ankerl::unordered_dense::map< uint64_t, Canonical >             m_canonicals;
+        ankerl::unordered_dense::map< uint64_t, uint64_t >              m_duplicateOf;          // duplicate -> canonical
+        bool                                                            m_droppingSequence = false;
+        ankerl::unordered_dense::map< uint64_t, RedirectedReferences >  m_redirectedBy;         // referring instance -> its references
+
+        std::vector< uint8_t >                                          m_redirectScratch;
+        std::vector< uint32_t >                                         m_redirectedOffsets;
+
+        uint64_t        m_canonicalInstances    = 0;
+        uint64_t        m_duplicateInstances    = 0;
+        uint64_t        m_bytesSaved            = 0;
+        uint64_t        m_redirectedReferences  = 0;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    namespace dedupe_detail
+    {
+        inline void attachData( physx::pvdsdk::SetPropertyValue& _event, const std::vector< uint8_t >& data )
+        {
+            _event.mData = physx::pvdsdk::DataRef<const uint8_t>( data.data(), static_cast<uint32_t>( data.size() ) );
+        }
+        inline void attachData( physx::pvdsdk::AppendPropertyValueData& _event, const std::vector< uint8_t >& data )
+        {
+            _event.mData = physx::pvdsdk::DataRef<const uint8_t>( data.data(), static_cast<uint32_t>( data.size() ) );
+        }
+        inline void attachData( physx::pvdsdk::SetPropertyMessage& _event, const std::vector< uint8_t >& data )
+        {
+            _event.mData = physx::pvdsdk::DataRef<const uint8_t>( data.data(), static_cast<uint32_t>( data.size() ) );
+        }
+
+        template< typename TEvent >
+        inline void attachData( TEvent&, const std::vector< uint8_t >& )
+        {
+        }
+    }
+
+    template< typename TFunc >
+    void PayloadDeduplicator::release( TFunc&& fn )
+    {
+        if ( m_released.empty() )
+            return;
+
+        for ( auto& held : m_released )
+        {
+            std::visit( [&]( auto& _event )
+            {
+                dedupe_detail::attachData( _event, held.m_data );
+                fn( _event );
+            }, held.m_event );
+        }
+        m_released.clear();
+    }
+
+} // namespace Op
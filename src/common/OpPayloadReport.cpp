@@ -0,0 +1,205 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpPayloadReport.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    PayloadReport::PayloadReport( const uint32_t topCount )
+        : m_topCount( std::max( topCount, 1U ) )
+    {
+    }
+
+    PayloadReport::~PayloadReport()
+    {
+        if ( m_foldedFile != nullptr )
+            fclose( m_foldedFile );
+    }
+
+    bool PayloadReport::openFolded( const std::string& filename, const uint32_t bucketFrames )
+    {
+        m_foldedFile = fopen( filename.c_str(), "w" );
+        if ( m_foldedFile == nullptr )
+        {
+            spdlog::error( "unable to write folded stacks to [{}]", filename );
+            return false;
+        }
+        m_bucketFrames = std::max( bucketFrames, 1U );
+        return true;
+    }
+
+    std::string_view PayloadReport::lookupString( const MasterStringTable& _strings, const uint32_t handle )
+    {
+        if ( handle == 0 )
+            return "unknown";
+        return _strings.lookupStringByHandle( handle );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PayloadReport::addPayload( const uint64_t instanceID, const uint32_t propertyHandle, const uint64_t bytes, const PvdEventType eventType )
+    {
+        if ( bytes == 0 )
+            return;
+
+        m_totalBytes += bytes;
+
+        const auto classIt = m_instanceClasses.find( instanceID );
+        const uint32_t classHandle = ( classIt != m_instanceClasses.end() ) ? classIt->second : 0;
+
+        const uint64_t key = contributorKey( classHandle, propertyHandle );
+        m_contributorBytes[key] += bytes;
+        if ( m_foldedFile != nullptr )
+            m_bucketBytes[key] += bytes;
+
+        if ( m_largestEvents.size() < m_topCount || bytes > m_largestEvents.top().m_bytes )
+        {
+            if ( m_largestEvents.size() >= m_topCount )
+                m_largestEvents.pop();
+            m_largestEvents.push( { bytes, m_currentFrame, instanceID, classHandle, propertyHandle, eventType } );
+        }
+    }
+
+    void PayloadReport::writeFoldedBucket( const MasterStringTable& _strings )
+    {
+        if ( m_foldedFile == nullptr )
+            return;
+
+        const uint64_t bucketEnd = m_bucketStart + m_bucketFrames - 1;
+        for ( const auto& [key, bytes] : m_bucketBytes )
+        {
+            fmt::print( m_foldedFile, "{};{};frames {}-{} {}\n",
+                lookupString( _strings, static_cast<uint32_t>( key >> 32 ) ),
+                lookupString( _strings, static_cast<uint32_t>( key ) ),
+                m_bucketStart,
+                bucketEnd,
+                bytes );
+        }
+        m_bucketBytes.clear();
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PayloadReport::onFrame( const MasterStringTable& _strings, const uint64_t frame )
+    {
+        m_currentFrame = frame;
+        if ( m_currentFrame >= m_bucketStart + m_bucketFrames )
+        {
+            writeFoldedBucket( _strings );
+            m_bucketStart = m_currentFrame - ( m_currentFrame % m_bucketFrames );
+        }
+    }
+
+    void PayloadReport::observe( const pvd::CreateInstance& _event )
+    {
+        m_instanceClasses.insert_or_assign( _event.mInstanceId, static_cast<uint32_t>( _event.mClass.mName ) );
+    }
+
+    void PayloadReport::observe( const pvd::DestroyInstance& _event )
+    {
+        m_instanceClasses.erase( _event.mInstanceId );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PayloadReport::observe( const pvd::SetPropertyValue& _event )
+    {
+        addPayload( _event.mInstanceId, _event.mPropertyName, _event.mData.size(), PvdEventType::SetPropertyValue );
+    }
+
+    void PayloadReport::observe( const pvd::BeginSetPropertyValue& _event )
+    {
+        m_sequenceInstance = _event.mInstanceId;
+        m_sequenceProperty = _event.mPropertyName;
+        m_sequenceBytes    = 0;
+    }
+
+    void PayloadReport::observe( const pvd::AppendPropertyValueData& _event )
+    {
+        m_sequenceBytes += _event.mData.size();
+    }
+
+    void PayloadReport::observe( const pvd::EndSetPropertyValue& )
+    {
+        addPayload( m_sequenceInstance, m_sequenceProperty, m_sequenceBytes, PvdEventType::BeginSetPropertyValue );
+        m_sequenceBytes = 0;
+    }
+
+    void PayloadReport::observe( const pvd::SetPropertyMessage& _event )
+    {
+        addPayload( _event.mInstanceId, _event.mMessageName.mName, _event.mData.size(), PvdEventType::SetPropertyMessage );
+    }
+
+    void PayloadReport::observe( const pvd::BeginPropertyMessageGroup& _event )
+    {
+        m_groupMessage = _event.mMsgName.mName;
+    }
+
+    void PayloadReport::observe( const pvd::SendPropertyMessageFromGroup& _event )
+    {
+        addPayload( _event.mInstance, m_groupMessage, _event.mData.size(), PvdEventType::SendPropertyMessageFromGroup );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PayloadReport::logSummary( const MasterStringTable& _strings )
+    {
+        writeFoldedBucket( _strings );
+        if ( m_foldedFile != nullptr )
+        {
+            fclose( m_foldedFile );
+            m_foldedFile = nullptr;
+        }
+
+        const auto percentOfTotal = [this]( const uint64_t bytes )
+        {
+            return ( m_totalBytes > 0 ) ? ( 100.0 * static_cast<double>( bytes ) / static_cast<double>( m_totalBytes ) ) : 0.0;
+        };
+
+        spdlog::info( "{:>32} = {} bytes ", "total payload", m_totalBytes );
+
+        // drain the heap, largest first
+        std::vector< LargeEvent > largestEvents;
+        largestEvents.reserve( m_largestEvents.size() );
+        while ( !m_largestEvents.empty() )
+        {
+            largestEvents.push_back( m_largestEvents.top() );
+            m_largestEvents.pop();
+        }
+        std::reverse( largestEvents.begin(), largestEvents.end() );
+
+        spdlog::info( "largest {} events :", largestEvents.size() );
+        for ( const auto& largeEvent : largestEvents )
+        {
+            spdlog::info( "  {:>12} bytes | frame {:>7} | {:#018x} | {}.{} ({})",
+                largeEvent.m_bytes,
+                largeEvent.m_frame,
+                largeEvent.m_instanceID,
+                lookupString( _strings, largeEvent.m_classHandle ),
+                lookupString( _strings, largeEvent.m_propertyHandle ),
+                eventTypeToString( largeEvent.m_eventType ) );
+        }
+
+        // contributors are bounded by the schema, so a partial sort over all of them is cheap
+        std::vector< std::pair< uint64_t, uint64_t > > contributors( m_contributorBytes.begin(), m_contributorBytes.end() );
+        const std::size_t contributorCount = std::min< std::size_t >( m_topCount, contributors.size() );
+        std::partial_sort( contributors.begin(), contributors.begin() + contributorCount, contributors.end(),
+            []( const auto& lhs, const auto& rhs ) { return lhs.second > rhs.second; } );
+
+        spdlog::info( "largest {} class.property contributors :", contributorCount );
+        for ( std::size_t index = 0; index < contributorCount; index++ )
+        {
+            const auto& [key, bytes] = contributors[index];
+            spdlog::info( "  {:>12} bytes | {:5.1f}% | {}.{}",
+                bytes,
+                percentOfTotal( bytes ),
+                lookupString( _strings, static_cast<uint32_t>( key >> 32 ) ),
+                lookupString( _strings, static_cast<uint32_t>( key ) ) );
+        }
+    }
+
+} // namespace Op
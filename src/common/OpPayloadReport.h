@@ -0,0 +1,117 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// answers "what is eating the space" in a capture; every property value and property message payload is attributed
+// to the class of the instance it was sent for and the property (or message) it wrote, then reported as the K largest
+// single events - with the frame and instance they came from - and the K largest ( class, property ) totals.
+//
+// The largest events are kept in a bounded min-heap, so memory stays fixed however long the stream is; totals are
+// per ( class, property ) pair, which is bounded by the schema rather than the capture. Optionally the totals are also
+// written as folded stacks ( class;property;frames bytes ) per bucket of frames, for rendering with flamegraph tools;
+// each bucket is written out as soon as it closes
+//
+
+#pragma once
+
+#include "common/OpEventUnpacker.h"
+#include "common/OpMasterStringTable.h"
+
+#include <queue>
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class PayloadReport
+    {
+    public:
+
+        PayloadReport( const uint32_t topCount );
+        ~PayloadReport();
+
+        // optional folded stack output, grouping frames into buckets of bucketFrames
+        bool openFolded( const std::string& filename, const uint32_t bucketFrames );
+
+        // every event, once the stream's string table and frame count have been brought up to date with it
+        template< typename TEvent >
+        inline void record( const MasterStringTable& _strings, const uint64_t _frame, const TEvent& _event )
+        {
+            if ( _frame != m_currentFrame )
+                onFrame( _strings, _frame );
+
+            observe( _event );
+        }
+
+        // logs the largest events and contributors, and writes out the last folded bucket
+        void logSummary( const MasterStringTable& _strings );
+
+    private:
+
+        struct LargeEvent
+        {
+            uint64_t        m_bytes;
+            uint64_t        m_frame;
+            uint64_t        m_instanceID;
+            uint32_t        m_classHandle;
+            uint32_t        m_propertyHandle;
+            PvdEventType    m_eventType;
+
+            // ordered so the priority_queue keeps the smallest on top, ready to be evicted
+            inline bool operator > ( const LargeEvent& rhs ) const { return m_bytes > rhs.m_bytes; }
+        };
+
+        // class name handle in the upper half, property name handle in the lower
+        static inline uint64_t contributorKey( const uint32_t classHandle, const uint32_t propertyHandle )
+        {
+            return ( static_cast<uint64_t>( classHandle ) << 32 ) | propertyHandle;
+        }
+
+        void observe( const pvd::CreateInstance& _event );
+        void observe( const pvd::DestroyInstance& _event );
+        void observe( const pvd::SetPropertyValue& _event );
+        void observe( const pvd::BeginSetPropertyValue& _event );
+        void observe( const pvd::AppendPropertyValueData& _event );
+        void observe( const pvd::EndSetPropertyValue& _event );
+        void observe( const pvd::SetPropertyMessage& _event );
+        void observe( const pvd::BeginPropertyMessageGroup& _event );
+        void observe( const pvd::SendPropertyMessageFromGroup& _event );
+
+        template< typename TEvent >
+        inline void observe( const TEvent& ) {}
+
+        void onFrame( const MasterStringTable& _strings, const uint64_t frame );
+        void addPayload( const uint64_t instanceID, const uint32_t propertyHandle, const uint64_t bytes, const PvdEventType eventType );
+        void writeFoldedBucket( const MasterStringTable& _strings );
+
+        // events on instances that were never created have no class handle
+        [[nodiscard]] static std::string_view lookupString( const MasterStringTable& _strings, const uint32_t handle );
+
+        const uint32_t                                              m_topCount;
+
+        std::priority_queue< LargeEvent, std::vector< LargeEvent >, std::greater< LargeEvent > > m_largestEvents;
+
+        ankerl::unordered_dense::map< uint64_t, uint64_t >          m_contributorBytes;
+        ankerl::unordered_dense::map< uint64_t, uint64_t >          m_bucketBytes;
+
+        FILE*                                                       m_foldedFile        = nullptr;
+        uint32_t                                                    m_bucketFrames      = 1;
+        uint64_t                                                    m_bucketStart       = 0;
+
+        ankerl::unordered_dense::map< uint64_t, uint32_t >          m_instanceClasses;  // live instance -> class name handle
+
+        // Begin/Append/End sequences are counted as one event
+        uint64_t                                                    m_sequenceInstance  = 0;
+        uint32_t                                                    m_sequenceProperty  = 0;
+        uint64_t                                                    m_sequenceBytes     = 0;
+
+        uint32_t                                                    m_groupMessage      = 0;
+
+        uint64_t                                                    m_currentFrame      = 0;
+
+        uint64_t                                                    m_totalBytes        = 0;
+    };
+
+} // namespace Op
@@ -0,0 +1,235 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpProfileTrace.h"
+
+namespace Op
+{
+    namespace
+    {
+        // EventStreamCompressionFlags; U64 timestamps are absolute, anything narrower is a delta
+        static constexpr uint8_t cCompressionU64    = 3;
+        static constexpr uint8_t cCompressionMask   = 3;
+
+        std::string escapeJSON( const std::string& text )
+        {
+            std::string escaped;
+            escaped.reserve( text.size() );
+            for ( const char c : text )
+            {
+                if ( c == '"' || c == '\\' )
+                    escaped.push_back( '\\' );
+                if ( static_cast<unsigned char>( c ) >= 0x20 )
+                    escaped.push_back( c );
+            }
+            return escaped;
+        }
+
+        // bounds-checked reads through a profile event buffer
+        struct BufferCursor
+        {
+            const uint8_t*  m_data;
+            std::size_t     m_size;
+            std::size_t     m_offset = 0;
+
+            template< typename T >
+            inline bool read( T& value )
+            {
+                if ( m_offset + sizeof( T ) > m_size )
+                    return false;
+                std::memcpy( &value, m_data + m_offset, sizeof( T ) );
+                m_offset += sizeof( T );
+                return true;
+            }
+
+            inline bool readCompressed( const uint8_t compression, uint64_t& value )
+            {
+                switch ( compression & cCompressionMask )
+                {
+                    case 0: { uint8_t  v; if ( !read( v ) ) return false; value = v; return true; }
+                    case 1: { uint16_t v; if ( !read( v ) ) return false; value = v; return true; }
+                    case 2: { uint32_t v; if ( !read( v ) ) return false; value = v; return true; }
+                    default:            return read( value );
+                }
+            }
+
+            [[nodiscard]] inline bool done() const { return m_offset >= m_size; }
+        };
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    ProfileTraceExporter::~ProfileTraceExporter()
+    {
+        if ( m_file != nullptr )
+            fclose( m_file );
+    }
+
+    bool ProfileTraceExporter::open( const std::string& filename )
+    {
+        m_file = fopen( filename.c_str(), "w" );
+        if ( m_file == nullptr )
+        {
+            spdlog::error( "unable to write trace to [{}]", filename );
+            return false;
+        }
+
+        // timestamps are in tens of nanoseconds, converted to the microseconds Chrome traces use
+        fputs( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", m_file );
+        return true;
+    }
+
+    bool ProfileTraceExporter::finish()
+    {
+        if ( m_file == nullptr )
+            return false;
+
+        fputs( "\n]}\n", m_file );
+
+        const bool bClosed = ( fclose( m_file ) == 0 );
+        m_file = nullptr;
+        return bClosed;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ProfileTraceExporter::record( const pvd::AddProfileZone& _event )
+    {
+        // a zone added again keeps its pid, only the name can change
+        auto [zoneIt, bNewZone] = m_zones.try_emplace( _event.mInstanceId );
+        ProfileZone& zone = zoneIt->second;
+        zone.m_name = _event.mName;
+        if ( bNewZone )
+            zone.m_pid = m_nextPid++;
+
+        if ( m_file != nullptr )
+        {
+            fmt::print( m_file, "{}{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                m_firstTraceEvent ? "" : ",\n", zone.m_pid, escapeJSON( zone.m_name ) );
+            m_firstTraceEvent = false;
+        }
+    }
+
+    void ProfileTraceExporter::record( const pvd::AddProfileZoneEvent& _event )
+    {
+        if ( const auto it = m_zones.find( _event.mInstanceId ); it != m_zones.end() )
+            it->second.m_eventNames.insert_or_assign( _event.mEventId, std::string( _event.mName ) );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ProfileTraceExporter::record( const pvd::SetPropertyValue& _event )
+    {
+        if ( const auto it = m_zones.find( _event.mInstanceId ); it != m_zones.end() )
+            decodeBuffer( it->second, _event.mData.begin(), _event.mData.size() );
+    }
+
+    void ProfileTraceExporter::record( const pvd::BeginSetPropertyValue& _event )
+    {
+        m_bSequenceZone  = m_zones.contains( _event.mInstanceId );
+        m_sequenceZoneID = _event.mInstanceId;
+        m_sequenceData.clear();
+    }
+
+    void ProfileTraceExporter::record( const pvd::AppendPropertyValueData& _event )
+    {
+        if ( m_bSequenceZone )
+            m_sequenceData.insert( m_sequenceData.end(), _event.mData.begin(), _event.mData.end() );
+    }
+
+    void ProfileTraceExporter::record( const pvd::EndSetPropertyValue& )
+    {
+        if ( m_bSequenceZone )
+        {
+            if ( const auto it = m_zones.find( m_sequenceZoneID ); it != m_zones.end() )
+                decodeBuffer( it->second, m_sequenceData.data(), m_sequenceData.size() );
+        }
+
+        m_bSequenceZone = false;
+        m_sequenceData.clear();
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ProfileTraceExporter::decodeBuffer( ProfileZone& zone, const uint8_t* data, const std::size_t size )
+    {
+        BufferCursor cursor{ data, size };
+
+        // each flushed buffer starts afresh, with a full context and an absolute timestamp
+        uint64_t lastTimestamp = 0;
+        uint32_t threadId      = 0;
+        uint64_t contextId     = 0;
+
+        while ( !cursor.done() )
+        {
+            uint8_t  eventType;
+            uint8_t  streamOptions;
+            uint16_t eventId;
+            if ( !cursor.read( eventType ) || !cursor.read( streamOptions ) || !cursor.read( eventId ) )
+                break;
+
+            const auto type = static_cast<ProfileEventType>( eventType );
+            const bool bFullEvent = ( type == ProfileEventType::StartEvent || type == ProfileEventType::StopEvent );
+            const bool bRelative  = ( type == ProfileEventType::RelativeStartEvent || type == ProfileEventType::RelativeStopEvent );
+            if ( !bFullEvent && !bRelative )
+            {
+                // values, CUDA buffers and the like have layouts we don't decode, and there's no way to skip over them
+                m_undecodedBuffers++;
+                return;
+            }
+
+            if ( bFullEvent )
+            {
+                uint8_t threadPriority, cpuId;
+                if ( !cursor.read( threadId ) ||
+                     !cursor.readCompressed( streamOptions >> 2, contextId ) ||
+                     !cursor.read( threadPriority ) ||
+                     !cursor.read( cpuId ) )
+                    break;
+            }
+
+            uint64_t timestamp;
+            if ( !cursor.readCompressed( streamOptions, timestamp ) )
+                break;
+            if ( ( streamOptions & cCompressionMask ) != cCompressionU64 )
+                timestamp += lastTimestamp;
+            lastTimestamp = timestamp;
+
+            const bool bStart = ( type == ProfileEventType::StartEvent || type == ProfileEventType::RelativeStartEvent );
+            writeTraceEvent( zone, eventId, bStart, threadId, contextId, timestamp );
+        }
+
+        if ( !cursor.done() )
+            m_undecodedBuffers++;
+    }
+
+    void ProfileTraceExporter::writeTraceEvent( const ProfileZone& zone, const uint16_t eventId, const bool bStart, const uint32_t threadId, const uint64_t contextId, const uint64_t timestamp )
+    {
+        if ( m_file == nullptr )
+            return;
+
+        std::string name;
+        if ( const auto it = zone.m_eventNames.find( eventId ); it != zone.m_eventNames.end() )
+            name = escapeJSON( it->second );
+        else
+            name = fmt::format( "event {}", eventId );
+
+        // tens of nanoseconds -> microseconds
+        fmt::print( m_file, "{}{{\"name\":\"{}\",\"ph\":\"{}\",\"ts\":{}.{:02},\"pid\":{},\"tid\":{},\"args\":{{\"context\":{}}}}}",
+            m_firstTraceEvent ? "" : ",\n",
+            name,
+            bStart ? "B" : "E",
+            timestamp / 100, timestamp % 100,
+            zone.m_pid,
+            threadId,
+            contextId );
+        m_firstTraceEvent = false;
+
+        if ( bStart )
+            m_spansWritten++;
+    }
+
+} // namespace Op
@@ -0,0 +1,91 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// exports the PhysX profiler data carried in a stream as a Chrome trace (chrome://tracing, ui.perfetto.dev), so
+// simulation task timings can be lined up next to an engine's own traces.
+//
+// AddProfileZone declares a profile zone instance and AddProfileZoneEvent names the event IDs used within it; the
+// profiler then periodically flushes its event buffer into the zone's "events" property. That buffer is a packed
+// sequence of PxProfileEvents records - a 4 byte header ( type, compression options, event id ) followed by
+// thread / context information and a timestamp in tens of nanoseconds, each compressed to 1, 2, 4 or 8 bytes. Full
+// Start / Stop events carry the context, Relative ones reuse the previous event's; timestamps are deltas from the
+// previous event unless sent at full width.
+//
+// Each start / stop is written straight out as a Chrome "B" / "E" event on ( zone, thread ), so spans are never held
+// in memory and captures with millions of them stream through. Record types that can't be decoded end the parse of
+// that buffer, and are counted
+//
+
+#pragma once
+
+#include "common/OpEventUnpacker.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class ProfileTraceExporter
+    {
+    public:
+
+        ~ProfileTraceExporter();
+
+        bool open( const std::string& filename );
+
+        // closes out the JSON and the file
+        bool finish();
+
+        void record( const pvd::AddProfileZone& _event );
+        void record( const pvd::AddProfileZoneEvent& _event );
+        void record( const pvd::SetPropertyValue& _event );
+        void record( const pvd::BeginSetPropertyValue& _event );
+        void record( const pvd::AppendPropertyValueData& _event );
+        void record( const pvd::EndSetPropertyValue& _event );
+
+        template< typename TEvent >
+        inline void record( const TEvent& ) {}
+
+        [[nodiscard]] inline uint64_t spansWritten() const      { return m_spansWritten; }
+        [[nodiscard]] inline uint64_t undecodedBuffers() const  { return m_undecodedBuffers; }
+
+    private:
+
+        // record types from PxProfileEvents.h
+        enum class ProfileEventType : uint8_t
+        {
+            Unknown             = 0,
+            StartEvent,
+            StopEvent,
+            RelativeStartEvent,
+            RelativeStopEvent,
+        };
+
+        struct ProfileZone
+        {
+            std::string                                             m_name;
+            uint32_t                                                m_pid;
+            ankerl::unordered_dense::map< uint16_t, std::string >   m_eventNames;
+        };
+
+        void decodeBuffer( ProfileZone& zone, const uint8_t* data, const std::size_t size );
+        void writeTraceEvent( const ProfileZone& zone, const uint16_t eventId, const bool bStart, const uint32_t threadId, const uint64_t contextId, const uint64_t timestamp );
+
+        FILE*                                                   m_file              = nullptr;
+        bool                                                    m_firstTraceEvent   = true;
+
+        ankerl::unordered_dense::map< uint64_t, ProfileZone >   m_zones;
+        uint32_t                                                m_nextPid           = 1;
+
+        // an "events" buffer arriving as a Begin/Append/End sequence; the zone is held by ID, as adding zones moves them
+        bool                                                    m_bSequenceZone     = false;
+        uint64_t                                                m_sequenceZoneID    = 0;
+        std::vector< uint8_t >                                  m_sequenceData;
+
+        uint64_t                                                m_spansWritten      = 0;
+        uint64_t                                                m_undecodedBuffers  = 0;
+    };
+
+} // namespace Op
@@ -0,0 +1,404 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpPropertyIndex.h"
+#include "OpHash.h"
+
+namespace Op
+{
+    using namespace property_index;
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    PropertyIndexBuilder::~PropertyIndexBuilder()
+    {
+        if ( m_file != nullptr )
+            fclose( m_file );
+    }
+
+    bool PropertyIndexBuilder::open( const std::string& filename )
+    {
+        m_file = fopen( filename.c_str(), "wb" );
+        if ( m_file == nullptr )
+        {
+            spdlog::error( "unable to write property index [{}]", filename );
+            return false;
+        }
+
+        // the table offset is filled in by finish()
+        const FileHeader header{ cMagic, cVersion, 0 };
+        return fwrite( &header, sizeof( header ), 1, m_file ) == 1;
+    }
+
+    bool PropertyIndexBuilder::finish()
+    {
+        if ( m_file == nullptr )
+            return false;
+
+        bool bWritten = !m_bWriteFailed;
+        const auto write = [&]( const void* data, const std::size_t size )
+        {
+            if ( size > 0 && fwrite( data, size, 1, m_file ) != 1 )
+                bWritten = false;
+        };
+
+        const uint32_t propertyCount = static_cast<uint32_t>( m_propertyNames.size() );
+        write( &propertyCount, sizeof( propertyCount ) );
+        for ( const auto& name : m_propertyNames )
+        {
+            const uint32_t length = static_cast<uint32_t>( name.size() );
+            write( &length, sizeof( length ) );
+            write( name.data(), length );
+        }
+
+        const uint64_t instanceCount = m_lifetimes.size();
+        write( &instanceCount, sizeof( instanceCount ) );
+        for ( const auto& instance : m_lifetimes )
+        {
+            const uint32_t lifetimeCount = static_cast<uint32_t>( instance.second.size() );
+            write( &instance.first, sizeof( uint64_t ) );
+            write( &lifetimeCount, sizeof( lifetimeCount ) );
+            write( instance.second.data(), lifetimeCount * sizeof( Lifetime ) );
+        }
+
+        const uint64_t logCount = m_logs.size();
+        write( &logCount, sizeof( logCount ) );
+        for ( const auto& log : m_logs )
+        {
+            const uint32_t changeCount = static_cast<uint32_t>( log.second.m_changes.size() );
+            write( &log.first.m_instance, sizeof( uint64_t ) );
+            write( &log.first.m_property, sizeof( uint32_t ) );
+            write( &changeCount, sizeof( changeCount ) );
+            write( log.second.m_changes.data(), changeCount * sizeof( Change ) );
+        }
+
+        const FileHeader header{ cMagic, cVersion, sizeof( FileHeader ) + m_heapBytes };
+        if ( _fseeki64( m_file, 0, SEEK_SET ) != 0 )
+            bWritten = false;
+        write( &header, sizeof( header ) );
+
+        bWritten &= ( fclose( m_file ) == 0 );
+        m_file = nullptr;
+        return bWritten;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PropertyIndexBuilder::observe( const MasterStringTable& _strings, const pvd::CreatePropertyMessage& _event )
+    {
+        std::vector< MessageField > fields;
+
+        const auto entryCount = _event.mMessageEntries.size();
+        fields.reserve( entryCount );
+        for ( uint32_t idx = 0; idx < entryCount; ++idx )
+        {
+            const auto& entry( const_cast<const physx::pvdsdk::StreamPropMessageArg&>( _event.mMessageEntries[idx] ) );
+            fields.push_back( { propertyFor( _strings, entry.mPropertyName ), entry.mMessageOffset, entry.mByteSize } );
+        }
+
+        m_messages.insert_or_assign( nameKey( _event.mMessageName ), std::move( fields ) );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PropertyIndexBuilder::observe( const MasterStringTable&, const pvd::CreateInstance& _event )
+    {
+        auto& lifetimes = m_lifetimes[_event.mInstanceId];
+
+        // a create on an ID that is still live implicitly ends the previous instance
+        if ( !lifetimes.empty() && lifetimes.back().m_destroyed == cStillLive )
+            lifetimes.back().m_destroyed = m_currentFrame;
+
+        lifetimes.push_back( { m_currentFrame, cStillLive } );
+    }
+
+    void PropertyIndexBuilder::observe( const MasterStringTable&, const pvd::DestroyInstance& _event )
+    {
+        const auto it = m_lifetimes.find( _event.mInstanceId );
+        if ( it != m_lifetimes.end() && it->second.back().m_destroyed == cStillLive )
+            it->second.back().m_destroyed = m_currentFrame;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PropertyIndexBuilder::observe( const MasterStringTable& _strings, const pvd::SetPropertyValue& _event )
+    {
+        recordValue( _event.mInstanceId, propertyFor( _strings, _event.mPropertyName ), _event.mData.begin(), _event.mData.size() );
+    }
+
+    void PropertyIndexBuilder::observe( const MasterStringTable& _strings, const pvd::BeginSetPropertyValue& _event )
+    {
+        m_sequenceInstance = _event.mInstanceId;
+        m_sequenceProperty = propertyFor( _strings, _event.mPropertyName );
+        m_sequenceData.clear();
+    }
+
+    void PropertyIndexBuilder::observe( const MasterStringTable&, const pvd::AppendPropertyValueData& _event )
+    {
+        m_sequenceData.insert( m_sequenceData.end(), _event.mData.begin(), _event.mData.end() );
+    }
+
+    void PropertyIndexBuilder::observe( const MasterStringTable&, const pvd::EndSetPropertyValue& )
+    {
+        recordValue( m_sequenceInstance, m_sequenceProperty, m_sequenceData.data(), static_cast<uint32_t>( m_sequenceData.size() ) );
+        m_sequenceData.clear();
+    }
+
+    void PropertyIndexBuilder::observe( const MasterStringTable&, const pvd::SetPropertyMessage& _event )
+    {
+        recordMessage( _event.mInstanceId, nameKey( _event.mMessageName ), _event.mData );
+    }
+
+    void PropertyIndexBuilder::observe( const MasterStringTable&, const pvd::BeginPropertyMessageGroup& _event )
+    {
+        m_groupMessage = nameKey( _event.mMsgName );
+    }
+
+    void PropertyIndexBuilder::observe( const MasterStringTable&, const pvd::SendPropertyMessageFromGroup& _event )
+    {
+        recordMessage( _event.mInstance, m_groupMessage, _event.mData );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    uint32_t PropertyIndexBuilder::propertyFor( const MasterStringTable& _strings, const uint32_t nameHandle )
+    {
+        if ( const auto it = m_handleProperties.find( nameHandle ); it != m_handleProperties.end() )
+            return it->second;
+
+        const std::string& name = _strings.lookupStringByHandle( nameHandle );
+
+        // properties are indexed by name rather than handle, so queries don't need the capture's string table
+        auto [propertyIt, bInserted] = m_propertyIndices.try_emplace( name, static_cast<uint32_t>( m_propertyNames.size() ) );
+        if ( bInserted )
+            m_propertyNames.push_back( name );
+
+        m_handleProperties.emplace( nameHandle, propertyIt->second );
+        return propertyIt->second;
+    }
+
+    void PropertyIndexBuilder::recordMessage( const uint64_t instanceID, const uint64_t messageKey, const pvd::DataRef<const uint8_t>& data )
+    {
+        const auto it = m_messages.find( messageKey );
+        if ( it == m_messages.end() )
+            return;
+
+        for ( const MessageField& field : it->second )
+        {
+            if ( static_cast<std::size_t>( field.m_offset ) + field.m_size <= data.size() )
+                recordValue( instanceID, field.m_property, data.begin() + field.m_offset, field.m_size );
+        }
+    }
+
+    void PropertyIndexBuilder::recordValue( const uint64_t instanceID, const uint32_t property, const uint8_t* data, const uint32_t size )
+    {
+        // updates to instances that were never created can't be placed in a lifetime
+        const auto lifetimeIt = m_lifetimes.find( instanceID );
+        if ( lifetimeIt == m_lifetimes.end() || lifetimeIt->second.back().m_destroyed != cStillLive )
+            return;
+
+        const uint32_t liveSince = lifetimeIt->second.back().m_created;
+
+        ChangeLog& log = m_logs[LogKey{ instanceID, property }];
+
+        Change change{ m_currentFrame, size, 0 };
+        uint64_t valueHash = 0;
+        if ( size <= cInlineBytes )
+            std::memcpy( &change.m_value, data, size );
+        else
+            valueHash = hashPayload( data, size );
+
+        // only log actual changes; a previous lifetime's last value doesn't count, the instance starts out empty
+        Change* last = log.m_changes.empty() ? nullptr : &log.m_changes.back();
+        if ( last != nullptr && last->m_frame >= liveSince && last->m_size == size )
+        {
+            const bool bSame = ( size <= cInlineBytes ) ? ( last->m_value == change.m_value ) : ( log.m_lastHash == valueHash );
+            if ( bSame )
+                return;
+        }
+
+        if ( size > cInlineBytes )
+        {
+            change.m_value = sizeof( FileHeader ) + m_heapBytes;
+            // a failed write leaves the heap short and every later offset wrong; note it, and let finish() fail
+            if ( m_file != nullptr && !m_bWriteFailed && fwrite( data, size, 1, m_file ) != 1 )
+            {
+                spdlog::error( "unable to write property value to the index; it will be incomplete" );
+                m_bWriteFailed = true;
+            }
+            m_heapBytes += size;
+            log.m_lastHash = valueHash;
+        }
+
+        // within a frame only the final value is visible
+        if ( last != nullptr && last->m_frame == m_currentFrame && last->m_frame >= liveSince )
+        {
+            *last = change;
+        }
+        else
+        {
+            log.m_changes.push_back( change );
+            m_changeCount++;
+        }
+    }
+
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    PropertyIndex::~PropertyIndex()
+    {
+        if ( m_file != nullptr )
+            fclose( m_file );
+    }
+
+    bool PropertyIndex::load( const std::string& filename )
+    {
+        m_file = fopen( filename.c_str(), "rb" );
+        if ( m_file == nullptr )
+            return false;
+
+        bool bRead = true;
+        const auto read = [&]( void* data, const std::size_t size )
+        {
+            if ( size > 0 && fread( data, size, 1, m_file ) != 1 )
+                bRead = false;
+            return bRead;
+        };
+
+        FileHeader header;
+        if ( !read( &header, sizeof( header ) ) || header.m_magic != cMagic || header.m_version != cVersion )
+        {
+            spdlog::error( "[{}] is not a property index, or was written by a different version", filename );
+            return false;
+        }
+        if ( _fseeki64( m_file, static_cast<int64_t>( header.m_tableOffset ), SEEK_SET ) != 0 )
+            return false;
+
+        uint32_t propertyCount = 0;
+        read( &propertyCount, sizeof( propertyCount ) );
+        for ( uint32_t property = 0; property < propertyCount && bRead; property++ )
+        {
+            uint32_t length = 0;
+            read( &length, sizeof( length ) );
+
+            std::string name( length, '\0' );
+            read( name.data(), length );
+            m_propertyIndices.insert_or_assign( std::move( name ), property );
+        }
+
+        uint64_t instanceCount = 0;
+        read( &instanceCount, sizeof( instanceCount ) );
+        m_lifetimes.reserve( instanceCount );
+        for ( uint64_t instance = 0; instance < instanceCount && bRead; instance++ )
+        {
+            uint64_t instanceID = 0;
+            uint32_t lifetimeCount = 0;
+            read( &instanceID, sizeof( instanceID ) );
+            read( &lifetimeCount, sizeof( lifetimeCount ) );
+
+            auto& lifetimes = m_lifetimes[instanceID];
+            lifetimes.resize( lifetimeCount );
+            read( lifetimes.data(), lifetimeCount * sizeof( Lifetime ) );
+        }
+
+        // every log is packed into one array, so a lookup only touches the range it searches
+        uint64_t logCount = 0;
+        read( &logCount, sizeof( logCount ) );
+        m_logs.reserve( logCount );
+        for ( uint64_t log = 0; log < logCount && bRead; log++ )
+        {
+            LogKey key;
+            uint32_t changeCount = 0;
+            read( &key.m_instance, sizeof( key.m_instance ) );
+            read( &key.m_property, sizeof( key.m_property ) );
+            read( &changeCount, sizeof( changeCount ) );
+
+            const uint64_t first = m_changes.size();
+            m_changes.resize( first + changeCount );
+            read( m_changes.data() + first, changeCount * sizeof( Change ) );
+
+            m_logs.insert_or_assign( key, LogRange{ first, changeCount } );
+        }
+
+        if ( !bRead )
+            spdlog::error( "property index [{}] is truncated", filename );
+        return bRead;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool PropertyIndex::findLog( const uint64_t instanceID, const std::string& propertyName, LogRange& range ) const
+    {
+        const auto propertyIt = m_propertyIndices.find( propertyName );
+        if ( propertyIt == m_propertyIndices.end() )
+            return false;
+
+        const auto logIt = m_logs.find( LogKey{ instanceID, propertyIt->second } );
+        if ( logIt == m_logs.end() )
+            return false;
+
+        range = logIt->second;
+        return true;
+    }
+
+    uint32_t PropertyIndex::changeCount( const uint64_t instanceID, const std::string& propertyName ) const
+    {
+        LogRange range;
+        return findLog( instanceID, propertyName, range ) ? range.m_count : 0;
+    }
+
+    bool PropertyIndex::valueAt( const uint64_t instanceID, const std::string& propertyName, const uint64_t frame, std::vector< uint8_t >& value, uint64_t* changedFrame )
+    {
+        const auto lifetimeIt = m_lifetimes.find( instanceID );
+        if ( lifetimeIt == m_lifetimes.end() )
+            return false;
+
+        // the lifetime of this instance ID that covers the frame, if any
+        const auto& lifetimes = lifetimeIt->second;
+        const auto lifetime = std::upper_bound( lifetimes.begin(), lifetimes.end(), frame, []( const uint64_t f, const Lifetime& l )
+        {
+            return f < l.m_created;
+        } );
+        if ( lifetime == lifetimes.begin() )
+            return false;
+
+        const Lifetime& live = *std::prev( lifetime );
+        if ( live.m_destroyed != cStillLive && frame >= live.m_destroyed )
+            return false;
+
+        LogRange range;
+        if ( !findLog( instanceID, propertyName, range ) )
+            return false;
+
+        const Change* first = m_changes.data() + range.m_first;
+        const Change* last  = first + range.m_count;
+        const Change* change = std::upper_bound( first, last, frame, []( const uint64_t f, const Change& c )
+        {
+            return f < c.m_frame;
+        } );
+        if ( change == first )
+            return false;
+        --change;
+
+        // set during an earlier lifetime of the same ID
+        if ( change->m_frame < live.m_created )
+            return false;
+
+        value.resize( change->m_size );
+        if ( change->m_size <= cInlineBytes )
+        {
+            std::memcpy( value.data(), &change->m_value, change->m_size );
+        }
+        else
+        {
+            if ( _fseeki64( m_file, static_cast<int64_t>( change->m_value ), SEEK_SET ) != 0 ||
+                 fread( value.data(), change->m_size, 1, m_file ) != 1 )
+                return false;
+        }
+
+        if ( changedFrame != nullptr )
+            *changedFrame = change->m_frame;
+        return true;
+    }
+
+} // namespace Op
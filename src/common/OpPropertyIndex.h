@@ -0,0 +1,206 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// a persistent index answering "what was the value of this property on that instance at frame N" without replaying
+// the capture. PropertyIndexBuilder is fed the decoded stream once, front to back, and keeps an append-only change log
+// per ( instance, property ); each entry is the frame the value changed on plus the value itself when it fits in
+// 8 bytes, or the file offset of a copy of it otherwise. Updates that don't change the value are not logged, and
+// several updates within one frame collapse into the last of them.
+//
+// The index file sits next to the capture (capture.pxd2.opvdx) and is laid out as
+//
+//  header | value heap, written as the stream is read | property names, lifetimes, change logs
+//
+// PropertyIndex loads the tables into memory and leaves the heap on disk; a point query is a hash lookup and a
+// binary search, plus one read for values that didn't fit inline
+//
+
+#pragma once
+
+#include "common/OpEventUnpacker.h"
+#include "common/OpMasterStringTable.h"
+
+namespace Op
+{
+    namespace property_index
+    {
+        static constexpr uint32_t cMagic        = 'XDVO';
+        static constexpr uint32_t cVersion      = 1;
+        static constexpr uint32_t cStillLive    = std::numeric_limits< uint32_t >::max();
+        static constexpr uint32_t cInlineBytes  = sizeof( uint64_t );
+
+        struct FileHeader
+        {
+            uint32_t    m_magic;
+            uint32_t    m_version;
+            uint64_t    m_tableOffset;      // patched once the heap is complete
+        };
+
+        struct Change
+        {
+            uint32_t    m_frame;
+            uint32_t    m_size;
+            uint64_t    m_value;            // the value when m_size <= cInlineBytes, else its offset in the index file
+        };
+        static_assert( sizeof( Change ) == 16, "changes are written out as-is" );
+
+        struct Lifetime
+        {
+            uint32_t    m_created;
+            uint32_t    m_destroyed;        // cStillLive if never destroyed
+        };
+
+        struct LogKey
+        {
+            uint64_t    m_instance;
+            uint32_t    m_property;         // index into the property name table
+
+            bool operator==( const LogKey& rhs ) const
+            {
+                return m_instance == rhs.m_instance && m_property == rhs.m_property;
+            }
+        };
+
+        struct LogKeyHash
+        {
+            using is_avalanching = void;
+
+            uint64_t operator()( const LogKey& key ) const noexcept
+            {
+                using namespace ankerl::unordered_dense::detail;
+                return wyhash::mix( wyhash::hash( key.m_instance ), key.m_property );
+            }
+        };
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    class PropertyIndexBuilder
+    {
+    public:
+
+        ~PropertyIndexBuilder();
+
+        [[nodiscard]] static std::string indexPathFor( const std::string& captureFilename )
+        {
+            return captureFilename + ".opvdx";
+        }
+
+        // starts the index file; the heap is written into it as the stream is recorded
+        bool open( const std::string& filename );
+
+        // writes out the tables and closes the file; fails if anything, including a value written along the way, could
+        // not be written
+        bool finish();
+
+        // every event, once the stream's string table and frame count have been brought up to date with it
+        template< typename TEvent >
+        inline void record( const MasterStringTable& _strings, const uint64_t _frame, const TEvent& _event )
+        {
+            m_currentFrame = static_cast<uint32_t>( _frame );
+            observe( _strings, _event );
+        }
+
+        [[nodiscard]] inline uint64_t changeCount() const   { return m_changeCount; }
+        [[nodiscard]] inline uint64_t heapBytes() const     { return m_heapBytes; }
+
+    private:
+
+        void observe( const MasterStringTable& _strings, const pvd::CreatePropertyMessage& _event );
+        void observe( const MasterStringTable& _strings, const pvd::CreateInstance& _event );
+        void observe( const MasterStringTable& _strings, const pvd::DestroyInstance& _event );
+        void observe( const MasterStringTable& _strings, const pvd::SetPropertyValue& _event );
+        void observe( const MasterStringTable& _strings, const pvd::BeginSetPropertyValue& _event );
+        void observe( const MasterStringTable& _strings, const pvd::AppendPropertyValueData& _event );
+        void observe( const MasterStringTable& _strings, const pvd::EndSetPropertyValue& _event );
+        void observe( const MasterStringTable& _strings, const pvd::SetPropertyMessage& _event );
+        void observe( const MasterStringTable& _strings, const pvd::BeginPropertyMessageGroup& _event );
+        void observe( const MasterStringTable& _strings, const pvd::SendPropertyMessageFromGroup& _event );
+
+        template< typename TEvent >
+        inline void observe( const MasterStringTable&, const TEvent& ) {}
+
+        struct ChangeLog
+        {
+            std::vector< property_index::Change >   m_changes;
+            uint64_t                                m_lastHash = 0;     // of the last heap value, to spot repeats
+        };
+
+        struct MessageField
+        {
+            uint32_t    m_property;
+            uint32_t    m_offset;
+            uint32_t    m_size;
+        };
+
+        uint32_t propertyFor( const MasterStringTable& _strings, const uint32_t nameHandle );
+        void recordValue( const uint64_t instanceID, const uint32_t property, const uint8_t* data, const uint32_t size );
+        void recordMessage( const uint64_t instanceID, const uint64_t messageKey, const pvd::DataRef<const uint8_t>& data );
+
+        static inline uint64_t nameKey( const pvd::StreamNamespacedName& name )
+        {
+            return ( static_cast<uint64_t>( name.mNamespace ) << 32 ) | name.mName;
+        }
+
+        FILE*                                                                   m_file = nullptr;
+        uint64_t                                                                m_heapBytes = 0;
+        bool                                                                    m_bWriteFailed = false;     // a value didn't make it into the heap
+        uint64_t                                                                m_changeCount = 0;
+
+        ankerl::unordered_dense::map< uint32_t, uint32_t >                      m_handleProperties; // string handle -> property
+        ankerl::unordered_dense::map< std::string, uint32_t >                   m_propertyIndices;
+        std::vector< std::string >                                              m_propertyNames;
+
+        ankerl::unordered_dense::map< uint64_t, std::vector< MessageField > >   m_messages;
+        ankerl::unordered_dense::map< uint64_t, std::vector< property_index::Lifetime > > m_lifetimes;
+        ankerl::unordered_dense::map< property_index::LogKey, ChangeLog, property_index::LogKeyHash > m_logs;
+
+        uint64_t                    m_sequenceInstance  = 0;
+        uint32_t                    m_sequenceProperty  = 0;
+        std::vector< uint8_t >      m_sequenceData;
+        uint64_t                    m_groupMessage      = 0;
+
+        uint32_t                    m_currentFrame      = 0;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    class PropertyIndex
+    {
+    public:
+
+        ~PropertyIndex();
+
+        bool load( const std::string& filename );
+
+        // the value the property held at the end of the given frame; false if the instance wasn't alive then or the
+        // property had not been set during its lifetime. changedFrame receives the frame the value was last set on
+        bool valueAt( const uint64_t instanceID, const std::string& propertyName, const uint64_t frame, std::vector< uint8_t >& value, uint64_t* changedFrame = nullptr );
+
+        // number of logged changes for an ( instance, property ), across all lifetimes of the instance ID
+        [[nodiscard]] uint32_t changeCount( const uint64_t instanceID, const std::string& propertyName ) const;
+
+        [[nodiscard]] inline std::size_t logCount() const       { return m_logs.size(); }
+        [[nodiscard]] inline std::size_t instanceCount() const  { return m_lifetimes.size(); }
+
+    private:
+
+        struct LogRange
+        {
+            uint64_t    m_first;            // into m_changes
+            uint32_t    m_count;
+        };
+
+        bool findLog( const uint64_t instanceID, const std::string& propertyName, LogRange& range ) const;
+
+        FILE*                                                                   m_file = nullptr;
+
+        ankerl::unordered_dense::map< std::string, uint32_t >                   m_propertyIndices;
+        ankerl::unordered_dense::map< uint64_t, std::vector< property_index::Lifetime > > m_lifetimes;
+        ankerl::unordered_dense::map< property_index::LogKey, LogRange, property_index::LogKeyHash > m_logs;
+        std::vector< property_index::Change >                                   m_changes;
+    };
+
+} // namespace Op
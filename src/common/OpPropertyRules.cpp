@@ -0,0 +1,100 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpPropertyRules.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool PropertyRules::addRule( const std::string& spec, const PropertyAction action )
+    {
+        const auto separator = spec.find( '.' );
+        if ( separator == std::string::npos || separator == 0 || separator + 1 == spec.size() )
+            return false;
+
+        Rule rule;
+        rule.m_className    = spec.substr( 0, separator );
+        rule.m_propertyName = spec.substr( separator + 1 );
+        rule.m_action       = action;
+
+        m_ruleNames.emplace( rule.m_className );
+        m_ruleNames.emplace( rule.m_propertyName );
+        m_rules.emplace_back( std::move( rule ) );
+
+        resolveRules();
+        return true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PropertyRules::onStringHandle( const physx::pvdsdk::StringHandleEvent& _event )
+    {
+        std::string announced( _event.mString );
+        if ( !m_ruleNames.contains( announced ) )
+            return;
+
+        m_nameHandles[announced] = _event.mHandle;
+        resolveRules();
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PropertyRules::onCreateInstance( const physx::pvdsdk::CreateInstance& _event )
+    {
+        if ( m_ruleClassHandles.contains( _event.mClass.mName ) )
+            m_ruleInstances.insert_or_assign( _event.mInstanceId, _event.mClass.mName );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PropertyRules::onCreatePropertyMessage( const physx::pvdsdk::CreatePropertyMessage& _event )
+    {
+        if ( !m_ruleClassHandles.contains( _event.mClass.mName ) )
+            return;
+
+        MessageRanges ranges;
+
+        const auto messageCount = _event.mMessageEntries.size();
+        for ( uint32_t idx = 0; idx < messageCount; ++idx )
+        {
+            const auto& entry( const_cast<const physx::pvdsdk::StreamPropMessageArg&>( _event.mMessageEntries[idx] ) );
+
+            const auto ruleIt = m_resolvedRules.find( resolvedKey( _event.mClass.mName, entry.mPropertyName ) );
+            if ( ruleIt != m_resolvedRules.end() && ruleIt->second != PropertyAction::Keep )
+                ranges.push_back( { entry.mMessageOffset, entry.mByteSize } );
+        }
+
+        if ( !ranges.empty() )
+            m_messageRanges.insert_or_assign( resolvedKey( _event.mMessageName.mNamespace, _event.mMessageName.mName ), std::move( ranges ) );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PropertyRules::onDestroyInstance( const uint64_t instanceID )
+    {
+        m_ruleInstances.erase( instanceID );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void PropertyRules::resolveRules()
+    {
+        m_resolvedRules.clear();
+        m_ruleClassHandles.clear();
+
+        for ( const auto& rule : m_rules )
+        {
+            const auto classIt    = m_nameHandles.find( rule.m_className );
+            const auto propertyIt = m_nameHandles.find( rule.m_propertyName );
+
+            if ( classIt == m_nameHandles.end() || propertyIt == m_nameHandles.end() )
+                continue;
+
+            m_resolvedRules.insert_or_assign( resolvedKey( classIt->second, propertyIt->second ), rule.m_action );
+            m_ruleClassHandles.emplace( classIt->second );
+        }
+    }
+
+} // namespace Op
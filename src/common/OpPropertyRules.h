@@ -0,0 +1,107 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// a table of ( class, property ) rules for stripping heavy property payloads out of a stream while keeping the
+// instances they belong to. Rules are given by name, but names only exist in the stream as StringHandleEvents - so
+// each rule is resolved to its class / property handles the moment those strings are announced, and instances of
+// the named classes are tracked as they are created. Matching a property event is then just a couple of integer
+// hash lookups, no string comparisons
+//
+
+#pragma once
+
+#include "PxPvdCommStreamEvents.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    enum class PropertyAction : uint8_t
+    {
+        Keep,
+        Strip,          // drop the property update entirely
+        Stub,           // keep the update, but replace its payload with an empty one
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    class PropertyRules
+    {
+    public:
+
+        // a byte range of a property message that a rule applies to
+        struct MessageRange
+        {
+            uint32_t    m_offset;
+            uint32_t    m_size;
+        };
+        using MessageRanges = std::vector< MessageRange >;
+
+        // add a rule in the form "Class.Property"; returns false if the spec could not be parsed
+        bool addRule( const std::string& spec, const PropertyAction action );
+
+        [[nodiscard]] inline bool empty() const { return m_rules.empty(); }
+
+        // fed from the event stream to resolve rules and track instances of the classes they name
+        void onStringHandle( const physx::pvdsdk::StringHandleEvent& _event );
+        void onCreateInstance( const physx::pvdsdk::CreateInstance& _event );
+        void onCreatePropertyMessage( const physx::pvdsdk::CreatePropertyMessage& _event );
+        void onDestroyInstance( const uint64_t instanceID );
+
+        [[nodiscard]] inline PropertyAction actionFor( const uint64_t instanceID, const uint32_t propertyHandle ) const
+        {
+            const auto instanceIt = m_ruleInstances.find( instanceID );
+            if ( instanceIt == m_ruleInstances.end() )
+                return PropertyAction::Keep;
+
+            const auto ruleIt = m_resolvedRules.find( resolvedKey( instanceIt->second, propertyHandle ) );
+            if ( ruleIt == m_resolvedRules.end() )
+                return PropertyAction::Keep;
+
+            return ruleIt->second;
+        }
+
+        // byte ranges to blank out of a property message, or nullptr if no rule touches it
+        [[nodiscard]] inline const MessageRanges* messageRangesFor( const physx::pvdsdk::StreamNamespacedName& messageName ) const
+        {
+            const auto it = m_messageRanges.find( resolvedKey( messageName.mNamespace, messageName.mName ) );
+            return ( it != m_messageRanges.end() ) ? &it->second : nullptr;
+        }
+
+    private:
+
+        struct Rule
+        {
+            std::string     m_className;
+            std::string     m_propertyName;
+            PropertyAction  m_action;
+        };
+
+        static inline uint64_t resolvedKey( const uint32_t high, const uint32_t low )
+        {
+            return ( static_cast<uint64_t>( high ) << 32 ) | low;
+        }
+
+        // rebuild the handle-keyed rule table, called whenever a name used by a rule gets its handle
+        void resolveRules();
+
+        using NameSet           = ankerl::unordered_dense::set< std::string >;
+        using HandleMap         = ankerl::unordered_dense::map< std::string, uint32_t >;
+        using HandleSet         = ankerl::unordered_dense::set< uint32_t >;
+        using ResolvedRuleMap   = ankerl::unordered_dense::map< uint64_t, PropertyAction >;
+        using InstanceClassMap  = ankerl::unordered_dense::map< uint64_t, uint32_t >;
+        using MessageRangeMap   = ankerl::unordered_dense::map< uint64_t, MessageRanges >;
+
+        std::vector< Rule > m_rules;
+        NameSet             m_ruleNames;            // every class / property name mentioned by a rule
+        HandleMap           m_nameHandles;          // ... and the handles they have been announced with so far
+
+        HandleSet           m_ruleClassHandles;     // class name handles that have at least one resolved rule
+        ResolvedRuleMap     m_resolvedRules;        // ( class handle, property handle ) -> action
+        InstanceClassMap    m_ruleInstances;        // live instances of rule classes -> class name handle
+        MessageRangeMap     m_messageRanges;        // ( message namespace, message name ) -> ranges to blank
+    };
+
+} // namespace Op
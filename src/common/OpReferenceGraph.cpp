@@ -0,0 +1,273 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpReferenceGraph.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ReferenceGraph::addInstance( const uint64_t instanceID, const bool cascadable )
+    {
+        // anything still attached to the ID belongs to whatever previously had it
+        removeInstance( instanceID );
+
+        Node& node = m_nodes[instanceID];
+        node.m_cascadable = cascadable;
+        node.m_filtered   = false;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ReferenceGraph::removeInstance( const uint64_t instanceID )
+    {
+        const auto nodeIt = m_nodes.find( instanceID );
+        if ( nodeIt == m_nodes.end() )
+            return;
+
+        Node& node = nodeIt->second;
+
+        // detach from everything we reference ...
+        while ( !node.m_references.empty() )
+        {
+            const Link link = node.m_references.back();
+            const auto edgeIt = m_edges.find( EdgeKey{ instanceID, link.m_instance, link.m_property } );
+            const EdgeSlots slots = edgeIt->second;
+            m_edges.erase( edgeIt );
+
+            Node& referenceNode = m_nodes.find( link.m_instance )->second;
+            if ( !node.m_filtered )
+                referenceNode.m_liveOwners -= slots.m_count;
+
+            unlinkFromReference( referenceNode, link.m_instance, slots.m_inReference );
+            node.m_references.pop_back();
+        }
+
+        // ... and from everything referencing us
+        while ( !node.m_owners.empty() )
+        {
+            const Link link = node.m_owners.back();
+            const auto edgeIt = m_edges.find( EdgeKey{ link.m_instance, instanceID, link.m_property } );
+            const EdgeSlots slots = edgeIt->second;
+            m_edges.erase( edgeIt );
+
+            Node& ownerNode = m_nodes.find( link.m_instance )->second;
+            if ( !node.m_filtered )
+                ownerNode.m_liveReferences -= slots.m_count;
+
+            unlinkFromOwner( ownerNode, link.m_instance, slots.m_inOwner );
+            node.m_owners.pop_back();
+        }
+
+        m_nodes.erase( nodeIt );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool ReferenceGraph::addReference( const uint64_t ownerID, const uint32_t property, const uint64_t referenceID )
+    {
+        linkEdge( ownerID, property, referenceID, false );
+
+        const Node& ownerNode     = m_nodes.find( ownerID )->second;
+        const Node& referenceNode = m_nodes.find( referenceID )->second;
+
+        return ( ownerNode.m_cascadable &&
+                !ownerNode.m_filtered &&
+                 referenceNode.m_filtered &&
+                 ownerNode.m_liveReferences == 0 );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ReferenceGraph::removeReference( const uint64_t ownerID, const uint32_t property, const uint64_t referenceID )
+    {
+        unlinkEdge( ownerID, property, referenceID, false );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool ReferenceGraph::setValueReferences( const uint64_t ownerID, const uint32_t property, const pvd::DataRef< const uint8_t >& refs )
+    {
+        // let go of what the previous value referenced
+        if ( const auto ownerIt = m_nodes.find( ownerID ); ownerIt != m_nodes.end() )
+        {
+            const std::vector< Link > previous = ownerIt->second.m_references;
+            for ( const Link& link : previous )
+            {
+                if ( link.m_property != property )
+                    continue;
+
+                const auto edgeIt = m_edges.find( EdgeKey{ ownerID, link.m_instance, property } );
+                for ( uint32_t valueCount = edgeIt->second.m_valueCount; valueCount > 0; valueCount-- )
+                    unlinkEdge( ownerID, property, link.m_instance, true );
+            }
+        }
+
+        bool bRequiredFiltered = false;
+
+        const std::size_t numRefs = refs.size() / sizeof( uint64_t );
+        for ( std::size_t index = 0; index < numRefs; index++ )
+        {
+            uint64_t referenceID;
+            std::memcpy( &referenceID, refs.begin() + index * sizeof( uint64_t ), sizeof( uint64_t ) );
+
+            if ( referenceID != 0 )
+            {
+                linkEdge( ownerID, property, referenceID, true );
+                bRequiredFiltered |= m_nodes.find( referenceID )->second.m_filtered;
+            }
+        }
+
+        const auto ownerIt = m_nodes.find( ownerID );
+        if ( ownerIt == m_nodes.end() )
+            return false;
+
+        const Node& ownerNode = ownerIt->second;
+        return ( ownerNode.m_cascadable &&
+                !ownerNode.m_filtered &&
+                 ( bRequiredFiltered || ( !ownerNode.m_references.empty() && ownerNode.m_liveReferences == 0 ) ) );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ReferenceGraph::linkEdge( const uint64_t ownerID, const uint32_t property, const uint64_t referenceID, const bool fromValue )
+    {
+        // make sure both ends exist before taking references, as inserting can move nodes around
+        m_nodes.try_emplace( ownerID );
+        m_nodes.try_emplace( referenceID );
+
+        Node& ownerNode     = m_nodes.find( ownerID )->second;
+        Node& referenceNode = m_nodes.find( referenceID )->second;
+
+        auto [edgeIt, newEdge] = m_edges.try_emplace( EdgeKey{ ownerID, referenceID, property } );
+        EdgeSlots& slots = edgeIt->second;
+        if ( newEdge )
+        {
+            slots.m_inOwner     = static_cast<uint32_t>( ownerNode.m_references.size() );
+            slots.m_inReference = static_cast<uint32_t>( referenceNode.m_owners.size() );
+
+            ownerNode.m_references.push_back( { referenceID, property } );
+            referenceNode.m_owners.push_back( { ownerID, property } );
+        }
+        slots.m_count++;
+        if ( fromValue )
+            slots.m_valueCount++;
+
+        if ( !referenceNode.m_filtered )
+            ownerNode.m_liveReferences++;
+        if ( !ownerNode.m_filtered )
+            referenceNode.m_liveOwners++;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ReferenceGraph::unlinkEdge( const uint64_t ownerID, const uint32_t property, const uint64_t referenceID, const bool fromValue )
+    {
+        const auto edgeIt = m_edges.find( EdgeKey{ ownerID, referenceID, property } );
+        if ( edgeIt == m_edges.end() )
+            return;
+
+        // a RemoveObjectRef can only take back a pushed reference, not one held in a property value
+        const uint32_t held = fromValue ? edgeIt->second.m_valueCount : ( edgeIt->second.m_count - edgeIt->second.m_valueCount );
+        if ( held == 0 )
+            return;
+        if ( fromValue )
+            edgeIt->second.m_valueCount--;
+
+        Node& ownerNode     = m_nodes.find( ownerID )->second;
+        Node& referenceNode = m_nodes.find( referenceID )->second;
+
+        if ( !referenceNode.m_filtered )
+            ownerNode.m_liveReferences--;
+        if ( !ownerNode.m_filtered )
+            referenceNode.m_liveOwners--;
+
+        if ( --edgeIt->second.m_count == 0 )
+        {
+            const EdgeSlots slots = edgeIt->second;
+            m_edges.erase( edgeIt );
+
+            unlinkFromOwner( ownerNode, ownerID, slots.m_inOwner );
+            unlinkFromReference( referenceNode, referenceID, slots.m_inReference );
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ReferenceGraph::filter( const uint64_t instanceID, std::vector< uint64_t >& cascaded )
+    {
+        Node& node = m_nodes[instanceID];
+        if ( node.m_filtered )
+            return;
+
+        node.m_filtered = true;
+
+        // breadth-first through anything that gets dropped as a result, using the output as the work list
+        const std::size_t firstCascaded = cascaded.size();
+        retire( instanceID, cascaded );
+
+        for ( std::size_t index = firstCascaded; index < cascaded.size(); index++ )
+            retire( cascaded[index], cascaded );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ReferenceGraph::retire( const uint64_t instanceID, std::vector< uint64_t >& cascaded )
+    {
+        const Node& node = m_nodes.find( instanceID )->second;
+
+        for ( const Link& link : node.m_references )
+        {
+            Node& referenceNode = m_nodes.find( link.m_instance )->second;
+            referenceNode.m_liveOwners -= edgeCount( instanceID, link.m_property, link.m_instance );
+
+            if ( referenceNode.m_cascadable && !referenceNode.m_filtered && referenceNode.m_liveOwners == 0 )
+            {
+                referenceNode.m_filtered = true;
+                cascaded.push_back( link.m_instance );
+            }
+        }
+
+        for ( const Link& link : node.m_owners )
+        {
+            const EdgeSlots& slots = m_edges.find( EdgeKey{ link.m_instance, instanceID, link.m_property } )->second;
+
+            Node& ownerNode = m_nodes.find( link.m_instance )->second;
+            ownerNode.m_liveReferences -= slots.m_count;
+
+            // losing something held as a property value (a shape's geometry, a geometry's mesh) is enough on its own
+            const bool bLostRequired = ( slots.m_valueCount > 0 );
+
+            if ( ownerNode.m_cascadable && !ownerNode.m_filtered && ( bLostRequired || ownerNode.m_liveReferences == 0 ) )
+            {
+                ownerNode.m_filtered = true;
+                cascaded.push_back( link.m_instance );
+            }
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ReferenceGraph::unlinkFromOwner( Node& ownerNode, const uint64_t ownerID, const uint32_t slot )
+    {
+        const uint32_t lastSlot = static_cast<uint32_t>( ownerNode.m_references.size() - 1 );
+        if ( slot != lastSlot )
+        {
+            const Link moved = ownerNode.m_references[lastSlot];
+            ownerNode.m_references[slot] = moved;
+            m_edges.find( EdgeKey{ ownerID, moved.m_instance, moved.m_property } )->second.m_inOwner = slot;
+        }
+        ownerNode.m_references.pop_back();
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void ReferenceGraph::unlinkFromReference( Node& referenceNode, const uint64_t referenceID, const uint32_t slot )
+    {
+        const uint32_t lastSlot = static_cast<uint32_t>( referenceNode.m_owners.size() - 1 );
+        if ( slot != lastSlot )
+        {
+            const Link moved = referenceNode.m_owners[lastSlot];
+            referenceNode.m_owners[slot] = moved;
+            m_edges.find( EdgeKey{ moved.m_instance, referenceID, moved.m_property } )->second.m_inReference = slot;
+        }
+        referenceNode.m_owners.pop_back();
+    }
+
+} // namespace Op
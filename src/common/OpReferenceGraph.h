@@ -0,0 +1,161 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// incremental object reference graph built from PushBackObjectRef / RemoveObjectRef and ObjectRef-typed property
+// values (an actor's shapes, a shape's geometry), used to work out what else becomes pointless when an instance is
+// filtered out. Edges are counted per (owner, property, reference) in a hash
+// map that also remembers where the edge sits in both endpoints' adjacency lists, so adding or removing a reference
+// is constant time and removal is a swap-and-pop rather than a search.
+//
+// Each node tracks how many of its outgoing references and incoming owners are still live (ie. not filtered); a
+// node that has been marked as cascadable is dropped automatically once either count falls to zero because of
+// filtering - an owner that no longer references anything that survived, or an object no surviving owner uses.
+// References held as ObjectRef property values are required rather than counted: a cascadable owner is dropped as
+// soon as any one of them is filtered, as a shape without its geometry is no more use than one with nothing left
+//
+
+#pragma once
+
+#include "common/OpEventUnpacker.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class ReferenceGraph
+    {
+    public:
+
+        struct Link
+        {
+            uint64_t    m_instance;         // the node on the far end of the edge
+            uint32_t    m_property;         // property string handle the reference lives in, on the owner
+        };
+
+        ReferenceGraph()
+        {
+            m_nodes.reserve( 4096 );
+            m_edges.reserve( 4096 );
+        }
+
+        // register a freshly created instance; instances filtered at creation should be registered and then passed to
+        // filter() straight away, so that references to them are known to be dead from the outset. A reused ID starts
+        // over with no edges
+        void addInstance( const uint64_t instanceID, const bool cascadable );
+
+        // the instance was destroyed; forget it and every edge touching it, without triggering any cascades
+        void removeInstance( const uint64_t instanceID );
+
+        // returns true if the owner should now be dropped as a consequence - ie. it is cascadable and the only thing
+        // it references is something already filtered
+        bool addReference( const uint64_t ownerID, const uint32_t property, const uint64_t referenceID );
+        void removeReference( const uint64_t ownerID, const uint32_t property, const uint64_t referenceID );
+
+        // an ObjectRef property value replaces whatever the owner's property referenced before; refs is the raw payload,
+        // an array of 64-bit instance IDs (0 being null). Returns true if the owner should now be dropped - it is
+        // cascadable and either references something already filtered in this value, or nothing live at all
+        bool setValueReferences( const uint64_t ownerID, const uint32_t property, const pvd::DataRef< const uint8_t >& refs );
+
+        // mark an instance as filtered and propagate; every other instance dropped as a result is appended to
+        // cascaded (not including instanceID itself)
+        void filter( const uint64_t instanceID, std::vector< uint64_t >& cascaded );
+
+        [[nodiscard]] bool isFiltered( const uint64_t instanceID ) const
+        {
+            const auto it = m_nodes.find( instanceID );
+            return ( it != m_nodes.end() && it->second.m_filtered );
+        }
+
+        // visit every ( owner, property, count ) holding instanceID in a reference collection, ie. that would need
+        // count RemoveObjectRefs to let go of it; references held as property values aren't visited
+        template< typename TFunction >
+        void forEachOwner( const uint64_t instanceID, TFunction&& function ) const
+        {
+            if ( const auto it = m_nodes.find( instanceID ); it != m_nodes.end() )
+            {
+                for ( const Link& owner : it->second.m_owners )
+                {
+                    const auto edgeIt = m_edges.find( EdgeKey{ owner.m_instance, instanceID, owner.m_property } );
+                    const uint32_t pushedCount = edgeIt->second.m_count - edgeIt->second.m_valueCount;
+                    if ( pushedCount > 0 )
+                        function( owner.m_instance, owner.m_property, pushedCount );
+                }
+            }
+        }
+
+        [[nodiscard]] std::size_t numNodes() const { return m_nodes.size(); }
+        [[nodiscard]] std::size_t numEdges() const { return m_edges.size(); }
+
+    private:
+
+        struct Node
+        {
+            std::vector< Link >     m_references;       // edges where this node is the owner
+            std::vector< Link >     m_owners;           // edges where this node is the one being referenced
+            uint32_t                m_liveReferences    = 0;
+            uint32_t                m_liveOwners        = 0;
+            bool                    m_cascadable        = false;
+            bool                    m_filtered          = false;
+        };
+
+        struct EdgeKey
+        {
+            uint64_t    m_owner;
+            uint64_t    m_reference;
+            uint32_t    m_property;
+
+            bool operator==( const EdgeKey& rhs ) const
+            {
+                return m_owner == rhs.m_owner && m_reference == rhs.m_reference && m_property == rhs.m_property;
+            }
+        };
+
+        struct EdgeKeyHash
+        {
+            using is_avalanching = void;
+
+            uint64_t operator()( const EdgeKey& key ) const noexcept
+            {
+                using namespace ankerl::unordered_dense::detail;
+                return wyhash::mix( wyhash::hash( key.m_owner ) ^ key.m_property, wyhash::hash( key.m_reference ) );
+            }
+        };
+
+        // where the edge's Link lives within the owner's m_references and the reference's m_owners, plus how many
+        // times this exact reference is held - pushed, or as an element of a property value
+        struct EdgeSlots
+        {
+            uint32_t    m_inOwner       = 0;
+            uint32_t    m_inReference   = 0;
+            uint32_t    m_count         = 0;
+            uint32_t    m_valueCount    = 0;    // of m_count, those from property values
+        };
+
+        using NodeMap = ankerl::unordered_dense::map< uint64_t, Node >;
+        using EdgeMap = ankerl::unordered_dense::map< EdgeKey, EdgeSlots, EdgeKeyHash >;
+
+        [[nodiscard]] uint32_t edgeCount( const uint64_t ownerID, const uint32_t property, const uint64_t referenceID ) const
+        {
+            const auto it = m_edges.find( EdgeKey{ ownerID, referenceID, property } );
+            return ( it != m_edges.end() ) ? it->second.m_count : 0;
+        }
+
+        void linkEdge( const uint64_t ownerID, const uint32_t property, const uint64_t referenceID, const bool fromValue );
+        void unlinkEdge( const uint64_t ownerID, const uint32_t property, const uint64_t referenceID, const bool fromValue );
+
+        // drop the live counts of every neighbour of a newly filtered node, queueing any that should cascade
+        void retire( const uint64_t instanceID, std::vector< uint64_t >& cascaded );
+
+        // swap-and-pop a link out of an owner's m_references / a reference's m_owners, patching up the slot index of
+        // whichever edge got moved into its place
+        void unlinkFromOwner( Node& ownerNode, const uint64_t ownerID, const uint32_t slot );
+        void unlinkFromReference( Node& referenceNode, const uint64_t referenceID, const uint32_t slot );
+
+        NodeMap     m_nodes;
+        EdgeMap     m_edges;
+    };
+
+} // namespace Op
@@ -0,0 +1,372 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpRegionFilter.h"
+
+#if defined( _M_X64 ) || defined( __SSE2__ )
+#define OPVD_REGION_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool RegionBounds::parse( const std::string& text, RegionBounds& result )
+    {
+        float values[6];
+        if ( std::sscanf( text.c_str(), "%f,%f,%f,%f,%f,%f", &values[0], &values[1], &values[2], &values[3], &values[4], &values[5] ) != 6 )
+            return false;
+
+        for ( int axis = 0; axis < 3; axis++ )
+        {
+            result.m_min[axis] = std::min( values[axis], values[axis + 3] );
+            result.m_max[axis] = std::max( values[axis], values[axis + 3] );
+        }
+        return true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    RegionFilter::RegionFilter( const RegionBounds& bounds )
+        : m_bounds( bounds )
+    {
+        m_actorClasses.emplace( "PxActor" );
+
+        m_actors.reserve( 4096 );
+        m_inside.reserve( 4096 );
+        m_batchIndex.reserve( 4096 );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void RegionFilter::onStringHandle( const physx::pvdsdk::StringHandleEvent& _event )
+    {
+        if ( std::strcmp( _event.mString, "GlobalPose" ) == 0 )
+        {
+            m_poseHandle = _event.mHandle;
+            m_poseHandleKnown = true;
+        }
+    }
+
+    void RegionFilter::onDeriveClass( const std::string& parentClass, const std::string& childClass )
+    {
+        // classes are always defined before anything derives from them, so one pass down the hierarchy is enough
+        if ( m_actorClasses.contains( parentClass ) )
+            m_actorClasses.emplace( childClass );
+    }
+
+    void RegionFilter::onCreatePropertyMessage( const physx::pvdsdk::CreatePropertyMessage& _event )
+    {
+        if ( !m_poseHandleKnown )
+            return;
+
+        const auto messageCount = _event.mMessageEntries.size();
+        for ( uint32_t idx = 0; idx < messageCount; ++idx )
+        {
+            const auto& entry( const_cast<const physx::pvdsdk::StreamPropMessageArg&>( _event.mMessageEntries[idx] ) );
+            if ( entry.mPropertyName == m_poseHandle && entry.mByteSize >= cTransformSize )
+            {
+                m_messagePoseOffsets.insert_or_assign( messageKey( _event.mMessageName ), entry.mMessageOffset );
+                break;
+            }
+        }
+    }
+
+    void RegionFilter::onCreateInstance( const uint64_t instanceID, const std::string& className )
+    {
+        // a reused ID starts over
+        onDestroyInstance( instanceID );
+        m_discardedDestroys.erase( instanceID );
+
+        if ( !m_actorClasses.contains( className ) )
+            return;
+
+        m_actors.emplace( instanceID );
+        m_held.try_emplace( instanceID );
+    }
+
+    void RegionFilter::onDestroyInstance( const uint64_t instanceID )
+    {
+        m_actors.erase( instanceID );
+        m_inside.erase( instanceID );
+
+        // an actor that never made it out has nothing to destroy; its DestroyInstance is swallowed when it comes past
+        if ( const auto it = m_held.find( instanceID ); it != m_held.end() )
+        {
+            m_held.erase( it );
+            m_discardedDestroys.emplace( instanceID );
+        }
+
+        // leave any batch entry in place but make sure it can't match anything once the id is reused
+        if ( const auto it = m_batchIndex.find( instanceID ); it != m_batchIndex.end() )
+        {
+            m_batchIDs[it->second] = 0;
+            m_batchIndex.erase( it );
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void RegionFilter::onPropertyValue( const uint64_t instanceID, const uint32_t propertyHandle, const physx::pvdsdk::DataRef<const uint8_t>& data )
+    {
+        if ( !m_poseHandleKnown || propertyHandle != m_poseHandle || data.size() < cTransformSize )
+            return;
+
+        gatherPosition( instanceID, data.begin() );
+    }
+
+    void RegionFilter::onPropertyMessage( const uint64_t instanceID, const physx::pvdsdk::StreamNamespacedName& messageName, const physx::pvdsdk::DataRef<const uint8_t>& data )
+    {
+        const auto it = m_messagePoseOffsets.find( messageKey( messageName ) );
+        if ( it == m_messagePoseOffsets.end() || data.size() < it->second + cTransformSize )
+            return;
+
+        gatherPosition( instanceID, data.begin() + it->second );
+    }
+
+    void RegionFilter::gatherPosition( const uint64_t instanceID, const uint8_t* transform )
+    {
+        if ( !m_actors.contains( instanceID ) )
+            return;
+
+        float position[3];
+        std::memcpy( position, transform + cPositionOffset, sizeof( position ) );
+
+        // later updates in the same frame just overwrite the earlier position
+        auto [it, inserted] = m_batchIndex.try_emplace( instanceID, static_cast<uint32_t>( m_batchIDs.size() ) );
+        if ( inserted )
+        {
+            m_batchIDs.push_back( instanceID );
+            m_batchX.push_back( position[0] );
+            m_batchY.push_back( position[1] );
+            m_batchZ.push_back( position[2] );
+        }
+        else
+        {
+            m_batchX[it->second] = position[0];
+            m_batchY[it->second] = position[1];
+            m_batchZ[it->second] = position[2];
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void RegionFilter::evaluateFrame( std::vector< uint64_t >& outsideWritten, std::vector< uint64_t >& outsideWithheld )
+    {
+        const std::size_t batchSize = m_batchIDs.size();
+
+        // keep is true for positions inside the box, and for ones that aren't finite and so can't be judged
+        const auto classify = [&]( const std::size_t index, const bool keep )
+        {
+            const uint64_t instanceID = m_batchIDs[index];
+            if ( instanceID == 0 )
+                return;
+
+            if ( keep )
+            {
+                m_inside.emplace( instanceID );
+                releaseHeld( instanceID );
+            }
+            else
+            {
+                m_inside.erase( instanceID );
+
+                if ( const auto it = m_held.find( instanceID ); it != m_held.end() )
+                {
+                    m_held.erase( it );
+                    outsideWithheld.push_back( instanceID );
+                }
+                else
+                {
+                    outsideWritten.push_back( instanceID );
+                }
+            }
+        };
+
+        std::size_t index = 0;
+
+#if OPVD_REGION_SSE
+        const __m128 minX = _mm_set1_ps( m_bounds.m_min[0] );
+        const __m128 minY = _mm_set1_ps( m_bounds.m_min[1] );
+        const __m128 minZ = _mm_set1_ps( m_bounds.m_min[2] );
+        const __m128 maxX = _mm_set1_ps( m_bounds.m_max[0] );
+        const __m128 maxY = _mm_set1_ps( m_bounds.m_max[1] );
+        const __m128 maxZ = _mm_set1_ps( m_bounds.m_max[2] );
+
+        // |v| < inf is false for infinities and NaNs alike
+        const __m128 signMask = _mm_set1_ps( -0.0f );
+        const __m128 infinity = _mm_set1_ps( std::numeric_limits< float >::infinity() );
+
+        for ( ; index + 4 <= batchSize; index += 4 )
+        {
+            const __m128 x = _mm_loadu_ps( m_batchX.data() + index );
+            const __m128 y = _mm_loadu_ps( m_batchY.data() + index );
+            const __m128 z = _mm_loadu_ps( m_batchZ.data() + index );
+
+            const __m128 inX = _mm_and_ps( _mm_cmpge_ps( x, minX ), _mm_cmple_ps( x, maxX ) );
+            const __m128 inY = _mm_and_ps( _mm_cmpge_ps( y, minY ), _mm_cmple_ps( y, maxY ) );
+            const __m128 inZ = _mm_and_ps( _mm_cmpge_ps( z, minZ ), _mm_cmple_ps( z, maxZ ) );
+
+            const __m128 finite = _mm_and_ps( _mm_cmplt_ps( _mm_andnot_ps( signMask, x ), infinity ),
+                                  _mm_and_ps( _mm_cmplt_ps( _mm_andnot_ps( signMask, y ), infinity ),
+                                              _mm_cmplt_ps( _mm_andnot_ps( signMask, z ), infinity ) ) );
+
+            const int insideMask = _mm_movemask_ps( _mm_and_ps( inX, _mm_and_ps( inY, inZ ) ) );
+            const int finiteMask = _mm_movemask_ps( finite );
+            const int keepMask   = insideMask | ( ~finiteMask & 0xF );
+
+            for ( int lane = 0; lane < 4; lane++ )
+                classify( index + lane, ( keepMask & ( 1 << lane ) ) != 0 );
+        }
+#endif // OPVD_REGION_SSE
+
+        for ( ; index < batchSize; index++ )
+        {
+            const bool isFinite = std::isfinite( m_batchX[index] ) && std::isfinite( m_batchY[index] ) && std::isfinite( m_batchZ[index] );
+            const bool isInside = m_batchX[index] >= m_bounds.m_min[0] && m_batchX[index] <= m_bounds.m_max[0] &&
+                                  m_batchY[index] >= m_bounds.m_min[1] && m_batchY[index] <= m_bounds.m_max[1] &&
+                                  m_batchZ[index] >= m_bounds.m_min[2] && m_batchZ[index] <= m_bounds.m_max[2];
+            classify( index, isInside || !isFinite );
+        }
+
+        m_batchIndex.clear();
+        m_batchIDs.clear();
+        m_batchX.clear();
+        m_batchY.clear();
+        m_batchZ.clear();
+
+        // actors that went a whole frame without a pose can't be placed; let them through rather than hold them forever
+        finish();
+
+        m_discardedDestroys.clear();
+    }
+
+    void RegionFilter::finish()
+    {
+        while ( !m_held.empty() )
+            releaseHeld( m_held.begin()->first );
+    }
+
+    void RegionFilter::releaseHeld( const uint64_t instanceID )
+    {
+        const auto it = m_held.find( instanceID );
+        if ( it == m_held.end() )
+            return;
+
+        for ( auto& held : it->second )
+            m_released.push_back( std::move( held ) );
+
+        m_held.erase( it );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    template< typename TEvent >
+    bool RegionFilter::hold( const uint64_t instanceID, const TEvent& _event, const physx::pvdsdk::DataRef<const uint8_t>* data )
+    {
+        const auto it = m_held.find( instanceID );
+        if ( it == m_held.end() )
+            return false;
+
+        HeldEvent& held = it->second.emplace_back();
+        held.m_event = _event;
+        if ( data != nullptr )
+            held.m_data.assign( data->begin(), data->end() );
+        return true;
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::CreateInstance& _event )
+    {
+        return hold( _event.mInstanceId, _event, nullptr );
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::SetPropertyValue& _event )
+    {
+        return hold( _event.mInstanceId, _event, &_event.mData );
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::BeginSetPropertyValue& _event )
+    {
+        m_holdingSequence  = hold( _event.mInstanceId, _event, nullptr );
+        m_sequenceInstance = _event.mInstanceId;
+        return m_holdingSequence;
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::AppendPropertyValueData& _event )
+    {
+        return m_holdingSequence && hold( m_sequenceInstance, _event, &_event.mData );
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::EndSetPropertyValue& _event )
+    {
+        const bool held = m_holdingSequence && hold( m_sequenceInstance, _event, nullptr );
+        m_holdingSequence = false;
+        return held;
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::SetPropertyMessage& _event )
+    {
+        return hold( _event.mInstanceId, _event, &_event.mData );
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::BeginPropertyMessageGroup& _event )
+    {
+        // the group itself passes through, even if some of its messages end up held
+        m_groupMessageName = _event.mMsgName;
+        return false;
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::SendPropertyMessageFromGroup& _event )
+    {
+        if ( !m_held.contains( _event.mInstance ) )
+            return false;
+
+        // a held grouped message is released as a standalone SetPropertyMessage
+        physx::pvdsdk::SetPropertyMessage message;
+        message.mInstanceId  = _event.mInstance;
+        message.mMessageName = m_groupMessageName;
+        message.mData        = _event.mData;
+
+        return hold( message.mInstanceId, message, &message.mData );
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::PushBackObjectRef& _event )
+    {
+        // a reference to a held actor can't go out before the actor does
+        return hold( _event.mObjectRef, _event, nullptr ) || hold( _event.mInstanceId, _event, nullptr );
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::RemoveObjectRef& _event )
+    {
+        return hold( _event.mObjectRef, _event, nullptr ) || hold( _event.mInstanceId, _event, nullptr );
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::SetPickable& _event )
+    {
+        return hold( _event.mInstanceId, _event, nullptr );
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::SetColor& _event )
+    {
+        return hold( _event.mInstanceId, _event, nullptr );
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::SetIsTopLevel& _event )
+    {
+        return hold( _event.mInstanceId, _event, nullptr );
+    }
+
+    bool RegionFilter::accept( physx::pvdsdk::DestroyInstance& _event )
+    {
+        // a held actor destroyed by the filter itself (eg. through a cascade) never went through onDestroyInstance
+        if ( const auto it = m_held.find( _event.mInstanceId ); it != m_held.end() )
+        {
+            m_held.erase( it );
+            return true;
+        }
+        return m_discardedDestroys.erase( _event.mInstanceId ) > 0;
+    }
+
+} // namespace Op
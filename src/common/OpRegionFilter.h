@@ -0,0 +1,203 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// spatial region-of-interest filtering of actors; they are judged on the position part of their GlobalPose, decoded
+// either from a direct SetPropertyValue or from inside a property message, using the layout announced for it by
+// CreatePropertyMessage. Which classes are actors is worked out from DeriveClass, as everything descended from
+// PxActor. Positions seen during a frame are gathered into a structure-of-arrays batch and tested against the box
+// in one go when the frame ends, four at a time with SSE.
+//
+// Every pose update is tested, not just the first; an actor that is outside at the end of a frame is reported so
+// the filter can drop it (and, through cascading, whatever only existed for it). Poses that aren't finite can't be
+// placed anywhere, so they never count against an actor.
+//
+// A newly created actor hasn't got a position yet, so everything written about it - and any reference taken to it -
+// is held back until the end of the frame it appeared in. Only then is it released to be written, or discarded
+// without ever having reached the output if it started outside the region
+//
+
+#pragma once
+
+#include "PxPvdCommStreamEvents.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    struct RegionBounds
+    {
+        float   m_min[3];
+        float   m_max[3];
+
+        // parse "minx,miny,minz,maxx,maxy,maxz"
+        static bool parse( const std::string& text, RegionBounds& result );
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    class RegionFilter
+    {
+    public:
+
+        explicit RegionFilter( const RegionBounds& bounds );
+
+        void onStringHandle( const physx::pvdsdk::StringHandleEvent& _event );
+        void onDeriveClass( const std::string& parentClass, const std::string& childClass );
+        void onCreatePropertyMessage( const physx::pvdsdk::CreatePropertyMessage& _event );
+        void onCreateInstance( const uint64_t instanceID, const std::string& className );
+        void onDestroyInstance( const uint64_t instanceID );
+
+        // feed in property updates; anything that isn't a GlobalPose of an actor is ignored
+        void onPropertyValue( const uint64_t instanceID, const uint32_t propertyHandle, const physx::pvdsdk::DataRef<const uint8_t>& data );
+        void onPropertyMessage( const uint64_t instanceID, const physx::pvdsdk::StreamNamespacedName& messageName, const physx::pvdsdk::DataRef<const uint8_t>& data );
+
+        // test everything gathered this frame and settle every actor still being held back. Actors found outside the
+        // region are appended to outsideWritten if they had already been written out, or outsideWithheld if they were
+        // still held (their events are discarded); the rest of the held actors become available from release()
+        void evaluateFrame( std::vector< uint64_t >& outsideWritten, std::vector< uint64_t >& outsideWithheld );
+
+        // offer every kept event, in stream order; returns true if it belongs to (or references) an actor that is
+        // being held back, in which case the region filter has taken a copy to write out later, if at all
+        bool accept( physx::pvdsdk::CreateInstance& _event );
+        bool accept( physx::pvdsdk::SetPropertyValue& _event );
+        bool accept( physx::pvdsdk::BeginSetPropertyValue& _event );
+        bool accept( physx::pvdsdk::AppendPropertyValueData& _event );
+        bool accept( physx::pvdsdk::EndSetPropertyValue& _event );
+        bool accept( physx::pvdsdk::SetPropertyMessage& _event );
+        bool accept( physx::pvdsdk::BeginPropertyMessageGroup& _event );
+        bool accept( physx::pvdsdk::SendPropertyMessageFromGroup& _event );
+        bool accept( physx::pvdsdk::PushBackObjectRef& _event );
+        bool accept( physx::pvdsdk::RemoveObjectRef& _event );
+        bool accept( physx::pvdsdk::SetPickable& _event );
+        bool accept( physx::pvdsdk::SetColor& _event );
+        bool accept( physx::pvdsdk::SetIsTopLevel& _event );
+        bool accept( physx::pvdsdk::DestroyInstance& _event );
+
+        template< typename TEvent >
+        inline bool accept( TEvent& )
+        {
+            return false;
+        }
+
+        // end of the stream; anything still held is given the benefit of the doubt and released
+        void finish();
+
+        // hand each released event to fn( auto& event ), in order
+        template< typename TFunc >
+        void release( TFunc&& fn );
+
+        [[nodiscard]] inline bool        hasReleased() const    { return !m_released.empty(); }
+        [[nodiscard]] inline std::size_t insideCount() const    { return m_inside.size(); }
+
+    private:
+
+        // PxTransform is a quaternion followed by the position
+        static constexpr uint32_t cTransformSize        = 28;
+        static constexpr uint32_t cPositionOffset       = 16;
+
+        using HeldVariant = std::variant<
+            physx::pvdsdk::CreateInstance,
+            physx::pvdsdk::SetPropertyValue,
+            physx::pvdsdk::BeginSetPropertyValue,
+            physx::pvdsdk::AppendPropertyValueData,
+            physx::pvdsdk::EndSetPropertyValue,
+            physx::pvdsdk::SetPropertyMessage,
+            physx::pvdsdk::PushBackObjectRef,
+            physx::pvdsdk::RemoveObjectRef,
+            physx::pvdsdk::SetPickable,
+            physx::pvdsdk::SetColor,
+            physx::pvdsdk::SetIsTopLevel >;
+
+        // an event with a private copy of its payload, if it has one
+        struct HeldEvent
+        {
+            HeldVariant             m_event;
+            std::vector< uint8_t >  m_data;
+        };
+
+        static inline uint64_t messageKey( const physx::pvdsdk::StreamNamespacedName& messageName )
+        {
+            return ( static_cast<uint64_t>( messageName.mNamespace ) << 32 ) | messageName.mName;
+        }
+
+        // take a copy of an event into the held actor's list, if the actor is being held; data is the event's payload
+        template< typename TEvent >
+        bool hold( const uint64_t instanceID, const TEvent& _event, const physx::pvdsdk::DataRef<const uint8_t>* data );
+
+        void releaseHeld( const uint64_t instanceID );
+        void gatherPosition( const uint64_t instanceID, const uint8_t* transform );
+
+        RegionBounds    m_bounds;
+
+        bool            m_poseHandleKnown   = false;
+        uint32_t        m_poseHandle        = 0;
+
+        // message name -> byte offset of the GlobalPose within it
+        ankerl::unordered_dense::map< uint64_t, uint32_t >  m_messagePoseOffsets;
+
+        // PxActor and everything derived from it, and the live instances of those classes
+        ankerl::unordered_dense::set< std::string >         m_actorClasses;
+        ankerl::unordered_dense::set< uint64_t >            m_actors;
+
+        // actors that were inside the region when last tested
+        ankerl::unordered_dense::set< uint64_t >            m_inside;
+
+        // actors created this frame, with everything about them that has been held back so far
+        ankerl::unordered_dense::map< uint64_t, std::vector< HeldEvent > >  m_held;
+        ankerl::unordered_dense::set< uint64_t >            m_discardedDestroys;    // held actors destroyed this frame
+        bool                                                m_holdingSequence   = false;
+        uint64_t                                            m_sequenceInstance  = 0;
+        physx::pvdsdk::StreamNamespacedName                 m_groupMessageName;
+
+        std::vector< HeldEvent >                            m_released;
+
+        // this frame's batch of positions, one entry per actor
+        ankerl::unordered_dense::map< uint64_t, uint32_t >  m_batchIndex;
+        std::vector< uint64_t >                             m_batchIDs;
+        std::vector< float >                                m_batchX;
+        std::vector< float >                                m_batchY;
+        std::vector< float >                                m_batchZ;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    namespace region_detail
+    {
+        inline void attachData( physx::pvdsdk::SetPropertyValue& _event, const std::vector< uint8_t >& data )
+        {
+            _event.mData = physx::pvdsdk::DataRef<const uint8_t>( data.data(), static_cast<uint32_t>( data.size() ) );
+        }
+        inline void attachData( physx::pvdsdk::AppendPropertyValueData& _event, const std::vector< uint8_t >& data )
+        {
+            _event.mData = physx::pvdsdk::DataRef<const uint8_t>( data.data(), static_cast<uint32_t>( data.size() ) );
+        }
+        inline void attachData( physx::pvdsdk::SetPropertyMessage& _event, const std::vector< uint8_t >& data )
+        {
+            _event.mData = physx::pvdsdk::DataRef<const uint8_t>( data.data(), static_cast<uint32_t>( data.size() ) );
+        }
+
+        template< typename TEvent >
+        inline void attachData( TEvent&, const std::vector< uint8_t >& )
+        {
+        }
+    }
+
+    template< typename TFunc >
+    void RegionFilter::release( TFunc&& fn )
+    {
+        if ( m_released.empty() )
+            return;
+
+        for ( auto& held : m_released )
+        {
+            std::visit( [&]( auto& _event )
+            {
+                region_detail::attachData( _event, held.m_data );
+                fn( _event );
+            }, held.m_event );
+        }
+        m_released.clear();
+    }
+
+} // namespace Op
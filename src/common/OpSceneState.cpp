@@ -0,0 +1,534 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpSceneState.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    SceneColumn::SceneColumn( const uint32_t propertyHandle, const uint32_t stride, const bool isArray, const bool holdsReferences )
+        : m_propertyHandle( propertyHandle )
+        , m_stride( isArray ? 0 : stride )
+        , m_storage( isArray ? Storage::Blob : ( stride > 0 ? Storage::Fixed : Storage::Undecided ) )
+        , m_holdsReferences( holdsReferences )
+    {
+    }
+
+    void SceneColumn::resize( const uint32_t capacity )
+    {
+        m_written.resize( capacity, 0 );
+
+        if ( m_storage == Storage::Fixed )
+            m_fixed.resize( static_cast<std::size_t>( capacity ) * m_stride, 0 );
+        else if ( m_storage == Storage::Blob )
+            m_blobs.resize( capacity );
+    }
+
+    const uint8_t* SceneColumn::valueBytes( const uint32_t slot, uint32_t& size ) const
+    {
+        size = 0;
+        if ( !written( slot ) )
+            return nullptr;
+
+        if ( m_storage == Storage::Fixed )
+        {
+            size = m_stride;
+            return m_fixed.data() + static_cast<std::size_t>( slot ) * m_stride;
+        }
+
+        const auto& blob = m_blobs[slot];
+        size = static_cast<uint32_t>( blob.size() );
+        return blob.data();
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void SceneColumn::write( const uint32_t slot, const uint8_t* data, const uint32_t size )
+    {
+        // an empty payload (eg. a stubbed property) says nothing about the value's size, just that there isn't one
+        if ( size == 0 && m_storage != Storage::Blob )
+        {
+            clear( slot );
+            return;
+        }
+
+        const uint32_t capacity = static_cast<uint32_t>( m_written.size() );
+
+        if ( m_storage == Storage::Undecided )
+        {
+            m_storage = Storage::Fixed;
+            m_stride  = size;
+            resize( capacity );
+        }
+        else if ( m_storage == Storage::Fixed && size != m_stride )
+        {
+            convertToBlobs();
+        }
+
+        if ( m_storage == Storage::Fixed )
+            std::memcpy( m_fixed.data() + static_cast<std::size_t>( slot ) * m_stride, data, size );
+        else
+            m_blobs[slot].assign( data, data + size );
+
+        m_written[slot] = 1;
+    }
+
+    void SceneColumn::clear( const uint32_t slot )
+    {
+        if ( slot >= m_written.size() )
+            return;
+
+        m_written[slot] = 0;
+        if ( m_storage == Storage::Fixed )
+            std::memset( m_fixed.data() + static_cast<std::size_t>( slot ) * m_stride, 0, m_stride );
+        else if ( m_storage == Storage::Blob )
+            m_blobs[slot].clear();
+    }
+
+    void SceneColumn::convertToBlobs()
+    {
+        const uint32_t capacity = static_cast<uint32_t>( m_written.size() );
+
+        m_blobs.clear();
+        m_blobs.resize( capacity );
+
+        if ( m_storage == Storage::Fixed )
+        {
+            for ( uint32_t slot = 0; slot < capacity; slot++ )
+            {
+                if ( !m_written[slot] )
+                    continue;
+
+                const uint8_t* value = m_fixed.data() + static_cast<std::size_t>( slot ) * m_stride;
+                m_blobs[slot].assign( value, value + m_stride );
+            }
+        }
+
+        m_storage = Storage::Blob;
+        m_stride  = 0;
+        m_fixed   = {};
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // object reference collections are kept as a flat list of ids in the slot's blob
+    void SceneColumn::appendReference( const uint32_t slot, const uint64_t reference )
+    {
+        if ( m_storage != Storage::Blob )
+            convertToBlobs();
+
+        const auto* bytes = reinterpret_cast<const uint8_t*>( &reference );
+        m_blobs[slot].insert( m_blobs[slot].end(), bytes, bytes + sizeof( uint64_t ) );
+        m_written[slot] = 1;
+    }
+
+    void SceneColumn::removeReference( const uint32_t slot, const uint64_t reference )
+    {
+        if ( m_storage != Storage::Blob )
+            return;
+
+        auto& blob = m_blobs[slot];
+        for ( std::size_t offset = 0; offset + sizeof( uint64_t ) <= blob.size(); offset += sizeof( uint64_t ) )
+        {
+            uint64_t existing;
+            std::memcpy( &existing, blob.data() + offset, sizeof( uint64_t ) );
+            if ( existing == reference )
+            {
+                blob.erase( blob.begin() + offset, blob.begin() + offset + sizeof( uint64_t ) );
+                return;
+            }
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    SceneTable::SceneTable( const uint64_t classKey, std::string className )
+        : m_classKey( classKey )
+        , m_className( std::move( className ) )
+    {
+    }
+
+    const SceneColumn* SceneTable::column( const uint32_t propertyHandle ) const
+    {
+        const auto it = m_columnIndex.find( propertyHandle );
+        if ( it == m_columnIndex.end() )
+            return nullptr;
+        return &m_columns[it->second];
+    }
+
+    uint32_t SceneTable::allocate( const uint64_t instanceID )
+    {
+        uint32_t slot;
+        if ( !m_freeSlots.empty() )
+        {
+            slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else
+        {
+            slot = capacity();
+            m_instanceIDs.push_back( 0 );
+            m_live.push_back( 0 );
+
+            for ( auto& column : m_columns )
+                column.resize( slot + 1 );
+        }
+
+        m_instanceIDs[slot] = instanceID;
+        m_live[slot]        = 1;
+        return slot;
+    }
+
+    void SceneTable::release( const uint32_t slot )
+    {
+        for ( auto& column : m_columns )
+            column.clear( slot );
+
+        m_instanceIDs[slot] = 0;
+        m_live[slot]        = 0;
+        m_freeSlots.push_back( slot );
+    }
+
+    SceneColumn& SceneTable::ensureColumn( const uint32_t propertyHandle, const uint32_t stride, const bool isArray, const bool holdsReferences )
+    {
+        if ( const auto it = m_columnIndex.find( propertyHandle ); it != m_columnIndex.end() )
+        {
+            SceneColumn& column = m_columns[it->second];
+            column.m_holdsReferences |= holdsReferences;
+            return column;
+        }
+
+        m_columnIndex.emplace( propertyHandle, static_cast<uint32_t>( m_columns.size() ) );
+
+        SceneColumn& column = m_columns.emplace_back( propertyHandle, stride, isArray, holdsReferences );
+        column.resize( capacity() );
+        return column;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void SceneState::apply( const pvd::StringHandleEvent& _event )
+    {
+        std::string text( _event.mString );
+
+        if ( text == "frame" )
+        {
+            m_frameHandleKnown = true;
+            m_frameHandle      = _event.mHandle;
+        }
+
+        m_handles.insert_or_assign( text, _event.mHandle );
+        m_strings.insert_or_assign( _event.mHandle, std::move( text ) );
+    }
+
+    void SceneState::apply( const pvd::BeginSection& _event )
+    {
+        if ( m_frameHandleKnown && _event.mName == m_frameHandle )
+            m_currentFrame++;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void SceneState::apply( const pvd::CreateClass& _event )
+    {
+        ClassDef& classDef = m_classes[nameKey( _event.mName )];
+        classDef.m_name = lookupString( _event.mName.mName );
+    }
+
+    void SceneState::apply( const pvd::DeriveClass& _event )
+    {
+        ClassDef& classDef = m_classes[nameKey( _event.mChild )];
+        classDef.m_hasParent = true;
+        classDef.m_parent    = nameKey( _event.mParent );
+    }
+
+    void SceneState::apply( const pvd::CreateProperty& _event )
+    {
+        const uint64_t classKey = nameKey( _event.mClass );
+
+        PropertyDef property;
+        property.m_handle  = _event.mName;
+        property.m_isArray = ( _event.mPropertyType == pvd::PropertyType::Array );
+        property.m_stride  = property.m_isArray ? 0 : builtinSize( _event.mDatatypeName );
+        property.m_isReference = isReferenceType( _event.mDatatypeName );
+
+        m_classes[classKey].m_properties.push_back( property );
+
+        // properties may be added after instances of the class (or anything derived from it) already exist
+        for ( auto& table : m_tables )
+        {
+            if ( derivesFrom( table.first, classKey ) )
+                table.second->ensureColumn( property.m_handle, property.m_stride, property.m_isArray, property.m_isReference );
+        }
+    }
+
+    void SceneState::apply( const pvd::CreatePropertyMessage& _event )
+    {
+        std::vector< MessageField > fields;
+
+        const auto entryCount = _event.mMessageEntries.size();
+        fields.reserve( entryCount );
+        for ( uint32_t idx = 0; idx < entryCount; ++idx )
+        {
+            const auto& entry( const_cast<const physx::pvdsdk::StreamPropMessageArg&>( _event.mMessageEntries[idx] ) );
+            fields.push_back( { entry.mPropertyName, entry.mMessageOffset, entry.mByteSize, isReferenceType( entry.mDatatypeName ) } );
+        }
+
+        m_messages.insert_or_assign( nameKey( _event.mMessageName ), std::move( fields ) );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void SceneState::apply( const pvd::CreateInstance& _event )
+    {
+        // ids are recycled by the SDK; a create on a live id replaces the old instance outright
+        if ( InstanceLocation* existing = find( _event.mInstanceId ) )
+        {
+            existing->m_table->release( existing->m_slot );
+            m_instances.erase( _event.mInstanceId );
+        }
+
+        SceneTable& table = tableFor( nameKey( _event.mClass ) );
+        m_instances.insert_or_assign( _event.mInstanceId, InstanceLocation{ &table, table.allocate( _event.mInstanceId ) } );
+    }
+
+    void SceneState::apply( const pvd::DestroyInstance& _event )
+    {
+        if ( InstanceLocation* instance = find( _event.mInstanceId ) )
+        {
+            instance->m_table->release( instance->m_slot );
+            m_instances.erase( _event.mInstanceId );
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void SceneState::apply( const pvd::SetPropertyValue& _event )
+    {
+        if ( InstanceLocation* instance = find( _event.mInstanceId ) )
+        {
+            SceneColumn& column = instance->m_table->ensureColumn( _event.mPropertyName, 0, _event.mNumItems != 1, isReferenceType( _event.mIncomingTypeName ) );
+            column.write( instance->m_slot, _event.mData.begin(), _event.mData.size() );
+        }
+    }
+
+    void SceneState::apply( const pvd::BeginSetPropertyValue& _event )
+    {
+        m_sequenceInstance = _event.mInstanceId;
+        m_sequenceProperty = _event.mPropertyName;
+        m_sequenceReferences = isReferenceType( _event.mIncomingTypeName );
+        m_sequenceData.clear();
+    }
+
+    void SceneState::apply( const pvd::AppendPropertyValueData& _event )
+    {
+        m_sequenceData.insert( m_sequenceData.end(), _event.mData.begin(), _event.mData.end() );
+    }
+
+    void SceneState::apply( const pvd::EndSetPropertyValue& )
+    {
+        // sequences are how the SDK streams arrays, so they always go to a blob
+        if ( InstanceLocation* instance = find( m_sequenceInstance ) )
+        {
+            SceneColumn& column = instance->m_table->ensureColumn( m_sequenceProperty, 0, true, m_sequenceReferences );
+            column.write( instance->m_slot, m_sequenceData.data(), static_cast<uint32_t>( m_sequenceData.size() ) );
+        }
+        m_sequenceData.clear();
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void SceneState::apply( const pvd::SetPropertyMessage& _event )
+    {
+        applyMessage( _event.mInstanceId, nameKey( _event.mMessageName ), _event.mData );
+    }
+
+    void SceneState::apply( const pvd::BeginPropertyMessageGroup& _event )
+    {
+        m_groupMessage = nameKey( _event.mMsgName );
+    }
+
+    void SceneState::apply( const pvd::SendPropertyMessageFromGroup& _event )
+    {
+        applyMessage( _event.mInstance, m_groupMessage, _event.mData );
+    }
+
+    void SceneState::applyMessage( const uint64_t instanceID, const uint64_t messageKey, const pvd::DataRef<const uint8_t>& data )
+    {
+        InstanceLocation* instance = find( instanceID );
+        if ( instance == nullptr )
+            return;
+
+        const auto it = m_messages.find( messageKey );
+        if ( it == m_messages.end() )
+            return;
+
+        // messages are a packed struct of several properties at once, scatter them out into their columns
+        for ( const MessageField& field : it->second )
+        {
+            if ( static_cast<std::size_t>( field.m_offset ) + field.m_size > data.size() )
+                continue;
+
+            SceneColumn& column = instance->m_table->ensureColumn( field.m_handle, field.m_size, false, field.m_isReference );
+            column.write( instance->m_slot, data.begin() + field.m_offset, field.m_size );
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void SceneState::apply( const pvd::PushBackObjectRef& _event )
+    {
+        if ( InstanceLocation* instance = find( _event.mInstanceId ) )
+            instance->m_table->ensureColumn( _event.mProperty, 0, true, true ).appendReference( instance->m_slot, _event.mObjectRef );
+    }
+
+    void SceneState::apply( const pvd::RemoveObjectRef& _event )
+    {
+        if ( InstanceLocation* instance = find( _event.mInstanceId ) )
+            instance->m_table->ensureColumn( _event.mProperty, 0, true, true ).removeReference( instance->m_slot, _event.mObjectRef );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    const SceneTable* SceneState::findTable( const std::string& className ) const
+    {
+        for ( const auto& table : m_tables )
+        {
+            if ( table.second->className() == className )
+                return table.second.get();
+        }
+        return nullptr;
+    }
+
+    bool SceneState::findHandle( const std::string& text, uint32_t& handle ) const
+    {
+        const auto it = m_handles.find( text );
+        if ( it == m_handles.end() )
+            return false;
+
+        handle = it->second;
+        return true;
+    }
+
+    const std::string& SceneState::lookupString( const uint32_t handle ) const
+    {
+        const auto it = m_strings.find( handle );
+        if ( it == m_strings.end() )
+            return m_invalidString;
+        return it->second;
+    }
+
+    bool SceneState::locate( const uint64_t instanceID, const SceneTable*& table, uint32_t& slot ) const
+    {
+        const auto it = m_instances.find( instanceID );
+        if ( it == m_instances.end() )
+            return false;
+
+        table = it->second.m_table;
+        slot  = it->second.m_slot;
+        return true;
+    }
+
+    SceneState::InstanceLocation* SceneState::find( const uint64_t instanceID )
+    {
+        const auto it = m_instances.find( instanceID );
+        if ( it == m_instances.end() )
+            return nullptr;
+        return &it->second;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool SceneState::derivesFrom( uint64_t classKey, const uint64_t ancestorKey ) const
+    {
+        // bounded walk, in case a malformed stream manages to derive a class from itself
+        for ( std::size_t depth = 0; depth <= m_classes.size(); depth++ )
+        {
+            if ( classKey == ancestorKey )
+                return true;
+
+            const auto it = m_classes.find( classKey );
+            if ( it == m_classes.end() || !it->second.m_hasParent )
+                return false;
+
+            classKey = it->second.m_parent;
+        }
+        return false;
+    }
+
+    SceneTable& SceneState::tableFor( const uint64_t classKey )
+    {
+        if ( const auto it = m_tables.find( classKey ); it != m_tables.end() )
+            return *it->second;
+
+        // gather the columns from the whole class hierarchy, base classes first
+        std::vector< const ClassDef* > hierarchy;
+        uint64_t walkKey = classKey;
+        for ( std::size_t depth = 0; depth <= m_classes.size(); depth++ )
+        {
+            const auto it = m_classes.find( walkKey );
+            if ( it == m_classes.end() )
+                break;
+
+            hierarchy.push_back( &it->second );
+            if ( !it->second.m_hasParent )
+                break;
+            walkKey = it->second.m_parent;
+        }
+
+        const auto classIt = m_classes.find( classKey );
+        std::string className = ( classIt != m_classes.end() && !classIt->second.m_name.empty() )
+            ? classIt->second.m_name
+            : lookupString( static_cast<uint32_t>( classKey & 0xFFFFFFFF ) );
+
+        auto table = std::make_unique< SceneTable >( classKey, std::move( className ) );
+        for ( auto level = hierarchy.rbegin(); level != hierarchy.rend(); ++level )
+        {
+            for ( const PropertyDef& property : ( *level )->m_properties )
+                table->ensureColumn( property.m_handle, property.m_stride, property.m_isArray, property.m_isReference );
+        }
+
+        SceneTable& result = *table;
+        m_tables.emplace( classKey, std::move( table ) );
+        return result;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // sizes of the basic PVD datatypes, so columns can be laid out before the first value arrives; anything else
+    // is sized by its first write
+    uint32_t SceneState::builtinSize( const pvd::StreamNamespacedName& datatypeName ) const
+    {
+        static const ankerl::unordered_dense::map< std::string, uint32_t > sizes =
+        {
+            { "PvdU8",          1 },
+            { "PvdI8",          1 },
+            { "PvdBool",        1 },
+            { "PvdU16",         2 },
+            { "PvdI16",         2 },
+            { "PvdU32",         4 },
+            { "PvdI32",         4 },
+            { "PvdF32",         4 },
+            { "PvdU64",         8 },
+            { "PvdI64",         8 },
+            { "PvdF64",         8 },
+            { "ObjectRef",      8 },
+            { "VoidPtr",        8 },
+            { "PxVec2",         8 },
+            { "PxVec3",         12 },
+            { "PxVec4",         16 },
+            { "PxQuat",         16 },
+            { "PxBounds3",      24 },
+            { "PxTransform",    28 },
+            { "PxMat33",        36 },
+            { "PxMat44",        64 },
+        };
+
+        const auto it = sizes.find( lookupString( datatypeName.mName ) );
+        if ( it == sizes.end() )
+            return 0;
+        return it->second;
+    }
+
+    bool SceneState::isReferenceType( const pvd::StreamNamespacedName& datatypeName ) const
+    {
+        const std::string& name = lookupString( datatypeName.mName );
+        return name == "ObjectRef" || name == "VoidPtr";
+    }
+
+} // namespace Op
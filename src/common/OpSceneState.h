@@ -0,0 +1,290 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// the scene as it stands at the current point in the stream, rebuilt by applying events to it in order. Instances
+// live in one SceneTable per class; each table is a structure-of-arrays, one SceneColumn per property (its own and
+// everything inherited through DeriveClass), indexed by slot. Slots freed by DestroyInstance are handed out again
+// to the next instance of that class, so tables stay dense over long captures.
+//
+// Columns holding a fixed-size value (scalars, vectors, transforms...) keep them packed one after the other, ready
+// for tight bulk scans:
+//
+//  const auto* actors = scene.findTable( "PxRigidDynamic" );
+//  const auto* poses  = actors->column( poseHandle )->values< PoseType >();
+//  actors->forEachLive( [&]( uint32_t slot, uint64_t instanceID ) { ... poses[slot] ... } );
+//
+// variable-length data (arrays, strings, object reference collections) is kept as a byte blob per slot instead
+//
+
+#pragma once
+
+#include "common/OpEventUnpacker.h"
+
+namespace Op
+{
+    class SceneState;
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    class SceneColumn
+    {
+    public:
+
+        enum class Storage : uint8_t
+        {
+            Undecided,      // nothing written yet, and the definition didn't tell us how big a value is
+            Fixed,
+            Blob
+        };
+
+        SceneColumn( const uint32_t propertyHandle, const uint32_t stride, const bool isArray, const bool holdsReferences );
+
+        [[nodiscard]] inline uint32_t propertyHandle() const    { return m_propertyHandle; }
+        [[nodiscard]] inline Storage  storage() const           { return m_storage; }
+        [[nodiscard]] inline uint32_t stride() const            { return m_stride; }
+
+        // values are instance IDs or raw pointers (ObjectRef, VoidPtr, reference collections), which differ from one
+        // run to the next even when the scene is identical
+        [[nodiscard]] inline bool     holdsReferences() const   { return m_holdsReferences; }
+
+        // true once a value has been written for the slot (since its instance was created)
+        [[nodiscard]] inline bool written( const uint32_t slot ) const
+        {
+            return slot < m_written.size() && m_written[slot] != 0;
+        }
+
+        // the packed values, indexed by slot; nullptr unless the column holds fixed values of exactly sizeof( T )
+        template< typename T >
+        [[nodiscard]] inline const T* values() const
+        {
+            static_assert( std::is_trivially_copyable_v< T >, "column values are raw bytes" );
+
+            if ( m_storage != Storage::Fixed || m_stride != sizeof( T ) )
+                return nullptr;
+            return reinterpret_cast<const T*>( m_fixed.data() );
+        }
+
+        // the raw bytes of one slot's value, whichever storage is in use
+        [[nodiscard]] const uint8_t* valueBytes( const uint32_t slot, uint32_t& size ) const;
+
+    private:
+
+        friend class SceneTable;
+        friend class SceneState;
+
+        void resize( const uint32_t capacity );
+        void write( const uint32_t slot, const uint8_t* data, const uint32_t size );
+        void clear( const uint32_t slot );
+
+        void appendReference( const uint32_t slot, const uint64_t reference );
+        void removeReference( const uint32_t slot, const uint64_t reference );
+
+        // values of varying size turned up; move everything over to per-slot blobs
+        void convertToBlobs();
+
+        uint32_t                                m_propertyHandle;
+        uint32_t                                m_stride;
+        Storage                                 m_storage;
+        bool                                    m_holdsReferences;
+
+        std::vector< uint8_t >                  m_fixed;            // m_stride bytes per slot
+        std::vector< std::vector< uint8_t > >   m_blobs;            // one per slot
+        std::vector< uint8_t >                  m_written;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    class SceneTable
+    {
+    public:
+
+        SceneTable( const uint64_t classKey, std::string className );
+
+        [[nodiscard]] inline uint64_t           classKey() const    { return m_classKey; }
+        [[nodiscard]] inline const std::string& className() const   { return m_className; }
+
+        [[nodiscard]] inline uint32_t capacity() const              { return static_cast<uint32_t>( m_instanceIDs.size() ); }
+        [[nodiscard]] inline uint32_t liveCount() const             { return capacity() - static_cast<uint32_t>( m_freeSlots.size() ); }
+        [[nodiscard]] inline bool     live( const uint32_t slot ) const { return m_live[slot] != 0; }
+
+        [[nodiscard]] inline const uint64_t* instanceIDs() const    { return m_instanceIDs.data(); }
+        [[nodiscard]] inline const uint8_t*  liveMask() const       { return m_live.data(); }
+
+        [[nodiscard]] const SceneColumn* column( const uint32_t propertyHandle ) const;
+
+        template< typename TFunc >
+        void forEachColumn( TFunc&& fn ) const
+        {
+            for ( const auto& column : m_columns )
+                fn( column );
+        }
+
+        // fn( slot, instanceID ) for every live instance, in slot order
+        template< typename TFunc >
+        void forEachLive( TFunc&& fn ) const
+        {
+            const uint32_t slotCount = capacity();
+            for ( uint32_t slot = 0; slot < slotCount; slot++ )
+            {
+                if ( m_live[slot] )
+                    fn( slot, m_instanceIDs[slot] );
+            }
+        }
+
+    private:
+
+        friend class SceneState;
+
+        uint32_t allocate( const uint64_t instanceID );
+        void release( const uint32_t slot );
+
+        SceneColumn& ensureColumn( const uint32_t propertyHandle, const uint32_t stride, const bool isArray, const bool holdsReferences );
+
+        uint64_t                                        m_classKey;
+        std::string                                     m_className;
+
+        std::vector< uint64_t >                         m_instanceIDs;
+        std::vector< uint8_t >                          m_live;
+        std::vector< uint32_t >                         m_freeSlots;
+
+        std::vector< SceneColumn >                      m_columns;
+        ankerl::unordered_dense::map< uint32_t, uint32_t > m_columnIndex;  // property handle -> m_columns
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    class SceneState
+    {
+    public:
+
+        void apply( const pvd::StringHandleEvent& _event );
+        void apply( const pvd::CreateClass& _event );
+        void apply( const pvd::DeriveClass& _event );
+        void apply( const pvd::CreateProperty& _event );
+        void apply( const pvd::CreatePropertyMessage& _event );
+        void apply( const pvd::CreateInstance& _event );
+        void apply( const pvd::DestroyInstance& _event );
+        void apply( const pvd::SetPropertyValue& _event );
+        void apply( const pvd::BeginSetPropertyValue& _event );
+        void apply( const pvd::AppendPropertyValueData& _event );
+        void apply( const pvd::EndSetPropertyValue& _event );
+        void apply( const pvd::SetPropertyMessage& _event );
+        void apply( const pvd::BeginPropertyMessageGroup& _event );
+        void apply( const pvd::SendPropertyMessageFromGroup& _event );
+        void apply( const pvd::PushBackObjectRef& _event );
+        void apply( const pvd::RemoveObjectRef& _event );
+        void apply( const pvd::BeginSection& _event );
+
+        template< typename TEvent >
+        inline void apply( const TEvent& ) {}
+
+        // frames are counted off "frame" sections, the first being frame 1
+        [[nodiscard]] inline uint64_t currentFrame() const { return m_currentFrame; }
+
+        [[nodiscard]] const SceneTable* findTable( const std::string& className ) const;
+        [[nodiscard]] bool findHandle( const std::string& text, uint32_t& handle ) const;
+        [[nodiscard]] const std::string& lookupString( const uint32_t handle ) const;
+
+        // where an instance currently lives
+        [[nodiscard]] bool locate( const uint64_t instanceID, const SceneTable*& table, uint32_t& slot ) const;
+
+        // copy out an instance's fixed-size property value, false if there isn't one of that size
+        template< typename T >
+        bool read( const uint64_t instanceID, const uint32_t propertyHandle, T& value ) const
+        {
+            const SceneTable* table = nullptr;
+            uint32_t slot = 0;
+            if ( !locate( instanceID, table, slot ) )
+                return false;
+
+            const SceneColumn* column = table->column( propertyHandle );
+            if ( column == nullptr || !column->written( slot ) )
+                return false;
+
+            uint32_t size = 0;
+            const uint8_t* bytes = column->valueBytes( slot, size );
+            if ( size != sizeof( T ) )
+                return false;
+
+            std::memcpy( &value, bytes, sizeof( T ) );
+            return true;
+        }
+
+        template< typename TFunc >
+        void forEachTable( TFunc&& fn ) const
+        {
+            for ( const auto& table : m_tables )
+                fn( *table.second );
+        }
+
+        [[nodiscard]] inline std::size_t liveInstanceCount() const { return m_instances.size(); }
+
+    private:
+
+        struct PropertyDef
+        {
+            uint32_t    m_handle;
+            uint32_t    m_stride;       // 0 if unknown until written
+            bool        m_isArray;
+            bool        m_isReference;
+        };
+
+        struct ClassDef
+        {
+            std::string                 m_name;
+            bool                        m_hasParent = false;
+            uint64_t                    m_parent    = 0;
+            std::vector< PropertyDef >  m_properties;
+        };
+
+        struct MessageField
+        {
+            uint32_t    m_handle;
+            uint32_t    m_offset;
+            uint32_t    m_size;
+            bool        m_isReference;
+        };
+
+        struct InstanceLocation
+        {
+            SceneTable* m_table;
+            uint32_t    m_slot;
+        };
+
+        static inline uint64_t nameKey( const pvd::StreamNamespacedName& name )
+        {
+            return ( static_cast<uint64_t>( name.mNamespace ) << 32 ) | name.mName;
+        }
+
+        bool derivesFrom( uint64_t classKey, const uint64_t ancestorKey ) const;
+        SceneTable& tableFor( const uint64_t classKey );
+        uint32_t builtinSize( const pvd::StreamNamespacedName& datatypeName ) const;
+        bool isReferenceType( const pvd::StreamNamespacedName& datatypeName ) const;
+
+        void applyMessage( const uint64_t instanceID, const uint64_t messageKey, const pvd::DataRef<const uint8_t>& data );
+
+        InstanceLocation* find( const uint64_t instanceID );
+
+        ankerl::unordered_dense::map< uint32_t, std::string >                   m_strings;
+        ankerl::unordered_dense::map< std::string, uint32_t >                   m_handles;
+        ankerl::unordered_dense::map< uint64_t, ClassDef >                      m_classes;
+        ankerl::unordered_dense::map< uint64_t, std::vector< MessageField > >   m_messages;
+        ankerl::unordered_dense::map< uint64_t, std::unique_ptr< SceneTable > > m_tables;
+        ankerl::unordered_dense::map< uint64_t, InstanceLocation >              m_instances;
+
+        // Begin/Append/End sequences and message groups in progress
+        uint64_t                    m_sequenceInstance  = 0;
+        uint32_t                    m_sequenceProperty  = 0;
+        bool                        m_sequenceReferences = false;
+        std::vector< uint8_t >      m_sequenceData;
+        uint64_t                    m_groupMessage      = 0;
+
+        bool                        m_frameHandleKnown  = false;
+        uint32_t                    m_frameHandle       = 0;
+        uint64_t                    m_currentFrame      = 0;
+
+        const std::string           m_invalidString     = "<invalid>";
+    };
+
+} // namespace Op
@@ -0,0 +1,294 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpSizeBudget.h"
+
+#include "common/OpBlockReader.h"
+#include "common/OpEventCursor.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool SizeBudget::parse( const std::string& text, std::string& className, uint64_t& budgetBytes )
+    {
+        const auto split = text.find( '=' );
+        if ( split == std::string::npos || split == 0 )
+            return false;
+
+        className = text.substr( 0, split );
+
+        const char* sizeText = text.c_str() + split + 1;
+        char* suffix = nullptr;
+        const double amount = std::strtod( sizeText, &suffix );
+        if ( suffix == sizeText || amount < 0 )
+            return false;
+
+        std::string unit( suffix );
+        std::transform( unit.begin(), unit.end(), unit.begin(), []( unsigned char c ) { return static_cast<char>( std::tolower( c ) ); } );
+
+        double scale = 1.0;
+        if ( unit.empty() || unit == "b" )
+            scale = 1.0;
+        else if ( unit == "k" || unit == "kb" )
+            scale = 1024.0;
+        else if ( unit == "m" || unit == "mb" )
+            scale = 1024.0 * 1024.0;
+        else if ( unit == "g" || unit == "gb" )
+            scale = 1024.0 * 1024.0 * 1024.0;
+        else
+            return false;
+
+        budgetBytes = static_cast<uint64_t>( amount * scale );
+        return true;
+    }
+
+    void SizeBudget::addBudget( const std::string& className, const uint64_t budgetBytes )
+    {
+        m_classes[className].m_budget = budgetBytes;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    uint32_t SizeBudget::nextGeneration( const uint64_t instanceID )
+    {
+        return m_generations[instanceID]++;
+    }
+
+    bool SizeBudget::onCreateInstance( const uint64_t instanceID )
+    {
+        const uint32_t generation = nextGeneration( instanceID );
+        if ( m_dropped.empty() )
+            return false;
+
+        return m_dropped.contains( LifetimeKey{ instanceID, generation } );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool SizeBudget::scan( const std::string& filename, const uint64_t fromFrame, const uint64_t toFrame, const bool resync )
+    {
+        auto source = FileBlockSource::open( filename );
+        if ( !source )
+            return false;
+
+        BlockReader reader( std::move( source ) );
+        EventCursor< BlockReader > cursor( reader );
+
+        // recover from corrupt input the same way the filtering pass will, so both see the same CreateInstance events
+        // and count the same generations
+        StreamResync streamResync;
+        if ( resync )
+            cursor.setResync( &streamResync );
+
+        physx::pvdsdk::StreamInitialization init;
+        if ( !cursor.readInitialization( init ) )
+            return false;
+
+        ankerl::unordered_dense::map< uint32_t, std::string >   strings;
+        ankerl::unordered_dense::map< uint64_t, uint32_t >      live;           // budgeted instance -> lifetime index
+        std::vector< Lifetime >                                 lifetimes;
+
+        // ahead of the frame window only the latest value of each property and message makes it into the output, as
+        // part of the state prelude; these are tracked per lifetime until the window opens
+        struct LatestSizes
+        {
+            ankerl::unordered_dense::map< uint32_t, uint64_t >  m_properties;
+            ankerl::unordered_dense::map< uint64_t, uint64_t >  m_messages;
+        };
+        std::vector< LatestSizes >                              latestSizes;
+
+        uint64_t frame           = 0;
+        bool     bInWindow       = ( fromFrame <= 1 );
+        uint64_t sequenceInstance = 0;                                          // of the active Begin/Append/End sequence
+        uint32_t sequenceProperty = 0;
+        physx::pvdsdk::StreamNamespacedName groupMessageName;
+
+        const auto liveLifetime = [&]( const uint64_t instanceID ) -> uint32_t
+        {
+            const auto it = live.find( instanceID );
+            return ( it != live.end() ) ? it->second : std::numeric_limits< uint32_t >::max();
+        };
+
+        const auto setProperty = [&]( const uint64_t instanceID, const uint32_t property, const uint64_t bytes, const bool bAppend )
+        {
+            const uint32_t index = liveLifetime( instanceID );
+            if ( index == std::numeric_limits< uint32_t >::max() )
+                return;
+
+            if ( bInWindow )
+                lifetimes[index].m_bytes += bytes;
+            else if ( bAppend )
+                latestSizes[index].m_properties[property] += bytes;
+            else
+                latestSizes[index].m_properties.insert_or_assign( property, bytes );
+        };
+
+        const auto setMessage = [&]( const uint64_t instanceID, const physx::pvdsdk::StreamNamespacedName& messageName, const uint64_t bytes )
+        {
+            const uint32_t index = liveLifetime( instanceID );
+            if ( index == std::numeric_limits< uint32_t >::max() )
+                return;
+
+            if ( bInWindow )
+                lifetimes[index].m_bytes += bytes;
+            else
+                latestSizes[index].m_messages.insert_or_assign( ( static_cast<uint64_t>( messageName.mNamespace ) << 32 ) | messageName.mName, bytes );
+        };
+
+        // the prelude carries whatever the instances still alive at the start of the window were last set to
+        const auto openWindow = [&]()
+        {
+            bInWindow = true;
+            for ( const auto& [instanceID, index] : live )
+            {
+                for ( const auto& property : latestSizes[index].m_properties )
+                    lifetimes[index].m_bytes += property.second;
+                for ( const auto& message : latestSizes[index].m_messages )
+                    lifetimes[index].m_bytes += message.second;
+            }
+            latestSizes.clear();
+            latestSizes.shrink_to_fit();
+        };
+
+        EventView view;
+        while ( cursor.next( view ) )
+        {
+            switch ( view.m_type )
+            {
+            case PvdEventType::StringHandleEvent:
+            {
+                const auto* ev = view.as< physx::pvdsdk::StringHandleEvent >();
+                strings.insert_or_assign( ev->mHandle, std::string( ev->mString ) );
+            }
+            break;
+
+            case PvdEventType::BeginSection:
+            {
+                const auto* ev = view.as< physx::pvdsdk::BeginSection >();
+                if ( const auto name = strings.find( ev->mName ); name != strings.end() && name->second == "frame" )
+                    frame++;
+            }
+            break;
+
+            case PvdEventType::CreateInstance:
+            {
+                const auto* ev = view.as< physx::pvdsdk::CreateInstance >();
+                const uint32_t generation = nextGeneration( ev->mInstanceId );
+
+                const auto className = strings.find( ev->mClass.mName );
+                if ( className == strings.end() )
+                    break;
+
+                if ( const auto budget = m_classes.find( className->second ); budget != m_classes.end() )
+                {
+                    live.insert_or_assign( ev->mInstanceId, static_cast<uint32_t>( lifetimes.size() ) );
+                    lifetimes.push_back( { { ev->mInstanceId, generation }, 0, &budget->second } );
+                    if ( !bInWindow )
+                        latestSizes.emplace_back();
+                }
+            }
+            break;
+
+            case PvdEventType::DestroyInstance:
+                live.erase( view.as< physx::pvdsdk::DestroyInstance >()->mInstanceId );
+                break;
+
+            case PvdEventType::SetPropertyValue:
+            {
+                const auto* ev = view.as< physx::pvdsdk::SetPropertyValue >();
+                setProperty( ev->mInstanceId, ev->mPropertyName, ev->mData.size(), false );
+            }
+            break;
+
+            case PvdEventType::BeginSetPropertyValue:
+            {
+                const auto* ev = view.as< physx::pvdsdk::BeginSetPropertyValue >();
+                sequenceInstance = ev->mInstanceId;
+                sequenceProperty = ev->mPropertyName;
+                setProperty( sequenceInstance, sequenceProperty, 0, false );
+            }
+            break;
+
+            case PvdEventType::AppendPropertyValueData:
+                setProperty( sequenceInstance, sequenceProperty, view.as< physx::pvdsdk::AppendPropertyValueData >()->mData.size(), true );
+                break;
+
+            case PvdEventType::SetPropertyMessage:
+            {
+                const auto* ev = view.as< physx::pvdsdk::SetPropertyMessage >();
+                setMessage( ev->mInstanceId, ev->mMessageName, ev->mData.size() );
+            }
+            break;
+
+            case PvdEventType::BeginPropertyMessageGroup:
+                groupMessageName = view.as< physx::pvdsdk::BeginPropertyMessageGroup >()->mMsgName;
+                break;
+
+            case PvdEventType::SendPropertyMessageFromGroup:
+            {
+                const auto* ev = view.as< physx::pvdsdk::SendPropertyMessageFromGroup >();
+                setMessage( ev->mInstance, groupMessageName, ev->mData.size() );
+            }
+            break;
+
+            default:
+                break;
+            }
+
+            // the same window the filtering pass applies; nothing past its end is read
+            if ( !bInWindow && frame >= fromFrame )
+                openWindow();
+            if ( toFrame > 0 && frame > toFrame )
+                break;
+        }
+
+        // without --resync the filtering pass stops at the same point, so what was measured up to it still holds
+        if ( cursor.failed() )
+            spdlog::warn( "size scan stopped at corrupt data after {} events", cursor.eventsRead() );
+
+        // generations are counted again from scratch by the filtering pass
+        m_generations.clear();
+
+        for ( const auto& lifetime : lifetimes )
+        {
+            lifetime.m_class->m_totalBytes += lifetime.m_bytes;
+            lifetime.m_class->m_instances++;
+        }
+
+        // one max-heap over every budgeted lifetime, largest payload on top; pop until each class fits
+        const auto bySize = []( const Lifetime* lhs, const Lifetime* rhs ) { return lhs->m_bytes < rhs->m_bytes; };
+
+        std::vector< const Lifetime* > heap;
+        heap.reserve( lifetimes.size() );
+        for ( const auto& lifetime : lifetimes )
+        {
+            // lifetimes that ended before the window opened aren't in the output at all
+            if ( lifetime.m_bytes > 0 && lifetime.m_class->m_totalBytes > lifetime.m_class->m_budget )
+                heap.push_back( &lifetime );
+        }
+        std::make_heap( heap.begin(), heap.end(), bySize );
+
+        while ( !heap.empty() )
+        {
+            std::pop_heap( heap.begin(), heap.end(), bySize );
+            const Lifetime* largest = heap.back();
+            heap.pop_back();
+
+            ClassBudget& budget = *largest->m_class;
+            if ( budget.m_totalBytes - budget.m_droppedBytes <= budget.m_budget )
+                continue;
+
+            m_dropped.emplace( largest->m_key );
+            budget.m_droppedBytes += largest->m_bytes;
+            budget.m_droppedInstances++;
+        }
+
+        return true;
+    }
+
+} // namespace Op
@@ -0,0 +1,95 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// per-class byte budgets; a pre-scan of the capture measures how much property payload every instance of a budgeted
+// class carries over its lifetime, then the largest are pulled off a size-ordered heap and marked for dropping until
+// what remains fits. Taking the biggest first keeps as many instances as possible in the output.
+//
+// Instance IDs get reused once destroyed, so each lifetime is identified by ( id, generation ), with the generation
+// counted off CreateInstance events - the filtering pass counts them the same way to find the instances chosen here
+//
+
+#pragma once
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class SizeBudget
+    {
+    public:
+
+        struct ClassBudget
+        {
+            uint64_t    m_budget            = 0;
+            uint64_t    m_totalBytes        = 0;    // found by the scan
+            uint64_t    m_instances         = 0;
+            uint64_t    m_droppedBytes      = 0;    // chosen to be dropped
+            uint64_t    m_droppedInstances  = 0;
+        };
+
+        // parse "Class=SIZE", where SIZE is a byte count with an optional KB / MB / GB suffix
+        static bool parse( const std::string& text, std::string& className, uint64_t& budgetBytes );
+
+        void addBudget( const std::string& className, const uint64_t budgetBytes );
+
+        [[nodiscard]] inline bool empty() const { return m_classes.empty(); }
+
+        // measure every budgeted instance in the capture and choose which to drop; returns false if it couldn't be read.
+        // Only what the filtering pass will write is measured - the frames from fromFrame to toFrame (0 for the end),
+        // plus the latest values of anything still alive going into fromFrame. With resync, corrupt input is skipped
+        // exactly as the filtering pass will skip it
+        bool scan( const std::string& filename, const uint64_t fromFrame, const uint64_t toFrame, const bool resync );
+
+        // call for every CreateInstance in the filtering pass, in stream order; true if this instance should be dropped
+        bool onCreateInstance( const uint64_t instanceID );
+
+        template< typename TFunc >
+        void forEachClass( TFunc&& fn ) const
+        {
+            for ( const auto& budget : m_classes )
+                fn( budget.first, budget.second );
+        }
+
+    private:
+
+        struct LifetimeKey
+        {
+            uint64_t    m_instanceID;
+            uint32_t    m_generation;
+
+            bool operator==( const LifetimeKey& rhs ) const
+            {
+                return m_instanceID == rhs.m_instanceID && m_generation == rhs.m_generation;
+            }
+        };
+
+        struct LifetimeKeyHash
+        {
+            using is_avalanching = void;
+
+            uint64_t operator()( const LifetimeKey& key ) const noexcept
+            {
+                using namespace ankerl::unordered_dense::detail;
+                return wyhash::mix( wyhash::hash( key.m_instanceID ), key.m_generation );
+            }
+        };
+
+        struct Lifetime
+        {
+            LifetimeKey     m_key;
+            uint64_t        m_bytes;
+            ClassBudget*    m_class;
+        };
+
+        uint32_t nextGeneration( const uint64_t instanceID );
+
+        ankerl::unordered_dense::map< std::string, ClassBudget >                    m_classes;
+        ankerl::unordered_dense::map< uint64_t, uint32_t >                          m_generations;
+        ankerl::unordered_dense::set< LifetimeKey, LifetimeKeyHash >                m_dropped;
+    };
+
+} // namespace Op
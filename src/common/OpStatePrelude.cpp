@@ -0,0 +1,196 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpStatePrelude.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    void StatePrelude::record( pvd::CreateInstance& _event )
+    {
+        // ids can be recycled once destroyed, always start from a clean slate
+        InstanceState& instance = m_instances[_event.mInstanceId];
+        instance = InstanceState();
+        instance.m_create = _event;
+    }
+
+    void StatePrelude::record( pvd::DestroyInstance& _event )
+    {
+        m_instances.erase( _event.mInstanceId );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void StatePrelude::record( pvd::SetPropertyValue& _event )
+    {
+        if ( InstanceState* instance = findInstance( _event.mInstanceId ) )
+        {
+            resetValue( instance->m_properties[_event.mPropertyName] ).append( _event );
+        }
+    }
+
+    void StatePrelude::record( pvd::BeginSetPropertyValue& _event )
+    {
+        InstanceState* instance = findInstance( _event.mInstanceId );
+
+        m_sequenceActive = ( instance != nullptr );
+        if ( !m_sequenceActive )
+            return;
+
+        m_sequenceInstance = _event.mInstanceId;
+        m_sequenceProperty = _event.mPropertyName;
+
+        // the whole sequence replaces whatever value the property had before
+        resetValue( instance->m_properties[_event.mPropertyName] ).append( _event );
+    }
+
+    void StatePrelude::record( pvd::AppendPropertyValueData& _event )
+    {
+        if ( !m_sequenceActive )
+            return;
+
+        if ( InstanceState* instance = findInstance( m_sequenceInstance ) )
+            instance->m_properties[m_sequenceProperty].m_events.append( _event );
+    }
+
+    void StatePrelude::record( pvd::EndSetPropertyValue& _event )
+    {
+        if ( !m_sequenceActive )
+            return;
+
+        if ( InstanceState* instance = findInstance( m_sequenceInstance ) )
+            instance->m_properties[m_sequenceProperty].m_events.append( _event );
+
+        m_sequenceActive = false;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void StatePrelude::record( pvd::SetPropertyMessage& _event )
+    {
+        if ( InstanceState* instance = findInstance( _event.mInstanceId ) )
+        {
+            resetValue( instance->m_messages[messageKey( _event.mMessageName )] ).append( _event );
+        }
+    }
+
+    void StatePrelude::record( pvd::BeginPropertyMessageGroup& _event )
+    {
+        m_groupMessageName = _event.mMsgName;
+    }
+
+    void StatePrelude::record( pvd::SendPropertyMessageFromGroup& _event )
+    {
+        // grouped messages are kept as standalone SetPropertyMessage events, only the latest per instance matters
+        pvd::SetPropertyMessage message;
+        message.mInstanceId  = _event.mInstance;
+        message.mMessageName = m_groupMessageName;
+        message.mData        = _event.mData;
+
+        record( message );
+    }
+
+    void StatePrelude::record( pvd::EndPropertyMessageGroup& _event )
+    {
+        m_groupMessageName = pvd::StreamNamespacedName();
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void StatePrelude::record( pvd::PushBackObjectRef& _event )
+    {
+        if ( InstanceState* instance = findInstance( _event.mInstanceId ) )
+            instance->m_references.push_back( { _event.mProperty, _event.mObjectRef } );
+    }
+
+    void StatePrelude::record( pvd::RemoveObjectRef& _event )
+    {
+        if ( InstanceState* instance = findInstance( _event.mInstanceId ) )
+        {
+            auto& references = instance->m_references;
+            const auto it = std::find_if( references.begin(), references.end(), [&]( const ObjectRef& ref )
+                {
+                    return ref.m_property == _event.mProperty && ref.m_objectRef == _event.mObjectRef;
+                });
+
+            if ( it != references.end() )
+                references.erase( it );
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void StatePrelude::record( pvd::SetIsTopLevel& _event )     { recordAttribute( _event.mInstanceId, _event ); }
+    void StatePrelude::record( pvd::SetPickable& _event )       { recordAttribute( _event.mInstanceId, _event ); }
+    void StatePrelude::record( pvd::SetColor& _event )          { recordAttribute( _event.mInstanceId, _event ); }
+
+    void StatePrelude::record( pvd::SetCamera& _event )
+    {
+        EncodedEvents& camera = m_cameras[std::string( _event.mName )];
+        camera.clear();
+        camera.append( _event );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void StatePrelude::emit( EventWriter& _writer, const pvd::EventGroup& _group )
+    {
+        _writer.writeEncoded( _group, m_definitions );
+
+        // every live instance has to exist before any property or reference can point at it
+        for ( auto& [instanceID, instance] : m_instances )
+            _writer.write( _group, instance.m_create );
+
+        std::vector< const LatestValue* > values;
+        for ( const auto& [instanceID, instance] : m_instances )
+        {
+            for ( const auto& attribute : instance.m_attributes )
+                _writer.writeEncoded( _group, attribute.second );
+
+            // properties and messages in the order they were last set, so later writes still win
+            values.clear();
+            for ( const auto& property : instance.m_properties )
+                values.push_back( &property.second );
+            for ( const auto& message : instance.m_messages )
+                values.push_back( &message.second );
+
+            std::sort( values.begin(), values.end(), []( const LatestValue* lhs, const LatestValue* rhs )
+                {
+                    return lhs->m_sequence < rhs->m_sequence;
+                });
+
+            for ( const LatestValue* value : values )
+                _writer.writeEncoded( _group, value->m_events );
+        }
+
+        for ( const auto& [instanceID, instance] : m_instances )
+        {
+            for ( const auto& ref : instance.m_references )
+            {
+                // stale references to instances that have since gone are not worth restoring
+                if ( !m_instances.contains( ref.m_objectRef ) )
+                    continue;
+
+                pvd::PushBackObjectRef pushBack;
+                pushBack.mInstanceId = instanceID;
+                pushBack.mProperty   = ref.m_property;
+                pushBack.mObjectRef  = ref.m_objectRef;
+                _writer.write( _group, pushBack );
+            }
+        }
+
+        for ( const auto& camera : m_cameras )
+            _writer.writeEncoded( _group, camera.second );
+    }
+
+    void StatePrelude::clear()
+    {
+        m_definitions.clear();
+        m_instances.clear();
+        m_cameras.clear();
+        m_sequenceActive = false;
+    }
+
+} // namespace Op
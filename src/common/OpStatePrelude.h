@@ -0,0 +1,138 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// cutting a range of frames out of the middle of a stream only produces something loadable if everything the window
+// depends on is re-established first. StatePrelude soaks up the events that precede the window and folds them down
+// into the minimum needed to recreate the scene at that point - every definition (strings, classes, properties, in
+// stream order), the instances still alive, the most recent value of each of their properties and messages, and
+// their current object references. emit() then writes that out as a compact, self-contained prelude
+//
+
+#pragma once
+
+#include "common/OpEventWriter.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class StatePrelude
+    {
+    public:
+
+        StatePrelude()
+        {
+            m_instances.reserve( 4096 );
+        }
+
+        // definitions are kept verbatim, in order
+        void record( pvd::StringHandleEvent& _event )           { m_definitions.append( _event ); }
+        void record( pvd::CreateClass& _event )                 { m_definitions.append( _event ); }
+        void record( pvd::DeriveClass& _event )                 { m_definitions.append( _event ); }
+        void record( pvd::CreateProperty& _event )              { m_definitions.append( _event ); }
+        void record( pvd::CreatePropertyMessage& _event )       { m_definitions.append( _event ); }
+        void record( pvd::AddProfileZone& _event )              { m_definitions.append( _event ); }
+        void record( pvd::AddProfileZoneEvent& _event )         { m_definitions.append( _event ); }
+
+        // instance state is reduced to its latest values
+        void record( pvd::CreateInstance& _event );
+        void record( pvd::DestroyInstance& _event );
+        void record( pvd::SetPropertyValue& _event );
+        void record( pvd::BeginSetPropertyValue& _event );
+        void record( pvd::AppendPropertyValueData& _event );
+        void record( pvd::EndSetPropertyValue& _event );
+        void record( pvd::SetPropertyMessage& _event );
+        void record( pvd::BeginPropertyMessageGroup& _event );
+        void record( pvd::SendPropertyMessageFromGroup& _event );
+        void record( pvd::EndPropertyMessageGroup& _event );
+        void record( pvd::PushBackObjectRef& _event );
+        void record( pvd::RemoveObjectRef& _event );
+        void record( pvd::SetIsTopLevel& _event );
+        void record( pvd::SetPickable& _event );
+        void record( pvd::SetColor& _event );
+        void record( pvd::SetCamera& _event );
+
+        // sections, profiler data, origin shifts and errors only mean anything in the frame they arrived in
+        template< typename TEvent >
+        inline void record( TEvent& ) {}
+
+        // write the prelude out, stamping every event with the stream id / timestamp of _group
+        void emit( EventWriter& _writer, const pvd::EventGroup& _group );
+
+        void clear();
+
+        [[nodiscard]] inline std::size_t liveInstanceCount() const { return m_instances.size(); }
+
+    private:
+
+        struct ObjectRef
+        {
+            uint32_t    m_property;
+            uint64_t    m_objectRef;
+        };
+
+        // a property's or message's latest value, stamped with when it was set; properties and messages can write the
+        // same fields, so they are replayed in the order they last arrived rather than grouped by kind
+        struct LatestValue
+        {
+            uint64_t        m_sequence  = 0;
+            EncodedEvents   m_events;
+        };
+
+        struct InstanceState
+        {
+            pvd::CreateInstance                                         m_create;
+            ankerl::unordered_dense::map< uint32_t, LatestValue >       m_properties;       // by property name handle
+            ankerl::unordered_dense::map< uint64_t, LatestValue >       m_messages;         // by message name
+            ankerl::unordered_dense::map< uint32_t, EncodedEvents >     m_attributes;       // by PvdEventType, eg. SetColor
+            std::vector< ObjectRef >                                    m_references;       // in push order
+        };
+
+        static inline uint64_t messageKey( const pvd::StreamNamespacedName& messageName )
+        {
+            return ( static_cast<uint64_t>( messageName.mNamespace ) << 32 ) | messageName.mName;
+        }
+
+        InstanceState* findInstance( const uint64_t instanceID )
+        {
+            const auto it = m_instances.find( instanceID );
+            return ( it != m_instances.end() ) ? &it->second : nullptr;
+        }
+
+        template< typename TEvent >
+        void recordAttribute( const uint64_t instanceID, TEvent& _event )
+        {
+            if ( InstanceState* instance = findInstance( instanceID ) )
+            {
+                EncodedEvents& attribute = instance->m_attributes[static_cast<uint32_t>( EventTypeOf< TEvent >::cType )];
+                attribute.clear();
+                attribute.append( _event );
+            }
+        }
+
+        // starts afresh with a new value, stamped as the most recent
+        inline EncodedEvents& resetValue( LatestValue& value )
+        {
+            value.m_sequence = ++m_valueSequence;
+            value.m_events.clear();
+            return value.m_events;
+        }
+
+        EncodedEvents                                               m_definitions;
+        uint64_t                                                    m_valueSequence     = 0;
+        ankerl::unordered_dense::map< uint64_t, InstanceState >     m_instances;
+        ankerl::unordered_dense::map< std::string, EncodedEvents >  m_cameras;
+
+        // an in-flight Begin / Append / EndSetPropertyValue sequence
+        bool                        m_sequenceActive    = false;
+        uint64_t                    m_sequenceInstance  = 0;
+        uint32_t                    m_sequenceProperty  = 0;
+
+        // the message type of an in-flight property message group
+        pvd::StreamNamespacedName   m_groupMessageName;
+    };
+
+} // namespace Op
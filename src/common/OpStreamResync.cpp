@@ -0,0 +1,193 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpStreamResync.h"
+
+#if OPVD_RESYNC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Op
+{
+    namespace
+    {
+        static constexpr uint8_t cLastEventType = static_cast<uint8_t>( PvdEventType::Last );
+
+        template< typename T >
+        inline T loadField( const uint8_t* data )
+        {
+            T value;
+            std::memcpy( &value, data, sizeof( T ) );
+            return value;
+        }
+
+#if OPVD_RESYNC_SSE2
+        inline std::size_t lowestSetBit( const uint32_t bits )
+        {
+#if defined( _MSC_VER )
+            unsigned long index;
+            _BitScanForward( &index, bits );
+            return index;
+#else
+            return static_cast<std::size_t>( __builtin_ctz( bits ) );
+#endif
+        }
+#endif // OPVD_RESYNC_SSE2
+
+        // the full check of a candidate header at data, which has at least cProbeSize bytes
+        inline bool plausibleHeader( const uint8_t* data, const uint64_t minTimestamp )
+        {
+            const uint32_t dataSize  = loadField< uint32_t >( data );
+            const uint32_t numEvents = loadField< uint32_t >( data + 4 );
+            const uint64_t timestamp = loadField< uint64_t >( data + 16 );
+            const uint8_t  eventType = data[StreamResync::cGroupHeaderSize];
+
+            return dataSize  >= 1 && dataSize  <= StreamResync::cMaxGroupDataSize &&
+                   numEvents >= 1 && numEvents <= StreamResync::cMaxGroupEvents &&
+                   timestamp >= minTimestamp &&
+                   eventTypeValid( static_cast<PvdEventType>( eventType ) );
+        }
+
+        // a plausible header, checked against whatever follows the group it describes when that is in view
+        inline bool plausibleGroupAt( const uint8_t* data, const std::size_t size, const std::size_t offset, const uint64_t minTimestamp, const bool bStreamEnds )
+        {
+            if ( !plausibleHeader( data + offset, minTimestamp ) )
+                return false;
+
+            const uint64_t nextOffset = offset + StreamResync::cGroupHeaderSize + loadField< uint32_t >( data + offset );
+
+            // the group runs past the scanned data; nothing more to check it against
+            if ( nextOffset + StreamResync::cProbeSize > size )
+                return ( !bStreamEnds || nextOffset <= size );
+
+            const uint8_t* next = data + nextOffset;
+            const bool bEndMarker = ( loadField< uint32_t >( next ) == 0 && loadField< uint32_t >( next + 4 ) == 0 );
+
+            return bEndMarker || plausibleHeader( next, loadField< uint64_t >( data + offset + 16 ) );
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void StreamResync::serializeGroup( const pvd::EventGroup& _group, uint8_t* out )
+    {
+        std::memcpy( out,      &_group.mDataSize,  4 );
+        std::memcpy( out + 4,  &_group.mNumEvents, 4 );
+        std::memcpy( out + 8,  &_group.mStreamId,  8 );
+        std::memcpy( out + 16, &_group.mTimestamp, 8 );
+    }
+
+    std::size_t StreamResync::findGroupHeader( const uint8_t* data, const std::size_t size, const uint64_t minTimestamp, const bool bStreamEnds )
+    {
+        if ( size < cProbeSize )
+            return size;
+
+        const std::size_t lastCandidate = size - cProbeSize;
+        std::size_t offset = 0;
+
+#if OPVD_RESYNC_SSE2
+        // per lane: type byte - 1 < Last - 1, top byte of the data size within cMaxGroupDataSize, top two bytes of
+        // the event count zero
+        const __m128i one           = _mm_set1_epi8( 1 );
+        const __m128i maxTypeBias   = _mm_set1_epi8( static_cast<char>( cLastEventType - 2 ) );
+        const __m128i maxSizeTop    = _mm_set1_epi8( static_cast<char>( cMaxGroupDataSize >> 24 ) );
+        const __m128i zero          = _mm_setzero_si128();
+
+        // the widest load is 16 bytes from offset + cGroupHeaderSize
+        while ( offset + cGroupHeaderSize + 16 <= size && offset + 15 <= lastCandidate )
+        {
+            const __m128i typeBytes  = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + offset + cGroupHeaderSize ) );
+            const __m128i sizeTop    = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + offset + 3 ) );
+            const __m128i eventsHi0  = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + offset + 6 ) );
+            const __m128i eventsHi1  = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + offset + 7 ) );
+
+            const __m128i typeBiased = _mm_sub_epi8( typeBytes, one );
+            const __m128i typeOk     = _mm_cmpeq_epi8( _mm_min_epu8( typeBiased, maxTypeBias ), typeBiased );
+            const __m128i sizeOk     = _mm_cmpeq_epi8( _mm_min_epu8( sizeTop, maxSizeTop ), sizeTop );
+            const __m128i eventsOk   = _mm_cmpeq_epi8( _mm_or_si128( eventsHi0, eventsHi1 ), zero );
+
+            uint32_t candidates = static_cast<uint32_t>( _mm_movemask_epi8( _mm_and_si128( typeOk, _mm_and_si128( sizeOk, eventsOk ) ) ) );
+            while ( candidates != 0 )
+            {
+                const std::size_t lane = lowestSetBit( candidates );
+                if ( plausibleGroupAt( data, size, offset + lane, minTimestamp, bStreamEnds ) )
+                    return offset + lane;
+
+                candidates &= candidates - 1;
+            }
+
+            offset += 16;
+        }
+#endif // OPVD_RESYNC_SSE2
+
+        for ( ; offset <= lastCandidate; offset++ )
+        {
+            if ( plausibleGroupAt( data, size, offset, minTimestamp, bStreamEnds ) )
+                return offset;
+        }
+        return size;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool StreamResync::resync( BlockReader& reader, const uint64_t corruptStart, const uint8_t* consumed, const std::size_t consumedSize, const uint64_t minTimestamp )
+    {
+        // the scan window holds the stream from windowStart; the corrupt byte itself can't start the next header
+        m_window.clear();
+        if ( consumedSize > 1 )
+            m_window.assign( consumed + 1, consumed + consumedSize );
+        uint64_t windowStart = reader.position() - m_window.size();
+
+        for ( ;; )
+        {
+            const std::size_t previousSize = m_window.size();
+            m_window.resize( previousSize + cScanChunkSize );
+            const uint32_t bytesRead = reader.read( m_window.data() + previousSize, static_cast<uint32_t>( cScanChunkSize ) );
+            m_window.resize( previousSize + bytesRead );
+
+            const bool bStreamEnds = ( bytesRead < cScanChunkSize );
+
+            const std::size_t found = findGroupHeader( m_window.data(), m_window.size(), minTimestamp, bStreamEnds );
+            if ( found < m_window.size() )
+            {
+                reader.unread( m_window.data() + found, m_window.size() - found );
+                m_skippedRanges.push_back( { corruptStart, windowStart + found } );
+                return true;
+            }
+
+            if ( bStreamEnds )
+            {
+                m_skippedRanges.push_back( { corruptStart, windowStart + m_window.size() } );
+                return false;
+            }
+
+            // a header may start in the last few bytes and carry on into the next chunk
+            const std::size_t keep = std::min( m_window.size(), cProbeSize - 1 );
+            const std::size_t drop = m_window.size() - keep;
+            m_window.erase( m_window.begin(), m_window.begin() + drop );
+            windowStart += drop;
+        }
+    }
+
+    uint64_t StreamResync::skippedBytes() const
+    {
+        uint64_t total = 0;
+        for ( const auto& range : m_skippedRanges )
+            total += range.m_end - range.m_start;
+        return total;
+    }
+
+    void StreamResync::logSummary() const
+    {
+        spdlog::info( "{:>32} = {} ", "resynchronisations", m_skippedRanges.size() );
+        spdlog::info( "{:>32} = {} bytes ", "skipped", skippedBytes() );
+        for ( const auto& range : m_skippedRanges )
+            spdlog::info( "{:>32}   {:#x} .. {:#x} ({} bytes)", "", range.m_start, range.m_end, range.m_end - range.m_start );
+    }
+
+} // namespace Op
@@ -0,0 +1,82 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// recovery from damaged streams; when decoding runs into an unknown event type or an event group header that can't
+// be right, StreamResync scans forward for the next plausible group header and puts the reader back at it, so the
+// rest of the capture can still be read. A header is plausible if its first event type is valid, its size and event
+// count are sane and its timestamp doesn't go backwards from the last good group; where the group it describes ends
+// inside the scanned data, whatever follows it must also be a plausible header (or the end of the stream).
+//
+// The scan filters 16 candidate offsets at a time with SSE2 on a few bytes of each field - the type byte, the top
+// bytes of the size and event count - and only runs the full check on the offsets that survive; there is an
+// equivalent scalar path for platforms without SSE2. Skipped byte ranges are kept for the summary
+//
+
+#pragma once
+
+#if defined( _M_X64 ) || defined( __SSE2__ )
+#define OPVD_RESYNC_SSE2 1
+#endif
+
+#include "common/OpBlockReader.h"
+#include "common/OpEventUnpacker.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class StreamResync
+    {
+    public:
+
+        // serialized EventGroup, then the type byte of its first event
+        static constexpr std::size_t cGroupHeaderSize       = 4 + 4 + 8 + 8;
+        static constexpr std::size_t cProbeSize             = cGroupHeaderSize + 1;
+
+        // generous limits on what a real group holds; trimesh payloads can be large
+        static constexpr uint32_t    cMaxGroupDataSize      = 0x1FFFFFFF;
+        static constexpr uint32_t    cMaxGroupEvents        = 0xFFFF;
+
+        struct SkippedRange
+        {
+            uint64_t    m_start;
+            uint64_t    m_end;
+        };
+
+        // a decoded header that decoding shouldn't trust
+        [[nodiscard]] static inline bool implausibleGroup( const pvd::EventGroup& _group )
+        {
+            return _group.mDataSize > cMaxGroupDataSize ||
+                   _group.mNumEvents > cMaxGroupEvents ||
+                   ( _group.mNumEvents == 0 && _group.mDataSize != 0 );
+        }
+
+        // the wire bytes of a header that has already been decoded, for handing back to resync()
+        static void serializeGroup( const pvd::EventGroup& _group, uint8_t* out );
+
+        // offset of the first plausible group header in data, or size if there isn't one
+        static std::size_t findGroupHeader( const uint8_t* data, const std::size_t size, const uint64_t minTimestamp, const bool bStreamEnds );
+
+        // scans the stream for the next plausible group header, starting one byte past corruptStart. consumed holds
+        // the bytes from corruptStart up to the reader's position, which have already been read; when those are no
+        // longer to hand it can be empty, and the scan starts at the reader's position instead. On success the reader
+        // is left positioned on the header found. Returns false if the stream ended first
+        bool resync( BlockReader& reader, const uint64_t corruptStart, const uint8_t* consumed, const std::size_t consumedSize, const uint64_t minTimestamp );
+
+        [[nodiscard]] inline const std::vector< SkippedRange >& skippedRanges() const { return m_skippedRanges; }
+        [[nodiscard]] uint64_t skippedBytes() const;
+
+        void logSummary() const;
+
+    private:
+
+        static constexpr std::size_t cScanChunkSize = 4 * 1024 * 1024;
+
+        std::vector< uint8_t >          m_window;
+        std::vector< SkippedRange >     m_skippedRanges;
+    };
+
+} // namespace Op
@@ -0,0 +1,110 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpUpdateSuppressor.h"
+#include "OpHash.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    UpdateSuppressor::UpdateSuppressor( const uint32_t capacityLog2 )
+        : m_slots( std::size_t( 1 ) << capacityLog2 )
+        , m_mask( ( uint64_t( 1 ) << capacityLog2 ) - 1 )
+    {
+        m_generations.reserve( 4096 );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void UpdateSuppressor::onCreateInstance( const uint64_t instanceID )
+    {
+        // 0 is reserved for instances we never saw created
+        if ( ++m_nextGeneration == 0 )
+            ++m_nextGeneration;
+
+        m_generations.insert_or_assign( instanceID, m_nextGeneration );
+    }
+
+    void UpdateSuppressor::onDestroyInstance( const uint64_t instanceID )
+    {
+        m_generations.erase( instanceID );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    UpdateSuppressor::Slot& UpdateSuppressor::findSlot( const uint64_t instanceID, const uint32_t generation, const UpdateKind kind, const uint64_t name )
+    {
+        using namespace ankerl::unordered_dense::detail;
+        const uint64_t home = wyhash::mix( wyhash::hash( instanceID ) ^ generation, name ^ ( static_cast<uint64_t>( kind ) << 62 ) ) & m_mask;
+
+        // slots are never emptied, so the whole neighbourhood is searched for the key up to the first empty slot; on
+        // the way, the first slot left behind by a destroyed instance (or an earlier generation of a reused ID) is
+        // remembered as the place to put the key if it isn't there
+        Slot* reclaim = nullptr;
+
+        for ( uint32_t probe = 0; probe < cMaxProbe; probe++ )
+        {
+            Slot& slot = m_slots[( home + probe ) & m_mask];
+
+            if ( !slot.m_occupied )
+            {
+                if ( reclaim == nullptr )
+                    reclaim = &slot;
+                break;
+            }
+
+            if ( slot.m_instance == instanceID &&
+                 slot.m_name == name &&
+                 slot.m_generation == generation &&
+                 slot.m_kind == static_cast<uint16_t>( kind ) )
+            {
+                return slot;
+            }
+
+            if ( reclaim == nullptr && slot.m_generation != generationOf( slot.m_instance ) )
+                reclaim = &slot;
+        }
+
+        // neighbourhood is full of live keys; reuse the home slot, whatever was there will just not be suppressed
+        // next time
+        if ( reclaim == nullptr )
+        {
+            m_evictions++;
+            reclaim = &m_slots[home];
+        }
+
+        Slot& slot = *reclaim;
+        slot.m_instance     = instanceID;
+        slot.m_name         = name;
+        slot.m_generation   = generation;
+        slot.m_kind         = static_cast<uint16_t>( kind );
+        slot.m_occupied     = 1;
+        slot.m_valid        = 0;
+        return slot;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool UpdateSuppressor::isUnchanged( const uint64_t instanceID, const UpdateKind kind, const uint64_t name, const uint8_t* data, const std::size_t size )
+    {
+        const uint64_t payloadHash = hashPayload( data, size, name );
+
+        Slot& slot = findSlot( instanceID, generationOf( instanceID ), kind, name );
+
+        const bool unchanged = ( slot.m_valid && slot.m_payloadHash == payloadHash );
+
+        slot.m_payloadHash = payloadHash;
+        slot.m_valid = 1;
+        return unchanged;
+    }
+
+    void UpdateSuppressor::invalidate( const uint64_t instanceID, const UpdateKind kind, const uint64_t name )
+    {
+        findSlot( instanceID, generationOf( instanceID ), kind, name ).m_valid = 0;
+    }
+
+} // namespace Op
@@ -0,0 +1,79 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// PhysX resends property values every frame whether they changed or not, so scenes that are mostly at rest are
+// mostly redundant updates. UpdateSuppressor remembers a 64-bit hash of the last payload sent for each
+// ( instance, property ) and flags repeats so they can be dropped.
+//
+// The table is open-addressed with a fixed capacity and a short probe limit; when a neighbourhood is full the home
+// slot is simply overwritten, which can only ever cause a repeat to be kept, never a change to be lost. Instances
+// get a fresh generation number each time they are created so recycled instance IDs never match stale entries, and
+// a slot whose generation is no longer live is free to be claimed by a new key
+//
+
+#pragma once
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class UpdateSuppressor
+    {
+    public:
+
+        enum class UpdateKind : uint32_t
+        {
+            Property,
+            Message,
+        };
+
+        static constexpr uint32_t cDefaultCapacityLog2 = 20;         // 1M slots, 32MB
+        static constexpr uint32_t cMaxProbe             = 8;
+
+        explicit UpdateSuppressor( const uint32_t capacityLog2 = cDefaultCapacityLog2 );
+
+        void onCreateInstance( const uint64_t instanceID );
+        void onDestroyInstance( const uint64_t instanceID );
+
+        // returns true if this payload is identical to the last one seen for the key; the new hash is recorded either way
+        bool isUnchanged( const uint64_t instanceID, const UpdateKind kind, const uint64_t name, const uint8_t* data, const std::size_t size );
+
+        // forget the last payload for a key, for updates that arrive in a form we don't compare (eg. multi-part sets)
+        void invalidate( const uint64_t instanceID, const UpdateKind kind, const uint64_t name );
+
+        [[nodiscard]] inline uint64_t evictions() const { return m_evictions; }
+
+    private:
+
+        struct Slot
+        {
+            uint64_t    m_instance      = 0;
+            uint64_t    m_name          = 0;
+            uint64_t    m_payloadHash   = 0;
+            uint32_t    m_generation    = 0;
+            uint16_t    m_kind          = 0;
+            uint8_t     m_occupied      = 0;
+            uint8_t     m_valid         = 0;        // m_payloadHash is meaningful
+        };
+        static_assert( sizeof( Slot ) == 32, "keep Slot at two per cache line" );
+
+        // find the slot for a key, claiming one (possibly by eviction) if it isn't present yet
+        Slot& findSlot( const uint64_t instanceID, const uint32_t generation, const UpdateKind kind, const uint64_t name );
+
+        [[nodiscard]] inline uint32_t generationOf( const uint64_t instanceID ) const
+        {
+            const auto it = m_generations.find( instanceID );
+            return ( it != m_generations.end() ) ? it->second : 0;
+        }
+
+        std::vector< Slot >                                     m_slots;
+        const uint64_t                                          m_mask;
+        ankerl::unordered_dense::map< uint64_t, uint32_t >      m_generations;      // live instances only
+        uint32_t                                                m_nextGeneration    = 0;
+        uint64_t                                                m_evictions         = 0;
+    };
+
+} // namespace Op
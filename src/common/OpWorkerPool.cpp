@@ -0,0 +1,72 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "OpWorkerPool.h"
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    WorkerPool::WorkerPool( uint32_t threadCount )
+    {
+        if ( threadCount == 0 )
+            threadCount = std::max( 2U, std::thread::hardware_concurrency() ) - 1;
+
+        m_threads.reserve( threadCount );
+        for ( uint32_t index = 0; index < threadCount; index++ )
+            m_threads.emplace_back( &WorkerPool::workerThread, this );
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_stopping = true;
+        }
+        m_taskAvailable.notify_all();
+
+        for ( auto& thread : m_threads )
+            thread.join();
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    std::future< void > WorkerPool::submit( std::function< void() > task )
+    {
+        std::packaged_task< void() > packaged( std::move( task ) );
+        std::future< void > result = packaged.get_future();
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_tasks.emplace_back( std::move( packaged ) );
+        }
+        m_taskAvailable.notify_one();
+        return result;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void WorkerPool::workerThread()
+    {
+        for ( ;; )
+        {
+            std::packaged_task< void() > task;
+            {
+                std::unique_lock< std::mutex > lock( m_mutex );
+                m_taskAvailable.wait( lock, [this] { return m_stopping || !m_tasks.empty(); } );
+
+                // drain whatever is queued before stopping, so no future is left dangling
+                if ( m_tasks.empty() )
+                    return;
+
+                task = std::move( m_tasks.front() );
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+} // namespace Op
@@ -0,0 +1,47 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+//
+// a fixed set of worker threads pulling tasks off a shared FIFO; submit() hands back a future so the caller can
+// poll for or wait on a particular task without stalling the rest of the pool
+//
+
+#pragma once
+
+#include <deque>
+#include <future>
+
+namespace Op
+{
+    // ---------------------------------------------------------------------------------------------------------------------
+    class WorkerPool
+    {
+    public:
+
+        // 0 threads picks one per hardware thread, leaving one free for the caller
+        explicit WorkerPool( uint32_t threadCount = 0 );
+        ~WorkerPool();
+
+        WorkerPool( const WorkerPool& ) = delete;
+        WorkerPool& operator=( const WorkerPool& ) = delete;
+
+        std::future< void > submit( std::function< void() > task );
+
+        [[nodiscard]] inline uint32_t threadCount() const { return static_cast<uint32_t>( m_threads.size() ); }
+
+    private:
+
+        void workerThread();
+
+        std::vector< std::thread >                  m_threads;
+
+        std::mutex                                  m_mutex;
+        std::condition_variable                     m_taskAvailable;
+        std::deque< std::packaged_task< void() > >  m_tasks;
+        bool                                        m_stopping = false;
+    };
+
+} // namespace Op
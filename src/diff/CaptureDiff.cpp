@@ -0,0 +1,356 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "diff/CaptureDiff.h"
+
+#include <map>
+#include <set>
+
+#include "common/OpBlockReader.h"
+#include "common/OpEventCursor.h"
+#include "common/OpHash.h"
+#include "common/OpSceneState.h"
+#include "common/OpWorkerPool.h"
+
+namespace
+{
+    using ankerl::unordered_dense::detail::wyhash::mix;
+
+    static constexpr uint64_t cChainSeed = 0x8ebc6af09c88c6e3ull;
+
+    // a replayed capture, plus the creation order of every instance within its class
+    struct Replay
+    {
+        Op::SceneState                                          m_scene;
+        ankerl::unordered_dense::map< uint64_t, uint64_t >      m_classCreates;     // class key -> instances created
+        ankerl::unordered_dense::map< uint64_t, uint64_t >      m_ordinals;         // live instance -> creation ordinal
+        ankerl::unordered_dense::map< uint32_t, uint64_t >      m_nameHashes;       // string handle -> hash of the string
+
+        uint64_t nameHash( const uint32_t handle )
+        {
+            if ( const auto it = m_nameHashes.find( handle ); it != m_nameHashes.end() )
+                return it->second;
+
+            const std::string& name = m_scene.lookupString( handle );
+            const uint64_t hash = Op::hashPayload( reinterpret_cast<const uint8_t*>( name.data() ), name.size() );
+            m_nameHashes.emplace( handle, hash );
+            return hash;
+        }
+
+        // order independent over properties; references are left out, they are never the same from run to run
+        uint64_t instanceHash( const Op::SceneTable& table, const uint32_t slot )
+        {
+            uint64_t propertySum = 0;
+            table.forEachColumn( [&]( const Op::SceneColumn& column )
+            {
+                if ( column.holdsReferences() || !column.written( slot ) )
+                    return;
+
+                uint32_t size = 0;
+                const uint8_t* bytes = column.valueBytes( slot, size );
+                propertySum += mix( nameHash( column.propertyHandle() ), Op::hashPayload( bytes, size ) );
+            } );
+
+            const std::string& className = table.className();
+            return mix( propertySum, Op::hashPayload( reinterpret_cast<const uint8_t*>( className.data() ), className.size() ) );
+        }
+
+        uint64_t frameHash()
+        {
+            uint64_t instanceSum   = 0;
+            uint64_t instanceCount = 0;
+            m_scene.forEachTable( [&]( const Op::SceneTable& table )
+            {
+                table.forEachLive( [&]( const uint32_t slot, const uint64_t )
+                {
+                    instanceSum += instanceHash( table, slot );
+                    instanceCount++;
+                } );
+            } );
+            return mix( instanceSum, instanceCount );
+        }
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // replay a capture, calling onFrameEnd( frame, replay ) as each frame completes until it returns false
+    template< typename TFunc >
+    bool replayCapture( const std::string& pxdFile, TFunc&& onFrameEnd )
+    {
+        auto source = Op::FileBlockSource::open( pxdFile );
+        if ( !source )
+        {
+            spdlog::error( "unable to open [{}]", pxdFile );
+            return false;
+        }
+
+        Op::BlockReader reader( std::move( source ) );
+        Op::EventCursor< Op::BlockReader > cursor( reader );
+
+        physx::pvdsdk::StreamInitialization init;
+        if ( !cursor.readInitialization( init ) )
+            return false;
+
+        Replay replay;
+        uint64_t frame = 0;
+
+        Op::EventView view;
+        while ( cursor.next( view ) )
+        {
+            if ( const auto* create = view.as< physx::pvdsdk::CreateInstance >() )
+            {
+                const uint64_t classKey = ( static_cast<uint64_t>( create->mClass.mNamespace ) << 32 ) | create->mClass.mName;
+                replay.m_ordinals.insert_or_assign( create->mInstanceId, replay.m_classCreates[classKey]++ );
+            }
+            else if ( const auto* destroy = view.as< physx::pvdsdk::DestroyInstance >() )
+            {
+                replay.m_ordinals.erase( destroy->mInstanceId );
+            }
+
+            std::visit( [&]( const auto& _event ) { replay.m_scene.apply( _event ); }, view.m_event );
+
+            if ( replay.m_scene.currentFrame() != frame )
+            {
+                if ( frame > 0 && !onFrameEnd( frame, replay ) )
+                    return true;
+                frame = replay.m_scene.currentFrame();
+            }
+        }
+
+        if ( frame > 0 )
+            onFrameEnd( frame, replay );
+
+        if ( cursor.failed() )
+            spdlog::warn( "[{}] could not be fully decoded, compared up to frame {}", pxdFile, frame );
+        return true;
+    }
+
+    // chain[n] covers frames 1 .. n+1
+    bool hashFrames( const std::string& pxdFile, std::vector< uint64_t >& chain )
+    {
+        uint64_t running = cChainSeed;
+        return replayCapture( pxdFile, [&]( const uint64_t, Replay& replay )
+        {
+            running = mix( running, replay.frameHash() );
+            chain.push_back( running );
+            return true;
+        } );
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    struct InstanceSnapshot
+    {
+        uint64_t                                                    m_instanceID;
+        uint64_t                                                    m_hash;
+        std::map< std::string, std::vector< uint8_t > >             m_properties;
+    };
+
+    // class name -> creation ordinal -> instance, ordered so the report reads the same every time
+    using SceneSnapshot = std::map< std::string, std::map< uint64_t, InstanceSnapshot > >;
+
+    // false if the capture couldn't be read as far as targetFrame
+    bool snapshotFrame( const std::string& pxdFile, const uint64_t targetFrame, SceneSnapshot& snapshot )
+    {
+        bool bReached = false;
+        const bool bReplayed = replayCapture( pxdFile, [&]( const uint64_t frame, Replay& replay )
+        {
+            if ( frame < targetFrame )
+                return true;
+
+            bReached = true;
+
+            replay.m_scene.forEachTable( [&]( const Op::SceneTable& table )
+            {
+                auto& instances = snapshot[table.className()];
+                table.forEachLive( [&]( const uint32_t slot, const uint64_t instanceID )
+                {
+                    InstanceSnapshot& instance = instances[replay.m_ordinals[instanceID]];
+                    instance.m_instanceID = instanceID;
+                    instance.m_hash       = replay.instanceHash( table, slot );
+
+                    table.forEachColumn( [&]( const Op::SceneColumn& column )
+                    {
+                        if ( column.holdsReferences() || !column.written( slot ) )
+                            return;
+
+                        uint32_t size = 0;
+                        const uint8_t* bytes = column.valueBytes( slot, size );
+                        instance.m_properties[replay.m_scene.lookupString( column.propertyHandle() )].assign( bytes, bytes + size );
+                    } );
+                } );
+            } );
+            return false;
+        } );
+
+        if ( bReplayed && !bReached )
+            spdlog::error( "[{}] ended before frame {}, the second read found fewer frames than the first", pxdFile, targetFrame );
+        return bReplayed && bReached;
+    }
+
+    // most properties are made of floats, so show them that way when the size allows
+    std::string formatValue( const std::vector< uint8_t >* value )
+    {
+        if ( value == nullptr )
+            return "<unset>";
+
+        std::string text;
+        if ( !value->empty() && value->size() % sizeof( float ) == 0 && value->size() <= 16 * sizeof( float ) )
+        {
+            for ( std::size_t offset = 0; offset < value->size(); offset += sizeof( float ) )
+            {
+                float component;
+                std::memcpy( &component, value->data() + offset, sizeof( float ) );
+                text += fmt::format( "{}{}", text.empty() ? "" : ", ", component );
+            }
+            return text;
+        }
+
+        for ( std::size_t idx = 0; idx < value->size() && idx < 32; idx++ )
+            text += fmt::format( "{:02x}", ( *value )[idx] );
+        if ( value->size() > 32 )
+            text += fmt::format( "... ({} bytes)", value->size() );
+        return text;
+    }
+
+    void reportDifferences( const SceneSnapshot& snapshotA, const SceneSnapshot& snapshotB, const uint32_t maxReportedInstances )
+    {
+        static const std::map< uint64_t, InstanceSnapshot > noInstances;
+
+        std::set< std::string > classNames;
+        for ( const auto& cls : snapshotA ) classNames.insert( cls.first );
+        for ( const auto& cls : snapshotB ) classNames.insert( cls.first );
+
+        uint32_t reported = 0;
+        for ( const std::string& className : classNames )
+        {
+            const auto itA = snapshotA.find( className );
+            const auto itB = snapshotB.find( className );
+            const auto& instancesA = ( itA != snapshotA.end() ) ? itA->second : noInstances;
+            const auto& instancesB = ( itB != snapshotB.end() ) ? itB->second : noInstances;
+
+            std::set< uint64_t > ordinals;
+            for ( const auto& instance : instancesA ) ordinals.insert( instance.first );
+            for ( const auto& instance : instancesB ) ordinals.insert( instance.first );
+
+            for ( const uint64_t ordinal : ordinals )
+            {
+                const auto instanceA = instancesA.find( ordinal );
+                const auto instanceB = instancesB.find( ordinal );
+                const bool bInA = ( instanceA != instancesA.end() );
+                const bool bInB = ( instanceB != instancesB.end() );
+
+                if ( bInA && bInB && instanceA->second.m_hash == instanceB->second.m_hash )
+                    continue;
+
+                if ( reported++ == maxReportedInstances )
+                {
+                    spdlog::info( "... more differences not shown" );
+                    return;
+                }
+
+                if ( !bInB )
+                {
+                    spdlog::info( "[{}] #{} ({:#x}) only exists in A", className, ordinal, instanceA->second.m_instanceID );
+                    continue;
+                }
+                if ( !bInA )
+                {
+                    spdlog::info( "[{}] #{} ({:#x}) only exists in B", className, ordinal, instanceB->second.m_instanceID );
+                    continue;
+                }
+
+                spdlog::info( "[{}] #{} ({:#x} / {:#x})", className, ordinal, instanceA->second.m_instanceID, instanceB->second.m_instanceID );
+
+                std::set< std::string > propertyNames;
+                for ( const auto& property : instanceA->second.m_properties ) propertyNames.insert( property.first );
+                for ( const auto& property : instanceB->second.m_properties ) propertyNames.insert( property.first );
+
+                for ( const std::string& propertyName : propertyNames )
+                {
+                    const auto propertyA = instanceA->second.m_properties.find( propertyName );
+                    const auto propertyB = instanceB->second.m_properties.find( propertyName );
+                    const auto* valueA = ( propertyA != instanceA->second.m_properties.end() ) ? &propertyA->second : nullptr;
+                    const auto* valueB = ( propertyB != instanceB->second.m_properties.end() ) ? &propertyB->second : nullptr;
+
+                    if ( valueA != nullptr && valueB != nullptr && *valueA == *valueB )
+                        continue;
+
+                    spdlog::info( "    {:>24} A = {}", propertyName, formatValue( valueA ) );
+                    spdlog::info( "    {:>24} B = {}", "", formatValue( valueB ) );
+                }
+            }
+        }
+    }
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------------------------------------------------
+int runCaptureDiff( const std::string& pxdFileA, const std::string& pxdFileB, const uint32_t maxReportedInstances )
+{
+    Op::WorkerPool workers( 2 );
+
+    std::vector< uint64_t > chainA, chainB;
+    bool bHashedA = false, bHashedB = false;
+    {
+        auto hashingA = workers.submit( [&]() { bHashedA = hashFrames( pxdFileA, chainA ); } );
+        auto hashingB = workers.submit( [&]() { bHashedB = hashFrames( pxdFileB, chainB ); } );
+        hashingA.get();
+        hashingB.get();
+    }
+    if ( !bHashedA || !bHashedB )
+        return 1;
+
+    spdlog::info( "A : {} frames, B : {} frames", chainA.size(), chainB.size() );
+
+    const std::size_t commonFrames = std::min( chainA.size(), chainB.size() );
+
+    // chained hashes stay equal up to the first divergence and (barring collisions) differ from then on
+    std::size_t lo = 0, hi = commonFrames;
+    while ( lo < hi )
+    {
+        const std::size_t mid = lo + ( hi - lo ) / 2;
+        if ( chainA[mid] == chainB[mid] )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if ( lo == commonFrames )
+    {
+        if ( chainA.size() == chainB.size() )
+        {
+            spdlog::info( "captures match across all {} frames", commonFrames );
+            return 0;
+        }
+        spdlog::info( "captures match across the {} frames they share, {} is longer", commonFrames, ( chainA.size() > chainB.size() ) ? "A" : "B" );
+        return 2;
+    }
+
+    const uint64_t divergentFrame = lo + 1;
+    spdlog::info( "first divergent frame : {}", divergentFrame );
+
+    SceneSnapshot snapshotA, snapshotB;
+    bool bSnapshotA = false, bSnapshotB = false;
+    {
+        auto snapshottingA = workers.submit( [&]() { bSnapshotA = snapshotFrame( pxdFileA, divergentFrame, snapshotA ); } );
+        auto snapshottingB = workers.submit( [&]() { bSnapshotB = snapshotFrame( pxdFileB, divergentFrame, snapshotB ); } );
+        snapshottingA.get();
+        snapshottingB.get();
+    }
+
+    // a capture that changed (or couldn't be reopened) between passes leaves nothing sound to compare
+    if ( !bSnapshotA || !bSnapshotB )
+    {
+        spdlog::error( "unable to rebuild frame {} of both captures to report the differences", divergentFrame );
+        return 1;
+    }
+
+    reportDifferences( snapshotA, snapshotB, maxReportedInstances );
+    return 2;
+}
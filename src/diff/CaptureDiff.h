@@ -0,0 +1,21 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// determinism checking between two captures of the same simulation. Each capture is replayed through Op::SceneState
+// on its own thread, hashing the scene at the end of every frame in a canonical way - per instance, the class name
+// and every property name / value pair is hashed, skipping object references and pointers (which are allocation
+// addresses and so differ between runs); those instance hashes are summed, so the result doesn't depend on the order
+// instances were created or properties were sent. Frame hashes are chained, which makes "everything up to frame N
+// matches" monotonic, and the first divergent frame is found by binary search over the two chains.
+//
+// Both captures are then replayed up to that frame to report what differs; instances are paired across the
+// captures by class and creation order, since their IDs can't be compared
+//
+
+#pragma once
+
+int runCaptureDiff( const std::string& pxdFileA, const std::string& pxdFileB, const uint32_t maxReportedInstances );
@@ -0,0 +1,222 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "filter/DecodeBenchmark.h"
+
+#include "common/OpBlockReader.h"
+#include "common/OpEventDecoder.h"
+
+namespace
+{
+    using EventHistogram = std::array< uint64_t, static_cast<std::size_t>( Op::PvdEventType::Last ) >;
+
+    struct DecodeResult
+    {
+        EventHistogram  m_histogram{};
+        uint64_t        m_events = 0;
+        uint64_t        m_payloadBytes = 0;
+        double          m_seconds = 0;
+        bool            m_valid = true;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // the original path, every field going through a virtual streamify() call and its own file read
+    struct SerializerPath
+    {
+        physx::PsFileBuffer                         m_file;
+        Op::EventUnpacker< physx::PsFileBuffer >    m_unpacker;
+
+        SerializerPath( const std::string& pxdFile )
+            : m_file( pxdFile.c_str(), physx::general_PxIOStream2::PxFileBuf::OPEN_READ_ONLY )
+            , m_unpacker( m_file )
+        {}
+
+        template< typename TEvent >
+        inline void decode( TEvent& ev )        { ev.serialize( m_unpacker ); }
+        inline void decode( Op::PvdEventType& ev ) { m_unpacker.read( ev ); }
+        inline void releaseEventData()          { m_unpacker.releaseEventData(); }
+    };
+
+    // compile-time specialised layouts
+    struct DecoderPath
+    {
+        physx::PsFileBuffer                         m_file;
+        Op::EventDecoder< physx::PsFileBuffer >     m_decoder;
+
+        DecoderPath( const std::string& pxdFile )
+            : m_file( pxdFile.c_str(), physx::general_PxIOStream2::PxFileBuf::OPEN_READ_ONLY )
+            , m_decoder( m_file )
+        {}
+
+        template< typename TEvent >
+        inline void decode( TEvent& ev )        { m_decoder.decode( ev ); }
+        inline void releaseEventData()          { m_decoder.releaseEventData(); }
+    };
+
+    // compile-time specialised layouts, reading from memory blocks filled on a read-ahead thread
+    struct BlockDecoderPath
+    {
+        Op::BlockReader                             m_reader;
+        Op::EventDecoder< Op::BlockReader >         m_decoder;
+
+        BlockDecoderPath( const std::string& pxdFile )
+            : m_reader( Op::FileBlockSource::open( pxdFile ) )
+            , m_decoder( m_reader )
+        {}
+
+        template< typename TEvent >
+        inline void decode( TEvent& ev )        { m_decoder.decode( ev ); }
+        inline void releaseEventData()          { m_decoder.releaseEventData(); }
+    };
+
+    template< typename TEvent >
+    inline uint64_t payloadSize( const TEvent& )                                    { return 0; }
+    inline uint64_t payloadSize( const pvd::SetPropertyValue& ev )                  { return ev.mData.size(); }
+    inline uint64_t payloadSize( const pvd::AppendPropertyValueData& ev )           { return ev.mData.size(); }
+    inline uint64_t payloadSize( const pvd::SetPropertyMessage& ev )                { return ev.mData.size(); }
+    inline uint64_t payloadSize( const pvd::SendPropertyMessageFromGroup& ev )      { return ev.mData.size(); }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    template< typename TPath >
+    DecodeResult decodeCapture( const std::string& pxdFile )
+    {
+        DecodeResult result;
+
+        const auto timeStart = std::chrono::high_resolution_clock::now();
+
+        TPath path( pxdFile );
+
+        pvd::StreamInitialization init;
+        path.decode( init );
+
+        for ( ;; )
+        {
+            pvd::EventGroup eg;
+            path.decode( eg );
+
+            if ( eg.mNumEvents == 0 )
+                break;
+
+            for ( auto eventIndex = 0U; eventIndex < eg.mNumEvents; eventIndex++ )
+            {
+                Op::PvdEventType eventType;
+                path.decode( eventType );
+
+                switch ( eventType )
+                {
+#define DECLARE_PVD_COMM_STREAM_EVENT(x)            case Op::PvdEventType::x: {             \
+                    pvd::x _ev;                                                             \
+                    path.decode( _ev );                                                     \
+                    result.m_payloadBytes += payloadSize( _ev );                            \
+                } break;
+#define DECLARE_PVD_COMM_STREAM_EVENT_NO_COMMA(x)   DECLARE_PVD_COMM_STREAM_EVENT(x)
+                    DECLARE_COMM_STREAM_EVENTS
+#undef DECLARE_PVD_COMM_STREAM_EVENT_NO_COMMA
+#undef DECLARE_PVD_COMM_STREAM_EVENT
+
+                default:
+                    spdlog::error( "Unhandled Event : {}", (int32_t)eventType );
+                    result.m_valid = false;
+                    break;
+                }
+
+                if ( !result.m_valid )
+                    break;
+
+                result.m_histogram[static_cast<std::size_t>( eventType )]++;
+                result.m_events++;
+
+                path.releaseEventData();
+            }
+
+            if ( !result.m_valid )
+                break;
+        }
+
+        const auto timeEnd = std::chrono::high_resolution_clock::now();
+        result.m_seconds = std::chrono::duration< double >( timeEnd - timeStart ).count();
+
+        return result;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void logResult( const char* title, const DecodeResult& result )
+    {
+        const double eventsPerSec = ( result.m_seconds > 0 ) ? ( double( result.m_events ) / result.m_seconds ) : 0;
+
+        spdlog::info( "{:>32} = {:>10} events in {:.3f}s = {:>12.0f} events/sec", title, result.m_events, result.m_seconds, eventsPerSec );
+    }
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------------------------------------------------
+int runDecodeBenchmark( const std::string& pxdFile, const uint32_t rounds )
+{
+    spdlog::info( "Decode benchmark : {} ({} rounds)", pxdFile, rounds );
+
+    // alternate the paths so none of them gets an unfair share of a warm file cache; keep the best time of each
+    DecodeResult bestSerializer, bestDecoder, bestBlockDecoder;
+    bestSerializer.m_seconds = bestDecoder.m_seconds = bestBlockDecoder.m_seconds = std::numeric_limits<double>::max();
+
+    for ( uint32_t round = 0; round < std::max( rounds, 1U ); round++ )
+    {
+        const auto serializerResult = decodeCapture< SerializerPath >( pxdFile );
+        const auto decoderResult    = decodeCapture< DecoderPath >( pxdFile );
+        const auto blockResult      = decodeCapture< BlockDecoderPath >( pxdFile );
+
+        if ( !serializerResult.m_valid || !decoderResult.m_valid || !blockResult.m_valid )
+        {
+            spdlog::error( "capture could not be fully decoded" );
+            return 1;
+        }
+
+        // both paths must see exactly the same sequence of events; if they don't, a compile-time layout is wrong
+        if ( serializerResult.m_histogram != decoderResult.m_histogram ||
+             serializerResult.m_payloadBytes != decoderResult.m_payloadBytes )
+        {
+            spdlog::error( "EventDecoder disagrees with the PvdEventSerializer path" );
+            for ( std::size_t idx = 1; idx < serializerResult.m_histogram.size(); idx++ )
+            {
+                if ( serializerResult.m_histogram[idx] != decoderResult.m_histogram[idx] )
+                {
+                    spdlog::error( "{:>32} : {} vs {}",
+                        Op::eventTypeToString( static_cast<Op::PvdEventType>( idx ) ),
+                        serializerResult.m_histogram[idx],
+                        decoderResult.m_histogram[idx] );
+                }
+            }
+            return 1;
+        }
+        if ( blockResult.m_histogram != decoderResult.m_histogram ||
+             blockResult.m_payloadBytes != decoderResult.m_payloadBytes )
+        {
+            spdlog::error( "BlockReader input disagrees with PsFileBuffer input" );
+            return 1;
+        }
+
+        if ( serializerResult.m_seconds < bestSerializer.m_seconds )
+            bestSerializer = serializerResult;
+        if ( decoderResult.m_seconds < bestDecoder.m_seconds )
+            bestDecoder = decoderResult;
+        if ( blockResult.m_seconds < bestBlockDecoder.m_seconds )
+            bestBlockDecoder = blockResult;
+    }
+
+    logResult( "PvdEventSerializer", bestSerializer );
+    logResult( "EventDecoder", bestDecoder );
+    logResult( "EventDecoder + BlockReader", bestBlockDecoder );
+
+    if ( bestDecoder.m_seconds > 0 )
+        spdlog::info( "{:>32} = {:.2f}x", "decoder speedup", bestSerializer.m_seconds / bestDecoder.m_seconds );
+    if ( bestBlockDecoder.m_seconds > 0 )
+        spdlog::info( "{:>32} = {:.2f}x", "decoder + block speedup", bestSerializer.m_seconds / bestBlockDecoder.m_seconds );
+
+    return 0;
+}
@@ -0,0 +1,15 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// decodes a capture end-to-end through both the PvdEventSerializer-driven EventUnpacker and the compile-time
+// EventDecoder (reading through PsFileBuffer and through BlockReader), reporting events/sec for each and checking
+// that all of them agree on what they read
+//
+
+#pragma once
+
+int runDecodeBenchmark( const std::string& pxdFile, const uint32_t rounds );
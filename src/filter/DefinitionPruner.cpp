@@ -0,0 +1,459 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "filter/DefinitionPruner.h"
+
+#include "common/OpBlockReader.h"
+#include "common/OpEventCursor.h"
+#include "common/OpEventWriter.h"
+
+#include "PxPvdDefaultFileTransport.h"
+
+namespace
+{
+    using HandleSet = ankerl::unordered_dense::set< uint32_t >;
+    using ClassSet  = ankerl::unordered_dense::set< uint64_t >;
+
+    inline uint64_t classKey( const pvd::StreamNamespacedName& name )
+    {
+        return ( static_cast<uint64_t>( name.mNamespace ) << 32 ) | name.mName;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // every string handle an event refers to, handed to fn as a mutable reference so the same walk can be used to
+    // remap them; array entries live in the decoder's arena, which is writable memory behind the const DataRef
+    template< typename TFunc >
+    inline void forEachHandle( pvd::StreamNamespacedName& name, TFunc&& fn )
+    {
+        fn( name.mNamespace );
+        fn( name.mName );
+    }
+
+    template< typename TFunc > inline void forEachHandle( pvd::StringHandleEvent& ev, TFunc&& fn )             { fn( ev.mHandle ); }
+    template< typename TFunc > inline void forEachHandle( pvd::CreateClass& ev, TFunc&& fn )                   { forEachHandle( ev.mName, fn ); }
+    template< typename TFunc > inline void forEachHandle( pvd::DeriveClass& ev, TFunc&& fn )                   { forEachHandle( ev.mParent, fn ); forEachHandle( ev.mChild, fn ); }
+    template< typename TFunc > inline void forEachHandle( pvd::CreateInstance& ev, TFunc&& fn )                { forEachHandle( ev.mClass, fn ); }
+    template< typename TFunc > inline void forEachHandle( pvd::SetPropertyValue& ev, TFunc&& fn )              { fn( ev.mPropertyName ); forEachHandle( ev.mIncomingTypeName, fn ); }
+    template< typename TFunc > inline void forEachHandle( pvd::BeginSetPropertyValue& ev, TFunc&& fn )         { fn( ev.mPropertyName ); forEachHandle( ev.mIncomingTypeName, fn ); }
+    template< typename TFunc > inline void forEachHandle( pvd::SetPropertyMessage& ev, TFunc&& fn )            { forEachHandle( ev.mMessageName, fn ); }
+    template< typename TFunc > inline void forEachHandle( pvd::BeginPropertyMessageGroup& ev, TFunc&& fn )     { forEachHandle( ev.mMsgName, fn ); }
+    template< typename TFunc > inline void forEachHandle( pvd::PushBackObjectRef& ev, TFunc&& fn )             { fn( ev.mProperty ); }
+    template< typename TFunc > inline void forEachHandle( pvd::RemoveObjectRef& ev, TFunc&& fn )               { fn( ev.mProperty ); }
+    template< typename TFunc > inline void forEachHandle( pvd::BeginSection& ev, TFunc&& fn )                  { fn( ev.mName ); }
+    template< typename TFunc > inline void forEachHandle( pvd::EndSection& ev, TFunc&& fn )                    { fn( ev.mName ); }
+
+    template< typename TFunc >
+    inline void forEachHandle( pvd::CreateProperty& ev, TFunc&& fn )
+    {
+        forEachHandle( ev.mClass, fn );
+        fn( ev.mName );
+        fn( ev.mSemantic );
+        forEachHandle( ev.mDatatypeName, fn );
+
+        auto* values = const_cast<pvd::NameHandleValue*>( ev.mValues.begin() );
+        for ( uint32_t idx = 0; idx < ev.mValues.size(); ++idx )
+            fn( values[idx].mName );
+    }
+
+    template< typename TFunc >
+    inline void forEachHandle( pvd::CreatePropertyMessage& ev, TFunc&& fn )
+    {
+        forEachHandle( ev.mClass, fn );
+        forEachHandle( ev.mMessageName, fn );
+
+        auto* entries = const_cast<pvd::StreamPropMessageArg*>( ev.mMessageEntries.begin() );
+        for ( uint32_t idx = 0; idx < ev.mMessageEntries.size(); ++idx )
+        {
+            fn( entries[idx].mPropertyName );
+            forEachHandle( entries[idx].mDatatypeName, fn );
+        }
+    }
+
+    // everything else carries its strings inline
+    template< typename TEvent, typename TFunc >
+    inline void forEachHandle( TEvent&, TFunc&& )
+    {
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // String values travel as string handles inside property payloads - whole String-typed SetPropertyValue /
+    // AppendPropertyValueData arrays, and the String fields of property messages. Which payloads those are depends
+    // on datatypes declared earlier in the stream, so this has to see every event in order; visit() tracks the
+    // declarations and hands any handles in a payload to fn, written back afterwards so fn can remap them
+    class PayloadHandles
+    {
+    public:
+
+        template< typename TEvent, typename TFunc >
+        void visit( TEvent& ev, TFunc&& fn )
+        {
+            if constexpr ( std::is_same_v< TEvent, pvd::StringHandleEvent > )
+            {
+                if ( std::strcmp( ev.mString, "String" ) == 0 || std::strcmp( ev.mString, "StringHandle" ) == 0 )
+                    m_stringTypes.emplace( ev.mHandle );
+            }
+            else if constexpr ( std::is_same_v< TEvent, pvd::CreatePropertyMessage > )
+            {
+                std::vector< uint32_t > offsets;
+                for ( uint32_t idx = 0; idx < ev.mMessageEntries.size(); ++idx )
+                {
+                    const auto& entry = ev.mMessageEntries[idx];
+                    if ( m_stringTypes.contains( entry.mDatatypeName.mName ) )
+                        offsets.push_back( entry.mMessageOffset );
+                }
+
+                if ( offsets.empty() )
+                    m_messageStringOffsets.erase( classKey( ev.mMessageName ) );
+                else
+                    m_messageStringOffsets.insert_or_assign( classKey( ev.mMessageName ), std::move( offsets ) );
+            }
+            else if constexpr ( std::is_same_v< TEvent, pvd::BeginPropertyMessageGroup > )
+            {
+                m_groupMessage = classKey( ev.mMsgName );
+            }
+            else if constexpr ( std::is_same_v< TEvent, pvd::SetPropertyValue > )
+            {
+                if ( m_stringTypes.contains( ev.mIncomingTypeName.mName ) )
+                    forEachItem( ev.mData, ev.mNumItems, fn );
+            }
+            else if constexpr ( std::is_same_v< TEvent, pvd::BeginSetPropertyValue > )
+            {
+                m_stringSequence = m_stringTypes.contains( ev.mIncomingTypeName.mName );
+            }
+            else if constexpr ( std::is_same_v< TEvent, pvd::AppendPropertyValueData > )
+            {
+                if ( m_stringSequence )
+                    forEachItem( ev.mData, ev.mNumItems, fn );
+            }
+            else if constexpr ( std::is_same_v< TEvent, pvd::EndSetPropertyValue > )
+            {
+                m_stringSequence = false;
+            }
+            else if constexpr ( std::is_same_v< TEvent, pvd::SetPropertyMessage > )
+            {
+                forEachField( classKey( ev.mMessageName ), ev.mData, fn );
+            }
+            else if constexpr ( std::is_same_v< TEvent, pvd::SendPropertyMessageFromGroup > )
+            {
+                forEachField( m_groupMessage, ev.mData, fn );
+            }
+        }
+
+    private:
+
+        template< typename TFunc >
+        static inline void forHandleAt( const pvd::DataRef<const uint8_t>& data, const uint32_t offset, TFunc&& fn )
+        {
+            if ( offset + sizeof( uint32_t ) > data.size() )
+                return;
+
+            // decoded payloads live in the decoder's arena, writable behind the const DataRef
+            uint8_t* bytes = const_cast<uint8_t*>( data.begin() ) + offset;
+
+            uint32_t handle;
+            std::memcpy( &handle, bytes, sizeof( uint32_t ) );
+            fn( handle );
+            std::memcpy( bytes, &handle, sizeof( uint32_t ) );
+        }
+
+        // each item holds a handle in its first four bytes, whether it's a StringHandle or a pointer-sized slot
+        template< typename TFunc >
+        static inline void forEachItem( const pvd::DataRef<const uint8_t>& data, const uint32_t numItems, TFunc&& fn )
+        {
+            const uint32_t stride = ( numItems > 0 ) ? std::max< uint32_t >( data.size() / numItems, sizeof( uint32_t ) ) : sizeof( uint32_t );
+            for ( uint32_t offset = 0; offset < data.size(); offset += stride )
+                forHandleAt( data, offset, fn );
+        }
+
+        template< typename TFunc >
+        inline void forEachField( const uint64_t message, const pvd::DataRef<const uint8_t>& data, TFunc&& fn ) const
+        {
+            if ( const auto it = m_messageStringOffsets.find( message ); it != m_messageStringOffsets.end() )
+            {
+                for ( const uint32_t offset : it->second )
+                    forHandleAt( data, offset, fn );
+            }
+        }
+
+        HandleSet                                                           m_stringTypes;
+        ankerl::unordered_dense::map< uint64_t, std::vector< uint32_t > >   m_messageStringOffsets;
+        uint64_t                                                            m_groupMessage      = 0;
+        bool                                                                m_stringSequence    = false;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    struct ClassInfo
+    {
+        std::vector< uint64_t > m_dependencies;     // base classes, and the datatypes of its properties
+        std::vector< uint32_t > m_handles;          // referenced by the definitions that describe it
+    };
+
+    struct DefinitionUsage
+    {
+        ankerl::unordered_dense::map< uint64_t, ClassInfo > m_classes;
+        ClassSet                    m_usedClasses;
+        HandleSet                   m_usedHandles;
+        std::vector< uint32_t >     m_declaredHandles;  // in stream order
+
+        uint64_t                    m_totalStrings      = 0;
+        uint64_t                    m_totalDefinitions  = 0;
+
+        template< typename TEvent >
+        inline void addClassHandles( const uint64_t owner, TEvent& ev )
+        {
+            auto& handles = m_classes[owner].m_handles;
+            forEachHandle( ev, [&]( auto& handle ) { handles.push_back( handle ); } );
+        }
+
+        template< typename TEvent >
+        inline void addUsedHandles( TEvent& ev )
+        {
+            forEachHandle( ev, [&]( auto& handle ) { m_usedHandles.emplace( handle ); } );
+        }
+
+        // pull in base classes and datatypes, then every handle the surviving definitions need
+        void close()
+        {
+            std::vector< uint64_t > pending( m_usedClasses.begin(), m_usedClasses.end() );
+            while ( !pending.empty() )
+            {
+                const uint64_t current = pending.back();
+                pending.pop_back();
+
+                const auto it = m_classes.find( current );
+                if ( it == m_classes.end() )
+                    continue;
+
+                for ( const uint64_t dependency : it->second.m_dependencies )
+                {
+                    if ( m_usedClasses.emplace( dependency ).second )
+                        pending.push_back( dependency );
+                }
+            }
+
+            for ( const uint64_t used : m_usedClasses )
+            {
+                if ( const auto it = m_classes.find( used ); it != m_classes.end() )
+                    m_usedHandles.insert( it->second.m_handles.begin(), it->second.m_handles.end() );
+            }
+        }
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    bool scanUsage( const std::string& inputFile, DefinitionUsage& usage )
+    {
+        auto source = Op::FileBlockSource::open( inputFile );
+        if ( !source )
+            return false;
+
+        Op::BlockReader reader( std::move( source ) );
+        Op::EventCursor< Op::BlockReader > cursor( reader );
+
+        pvd::StreamInitialization init;
+        if ( !cursor.readInitialization( init ) )
+            return false;
+
+        PayloadHandles payloadHandles;
+
+        Op::EventView view;
+        while ( cursor.next( view ) )
+        {
+            std::visit( [&]( auto& ev )
+            {
+                using TEvent = std::decay_t< decltype( ev ) >;
+
+                payloadHandles.visit( ev, [&]( auto& handle ) { usage.m_usedHandles.emplace( handle ); } );
+
+                if constexpr ( std::is_same_v< TEvent, pvd::StringHandleEvent > )
+                {
+                    usage.m_declaredHandles.push_back( ev.mHandle );
+                    usage.m_totalStrings++;
+                }
+                else if constexpr ( std::is_same_v< TEvent, pvd::CreateClass > )
+                {
+                    usage.addClassHandles( classKey( ev.mName ), ev );
+                    usage.m_totalDefinitions++;
+                }
+                else if constexpr ( std::is_same_v< TEvent, pvd::DeriveClass > )
+                {
+                    usage.m_classes[classKey( ev.mChild )].m_dependencies.push_back( classKey( ev.mParent ) );
+                    usage.addClassHandles( classKey( ev.mChild ), ev );
+                    usage.m_totalDefinitions++;
+                }
+                else if constexpr ( std::is_same_v< TEvent, pvd::CreateProperty > )
+                {
+                    usage.m_classes[classKey( ev.mClass )].m_dependencies.push_back( classKey( ev.mDatatypeName ) );
+                    usage.addClassHandles( classKey( ev.mClass ), ev );
+                    usage.m_totalDefinitions++;
+                }
+                else if constexpr ( std::is_same_v< TEvent, pvd::CreatePropertyMessage > )
+                {
+                    auto& owner = usage.m_classes[classKey( ev.mClass )];
+                    for ( uint32_t idx = 0; idx < ev.mMessageEntries.size(); ++idx )
+                        owner.m_dependencies.push_back( classKey( ev.mMessageEntries[idx].mDatatypeName ) );
+
+                    usage.addClassHandles( classKey( ev.mClass ), ev );
+                    usage.m_totalDefinitions++;
+                }
+                else if constexpr ( std::is_same_v< TEvent, pvd::CreateInstance > )
+                {
+                    usage.m_usedClasses.emplace( classKey( ev.mClass ) );
+                    usage.addUsedHandles( ev );
+                }
+                else if constexpr ( std::is_same_v< TEvent, pvd::SetPropertyValue > || std::is_same_v< TEvent, pvd::BeginSetPropertyValue > )
+                {
+                    usage.m_usedClasses.emplace( classKey( ev.mIncomingTypeName ) );
+                    usage.addUsedHandles( ev );
+                }
+                else if constexpr ( !std::is_same_v< TEvent, std::monostate > )
+                {
+                    usage.addUsedHandles( ev );
+                }
+            }, view.m_event );
+        }
+
+        if ( cursor.failed() )
+            return false;
+
+        usage.close();
+        return true;
+    }
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool pruneDefinitions( const std::string& inputFile, const std::string& outputFile, const bool denseHandles )
+{
+    DefinitionUsage usage;
+    if ( !scanUsage( inputFile, usage ) )
+    {
+        spdlog::error( "unable to scan [{}] for definitions in use", inputFile );
+        return false;
+    }
+
+    // dense numbering follows declaration order, so every handle is still declared before it's used; anything used
+    // without ever being declared is numbered after those
+    ankerl::unordered_dense::map< uint32_t, uint32_t > handleRemap;
+    if ( denseHandles )
+    {
+        uint32_t nextHandle = 1;
+        for ( const uint32_t declared : usage.m_declaredHandles )
+        {
+            if ( usage.m_usedHandles.contains( declared ) && !handleRemap.contains( declared ) )
+                handleRemap.emplace( declared, nextHandle++ );
+        }
+        for ( const uint32_t used : usage.m_usedHandles )
+        {
+            if ( used != 0 && !handleRemap.contains( used ) )
+                handleRemap.emplace( used, nextHandle++ );
+        }
+    }
+
+    const auto remapHandle = [&]( auto& handle )
+    {
+        if ( const auto it = handleRemap.find( handle ); it != handleRemap.end() )
+            handle = it->second;
+    };
+
+    auto source = Op::FileBlockSource::open( inputFile );
+    if ( !source )
+        return false;
+
+    Op::BlockReader reader( std::move( source ) );
+    Op::EventCursor< Op::BlockReader > cursor( reader );
+
+    pvd::StreamInitialization init;
+    if ( !cursor.readInitialization( init ) )
+        return false;
+
+    physx::PxPvdTransport* outputTransport = physx::PxDefaultPvdFileTransportCreate( outputFile.c_str() );
+    if ( outputTransport == nullptr || !outputTransport->connect() )
+    {
+        spdlog::error( "unable to open [{}] for writing", outputFile );
+        return false;
+    }
+
+    uint64_t keptStrings = 0;
+    uint64_t keptDefinitions = 0;
+    {
+        physx::PxPvdTransport& transport = outputTransport->lock();
+
+        pvd::EventStreamifier< physx::PxPvdTransport > streamOut( transport );
+        init.serialize( streamOut );
+
+        Op::EventWriter eventWriter( transport );
+        PayloadHandles payloadHandles;
+
+        Op::EventView view;
+        while ( cursor.next( view ) )
+        {
+            std::visit( [&]( auto& ev )
+            {
+                using TEvent = std::decay_t< decltype( ev ) >;
+
+                if constexpr ( std::is_same_v< TEvent, std::monostate > )
+                {
+                    return;
+                }
+                else
+                {
+                    bool keep = true;
+                    if constexpr ( std::is_same_v< TEvent, pvd::StringHandleEvent > )
+                    {
+                        keep = usage.m_usedHandles.contains( ev.mHandle );
+                        keptStrings += keep ? 1 : 0;
+                    }
+                    else if constexpr ( std::is_same_v< TEvent, pvd::CreateClass > )
+                    {
+                        keep = usage.m_usedClasses.contains( classKey( ev.mName ) );
+                        keptDefinitions += keep ? 1 : 0;
+                    }
+                    else if constexpr ( std::is_same_v< TEvent, pvd::DeriveClass > )
+                    {
+                        keep = usage.m_usedClasses.contains( classKey( ev.mChild ) );
+                        keptDefinitions += keep ? 1 : 0;
+                    }
+                    else if constexpr ( std::is_same_v< TEvent, pvd::CreateProperty > || std::is_same_v< TEvent, pvd::CreatePropertyMessage > )
+                    {
+                        keep = usage.m_usedClasses.contains( classKey( ev.mClass ) );
+                        keptDefinitions += keep ? 1 : 0;
+                    }
+
+                    // handles inside payloads are still in the original numbering here, as are the declarations
+                    // that say where they are
+                    payloadHandles.visit( ev, [&]( auto& handle )
+                    {
+                        if ( denseHandles )
+                            remapHandle( handle );
+                    } );
+
+                    if ( !keep )
+                        return;
+
+                    if ( denseHandles )
+                        forEachHandle( ev, remapHandle );
+
+                    eventWriter.write( view.m_group, ev );
+                }
+            }, view.m_event );
+        }
+
+        outputTransport->unlock();
+    }
+    outputTransport->flush();
+    outputTransport->release();
+
+    if ( cursor.failed() )
+        return false;
+
+    spdlog::info( "{:>32} = {} of {} ", "string handles kept", keptStrings, usage.m_totalStrings );
+    spdlog::info( "{:>32} = {} of {} ", "definitions kept", keptDefinitions, usage.m_totalDefinitions );
+    return true;
+}
@@ -0,0 +1,18 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// rewrites a capture keeping only the string handles, class definitions and properties that are still needed by
+// what's left in it. The first pass finds the classes that are instantiated or referenced by updates, closes that set
+// over base classes and property datatypes, and collects every handle those definitions and the remaining events
+// refer to - including the string handles carried inside String-typed property values and property message fields -
+// and the second pass copies the stream, skipping everything else. With denseHandles the surviving handles are
+// renumbered from 1 in the order they were declared, in payloads as well as event headers
+//
+
+#pragma once
+
+bool pruneDefinitions( const std::string& inputFile, const std::string& outputFile, const bool denseHandles );
@@ -0,0 +1,375 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "inspect/CaptureInspector.h"
+
+#include <xmmintrin.h>
+
+#include "common/OpEventUnpacker.h"
+
+namespace
+{
+    // serialized sizes; the unpacker reads each field back to back, with no padding
+    static constexpr std::size_t cStreamInitializationSize  = 8 + 4 + 8 + 8 + 4;
+    static constexpr std::size_t cEventGroupSize            = 4 + 4 + 8 + 8;
+
+    // how far ahead of the scan the OS is asked to page the file in, and how much each request covers
+    static constexpr uint64_t cPrefetchDistance             = 256 * 1024 * 1024;
+    static constexpr uint64_t cPrefetchChunk                = 32 * 1024 * 1024;
+
+    // cache lines ahead of the current group header to pull in
+    static constexpr std::size_t cHeaderPrefetchDistance    = 512;
+
+    static constexpr std::size_t cEventTypeCount            = static_cast<std::size_t>( Op::PvdEventType::Last );
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // read-only view of a whole file
+    struct MappedFile
+    {
+        ~MappedFile()
+        {
+            if ( m_view != nullptr )
+                UnmapViewOfFile( m_view );
+            if ( m_mapping != nullptr )
+                CloseHandle( m_mapping );
+            if ( m_file != INVALID_HANDLE_VALUE )
+                CloseHandle( m_file );
+        }
+
+        bool open( const std::string& filename )
+        {
+            m_file = CreateFileA( filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+            if ( m_file == INVALID_HANDLE_VALUE )
+                return false;
+
+            LARGE_INTEGER fileSize;
+            if ( !GetFileSizeEx( m_file, &fileSize ) )
+                return false;
+            m_size = static_cast<uint64_t>( fileSize.QuadPart );
+
+            // an empty file can't be mapped, but is still a valid (if useless) input
+            if ( m_size == 0 )
+                return true;
+
+            m_mapping = CreateFileMappingA( m_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+            if ( m_mapping == nullptr )
+                return false;
+
+            m_view = static_cast<const uint8_t*>( MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 ) );
+            return ( m_view != nullptr );
+        }
+
+        // ask for the given range of the view to be paged in ahead of it being touched
+        void prefetch( const uint64_t offset, const uint64_t size ) const
+        {
+            if ( offset >= m_size )
+                return;
+
+            WIN32_MEMORY_RANGE_ENTRY range;
+            range.VirtualAddress = const_cast<uint8_t*>( m_view + offset );
+            range.NumberOfBytes  = static_cast<SIZE_T>( std::min( size, m_size - offset ) );
+            PrefetchVirtualMemory( GetCurrentProcess(), 1, &range, 0 );
+        }
+
+        HANDLE          m_file      = INVALID_HANDLE_VALUE;
+        HANDLE          m_mapping   = nullptr;
+        const uint8_t*  m_view      = nullptr;
+        uint64_t        m_size      = 0;
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    // EventUnpacker source over one event body in the mapped file; reads past the end come back zeroed
+    struct SpanReader
+    {
+        SpanReader( const uint8_t* data, const std::size_t size )
+            : m_data( data )
+            , m_size( size )
+        {}
+
+        inline uint32_t read( void* buffer, const uint32_t size )
+        {
+            const std::size_t available = std::min< std::size_t >( size, m_size - m_offset );
+            std::memcpy( buffer, m_data + m_offset, available );
+            std::memset( static_cast<uint8_t*>( buffer ) + available, 0, size - available );
+            m_offset += available;
+            return static_cast<uint32_t>( available );
+        }
+
+        const uint8_t*  m_data;
+        std::size_t     m_size;
+        std::size_t     m_offset = 0;
+    };
+
+    template< typename T >
+    inline T loadField( const uint8_t* data )
+    {
+        T value;
+        std::memcpy( &value, data, sizeof( T ) );
+        return value;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    struct TypeTally
+    {
+        uint64_t    m_groups    = 0;
+        uint64_t    m_bytes     = 0;
+        uint32_t    m_largest   = 0;
+    };
+
+    struct Inspection
+    {
+        std::array< TypeTally, cEventTypeCount >                m_types{};
+
+        uint64_t                                                m_groups            = 0;
+        uint64_t                                                m_events            = 0;
+        uint64_t                                                m_invalidGroups     = 0;
+        uint64_t                                                m_bytesWalked       = 0;
+        bool                                                    m_endOfStream       = false;
+        bool                                                    m_truncated         = false;
+
+        uint64_t                                                m_firstTimestamp    = 0;
+        uint64_t                                                m_lastTimestamp     = 0;
+
+        ankerl::unordered_dense::map< uint32_t, std::string >   m_strings;
+        ankerl::unordered_dense::map< uint32_t, uint64_t >      m_sectionCounts;    // section name handle -> sections
+        ankerl::unordered_dense::map< uint32_t, uint64_t >      m_classCreates;     // class name handle -> instances
+
+        std::string_view lookupString( const uint32_t handle ) const
+        {
+            const auto it = m_strings.find( handle );
+            return ( it != m_strings.end() ) ? std::string_view( it->second ) : std::string_view( "unknown" );
+        }
+    };
+
+    // the handful of event bodies that are decoded
+    void inspectEventBody( Inspection& inspection, const Op::PvdEventType eventType, const uint8_t* body, const std::size_t bodySize )
+    {
+        if ( eventType != Op::PvdEventType::StringHandleEvent &&
+             eventType != Op::PvdEventType::BeginSection &&
+             eventType != Op::PvdEventType::CreateInstance )
+            return;
+
+        SpanReader reader( body, bodySize );
+        Op::EventUnpacker< SpanReader > unpacker( reader );
+
+        switch ( eventType )
+        {
+            case Op::PvdEventType::StringHandleEvent:
+            {
+                pvd::StringHandleEvent event;
+                event.serialize( unpacker );
+                inspection.m_strings.insert_or_assign( event.mHandle, std::string( event.mString ) );
+                break;
+            }
+            case Op::PvdEventType::BeginSection:
+            {
+                pvd::BeginSection event;
+                event.serialize( unpacker );
+                inspection.m_sectionCounts[event.mName]++;
+                break;
+            }
+            case Op::PvdEventType::CreateInstance:
+            {
+                pvd::CreateInstance event;
+                event.serialize( unpacker );
+                inspection.m_classCreates[event.mClass.mName]++;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // walks every event group header from offset onwards
+    void walkEventGroups( Inspection& inspection, const MappedFile& mappedFile, uint64_t offset )
+    {
+        const uint8_t* view = mappedFile.m_view;
+        const uint64_t size = mappedFile.m_size;
+
+        uint64_t prefetchedTo = offset;
+
+        while ( offset + cEventGroupSize <= size )
+        {
+            // keep the OS paging in a good distance ahead, and the CPU pulling in the next few headers
+            while ( prefetchedTo < offset + cPrefetchDistance && prefetchedTo < size )
+            {
+                mappedFile.prefetch( prefetchedTo, cPrefetchChunk );
+                prefetchedTo += cPrefetchChunk;
+            }
+            _mm_prefetch( reinterpret_cast<const char*>( view + std::min( offset + cHeaderPrefetchDistance, size - 1 ) ), _MM_HINT_T0 );
+
+            const uint8_t* header     = view + offset;
+            const uint32_t dataSize   = loadField< uint32_t >( header );
+            const uint32_t numEvents  = loadField< uint32_t >( header + 4 );
+            const uint64_t timestamp  = loadField< uint64_t >( header + 16 );
+
+            // an empty group marks the end of the stream
+            if ( numEvents == 0 )
+            {
+                inspection.m_endOfStream = true;
+                offset += cEventGroupSize;
+                break;
+            }
+
+            const uint64_t bodyOffset = offset + cEventGroupSize;
+            if ( dataSize == 0 || bodyOffset + dataSize > size )
+            {
+                inspection.m_truncated = true;
+                break;
+            }
+
+            if ( inspection.m_groups == 0 )
+                inspection.m_firstTimestamp = timestamp;
+            inspection.m_lastTimestamp = timestamp;
+
+            inspection.m_groups++;
+            inspection.m_events += numEvents;
+
+            // only the first event of the group is identified; there is almost always just the one
+            const auto eventType = static_cast<Op::PvdEventType>( view[bodyOffset] );
+            if ( Op::eventTypeValid( eventType ) )
+            {
+                TypeTally& tally = inspection.m_types[static_cast<std::size_t>( eventType )];
+                tally.m_groups++;
+                tally.m_bytes  += cEventGroupSize + dataSize;
+                tally.m_largest = std::max( tally.m_largest, dataSize );
+
+                inspectEventBody( inspection, eventType, view + bodyOffset + 1, dataSize - 1 );
+            }
+            else
+            {
+                inspection.m_invalidGroups++;
+            }
+
+            offset = bodyOffset + dataSize;
+        }
+
+        inspection.m_bytesWalked = offset;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    void logInspection( const Inspection& inspection, const uint64_t fileSize, const uint32_t topClasses )
+    {
+        const auto percentOf = []( const uint64_t value, const uint64_t total )
+        {
+            return ( total > 0 ) ? ( 100.0 * static_cast<double>( value ) / static_cast<double>( total ) ) : 0.0;
+        };
+
+        // frames are the sections named "frame"
+        uint64_t frameCount = 0;
+        for ( const auto& [handle, count] : inspection.m_sectionCounts )
+        {
+            if ( inspection.lookupString( handle ) == "frame" )
+                frameCount += count;
+        }
+
+        spdlog::info( "{:>24} = {}", "event groups", inspection.m_groups );
+        spdlog::info( "{:>24} = {}", "events", inspection.m_events );
+        spdlog::info( "{:>24} = {}", "frames", frameCount );
+        spdlog::info( "{:>24} = {}", "strings", inspection.m_strings.size() );
+        spdlog::info( "{:>24} = {} .. {}", "timestamps", inspection.m_firstTimestamp, inspection.m_lastTimestamp );
+        if ( inspection.m_invalidGroups > 0 )
+            spdlog::warn( "{:>24} = {}", "unknown event groups", inspection.m_invalidGroups );
+        if ( inspection.m_truncated )
+            spdlog::warn( "stream is truncated; {} trailing bytes after the last complete event group", fileSize - inspection.m_bytesWalked );
+        else if ( !inspection.m_endOfStream )
+            spdlog::warn( "stream has no end marker" );
+
+        spdlog::info( "- - - - - - - - - - - - - - - -" );
+        spdlog::info( "{:>30} | {:>12} | {:>14} | {:>6} | {:>10}", "event type", "groups", "bytes", "bytes%", "largest" );
+        for ( std::size_t typeIndex = 0; typeIndex < cEventTypeCount; typeIndex++ )
+        {
+            const TypeTally& tally = inspection.m_types[typeIndex];
+            if ( tally.m_groups == 0 )
+                continue;
+
+            spdlog::info( "{:>30} | {:>12} | {:>14} | {:5.1f}% | {:>10}",
+                Op::eventTypeToString( static_cast<Op::PvdEventType>( typeIndex ) ),
+                tally.m_groups,
+                tally.m_bytes,
+                percentOf( tally.m_bytes, fileSize ),
+                tally.m_largest );
+        }
+
+        if ( !inspection.m_sectionCounts.empty() )
+        {
+            spdlog::info( "- - - - - - - - - - - - - - - -" );
+            spdlog::info( "sections :" );
+            for ( const auto& [handle, count] : inspection.m_sectionCounts )
+                spdlog::info( "{:>30} = {}", inspection.lookupString( handle ), count );
+        }
+
+        if ( !inspection.m_classCreates.empty() && topClasses > 0 )
+        {
+            std::vector< std::pair< uint32_t, uint64_t > > classCreates( inspection.m_classCreates.begin(), inspection.m_classCreates.end() );
+            const std::size_t classCount = std::min< std::size_t >( topClasses, classCreates.size() );
+            std::partial_sort( classCreates.begin(), classCreates.begin() + classCount, classCreates.end(),
+                []( const auto& lhs, const auto& rhs ) { return lhs.second > rhs.second; } );
+
+            spdlog::info( "- - - - - - - - - - - - - - - -" );
+            spdlog::info( "instances created ({} of {} classes) :", classCount, classCreates.size() );
+            for ( std::size_t index = 0; index < classCount; index++ )
+                spdlog::info( "{:>30} = {}", inspection.lookupString( classCreates[index].first ), classCreates[index].second );
+        }
+    }
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------------------------------------------------
+int runCaptureInspect( const std::string& pxdFile, const uint32_t topClasses )
+{
+    MappedFile mappedFile;
+    if ( !mappedFile.open( pxdFile ) )
+    {
+        spdlog::error( "unable to map [{}]", pxdFile );
+        return 1;
+    }
+
+    if ( mappedFile.m_size < cStreamInitializationSize )
+    {
+        spdlog::error( "[{}] is too small to be a PVD stream", pxdFile );
+        return 1;
+    }
+
+    const auto timeStart = std::chrono::high_resolution_clock::now();
+
+    SpanReader initReader( mappedFile.m_view, cStreamInitializationSize );
+    Op::EventUnpacker< SpanReader > initUnpacker( initReader );
+
+    pvd::StreamInitialization init;
+    init.serialize( initUnpacker );
+
+    if ( init.mStreamId != pvd::StreamInitialization::getStreamId() )
+    {
+        spdlog::error( "stream ID invalid; got {}, expected {}", init.mStreamId, pvd::StreamInitialization::getStreamId() );
+        return 1;
+    }
+
+    spdlog::info( "{:>24} = {}", "file", pxdFile );
+    spdlog::info( "{:>24} = {} bytes", "size", mappedFile.m_size );
+    spdlog::info( "{:>24} = {}{}", "stream version", init.mStreamVersion,
+        ( init.mStreamVersion != pvd::StreamInitialization::getStreamVersion() ) ? " (unsupported)" : "" );
+    spdlog::info( "{:>24} = {} / {}", "timestamp ratio", init.mTimestampNumerator, init.mTimestampDenominator );
+    spdlog::info( "{:>24} = {:#x}", "stream flags", init.mStreamFlags );
+
+    Inspection inspection;
+    walkEventGroups( inspection, mappedFile, cStreamInitializationSize );
+
+    const auto timeEnd = std::chrono::high_resolution_clock::now();
+    const double elapsedSeconds = std::chrono::duration< double >( timeEnd - timeStart ).count();
+
+    logInspection( inspection, mappedFile.m_size, topClasses );
+
+    spdlog::info( "- - - - - - - - - - - - - - - -" );
+    spdlog::info( "scanned in {:.3f}s ({:.2f} MB/s)", elapsedSeconds,
+        ( elapsedSeconds > 0.0 ) ? ( static_cast<double>( inspection.m_bytesWalked ) / ( 1024.0 * 1024.0 ) / elapsedSeconds ) : 0.0 );
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// quick triage of a capture without decoding it. The file is memory-mapped and walked one event group at a time
+// using only the group header's mDataSize and the type byte of the first event in each group (as opvd-capture does
+// while recording), which is enough for an event type histogram and size breakdown. The only bodies decoded are
+// string handles, BeginSection (to count frames and sections by name) and CreateInstance (instances per class).
+//
+// Pages are asked for well ahead of the scan so the walk runs at about the speed the file can be read
+//
+
+#pragma once
+
+int runCaptureInspect( const std::string& pxdFile, const uint32_t topClasses );
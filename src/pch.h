@@ -51,6 +51,7 @@
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <variant>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -67,6 +68,7 @@ namespace fs = std::filesystem;
 #include <spdlog/cfg/env.h>  // support for loading levels from the environment variable
 #include <spdlog/fmt/ostr.h> // support for user defined types
 #include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
 
 // physx
 #include "pvd/PxPvd.h"
@@ -0,0 +1,441 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// 
+
+#include "pch.h"
+#include "query/QueryEngine.h"
+
+#include "common/OpBlockReader.h"
+#include "common/OpEventCursor.h"
+#include "common/OpSceneState.h"
+#include "common/OpWorkerPool.h"
+
+namespace
+{
+    static constexpr uint64_t    cShardFrames       = 256;
+    static constexpr std::size_t cShardMaxRows      = 1024 * 1024;
+
+    // one projected value of one instance at the end of one frame
+    struct ProjectedRow
+    {
+        uint64_t    m_frame;
+        uint32_t    m_class;
+        float       m_value;
+    };
+
+    struct AggregateKey
+    {
+        uint64_t    m_bucket;       // frame bucket, or the frame itself for Aggregate::Frames
+        uint32_t    m_class;
+
+        bool operator==( const AggregateKey& rhs ) const
+        {
+            return m_bucket == rhs.m_bucket && m_class == rhs.m_class;
+        }
+    };
+
+    struct AggregateKeyHash
+    {
+        using is_avalanching = void;
+
+        uint64_t operator()( const AggregateKey& key ) const noexcept
+        {
+            using namespace ankerl::unordered_dense::detail;
+            return wyhash::mix( wyhash::hash( key.m_bucket ), key.m_class );
+        }
+    };
+
+    struct Aggregate
+    {
+        uint64_t    m_count = 0;
+        double      m_min   = std::numeric_limits< double >::max();
+        double      m_max   = std::numeric_limits< double >::lowest();
+        double      m_sum   = 0.0;
+
+        inline void add( const double value )
+        {
+            m_count++;
+            m_min  = std::min( m_min, value );
+            m_max  = std::max( m_max, value );
+            m_sum += value;
+        }
+
+        inline void merge( const Aggregate& other )
+        {
+            m_count += other.m_count;
+            m_min    = std::min( m_min, other.m_min );
+            m_max    = std::max( m_max, other.m_max );
+            m_sum   += other.m_sum;
+        }
+    };
+
+    using PartialAggregate = ankerl::unordered_dense::map< AggregateKey, Aggregate, AggregateKeyHash >;
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    inline bool passes( const QuerySpec& query, const double value )
+    {
+        if ( !query.m_hasPredicate )
+            return true;
+
+        switch ( query.m_compare )
+        {
+            case QuerySpec::Compare::Less:          return value <  query.m_threshold;
+            case QuerySpec::Compare::LessEqual:     return value <= query.m_threshold;
+            case QuerySpec::Compare::Greater:       return value >  query.m_threshold;
+            case QuerySpec::Compare::GreaterEqual:  return value >= query.m_threshold;
+            case QuerySpec::Compare::Equal:         return value == query.m_threshold;
+            case QuerySpec::Compare::NotEqual:      return value != query.m_threshold;
+        }
+        return false;
+    }
+
+    inline uint64_t bucketOf( const QuerySpec& query, const uint64_t frame )
+    {
+        if ( query.m_aggregate == QuerySpec::Aggregate::Frames )
+            return frame;
+
+        // frames are counted from 1
+        return ( frame - 1 ) / query.m_bucketFrames;
+    }
+
+    // runs on a worker; the shard is only read, the partial only written, by this one task
+    void aggregateShard( const QuerySpec& query, const std::vector< ProjectedRow >& rows, PartialAggregate& partial )
+    {
+        for ( const ProjectedRow& row : rows )
+        {
+            if ( passes( query, row.m_value ) )
+                partial[AggregateKey{ bucketOf( query, row.m_frame ), row.m_class }].add( row.m_value );
+        }
+    }
+
+    // read the queried number out of a raw property value; false if the value is too short to have it
+    inline bool project( const QuerySpec& query, const uint8_t* bytes, const uint32_t size, float& value )
+    {
+        const std::size_t offset = static_cast<std::size_t>( query.m_component ) * sizeof( float );
+
+        if ( query.m_length )
+        {
+            float vec[3];
+            if ( offset + sizeof( vec ) > size )
+                return false;
+
+            std::memcpy( vec, bytes + offset, sizeof( vec ) );
+            value = std::sqrt( vec[0] * vec[0] + vec[1] * vec[1] + vec[2] * vec[2] );
+            return true;
+        }
+
+        if ( offset + sizeof( float ) > size )
+            return false;
+
+        std::memcpy( &value, bytes + offset, sizeof( float ) );
+        return true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    std::string escapeJSON( const std::string& text )
+    {
+        std::string escaped;
+        escaped.reserve( text.size() );
+        for ( const char c : text )
+        {
+            // control characters aren't allowed unescaped in a JSON string
+            if ( static_cast<unsigned char>( c ) < 0x20 )
+            {
+                fmt::format_to( std::back_inserter( escaped ), "\\u{:04x}", static_cast<unsigned char>( c ) );
+                continue;
+            }
+
+            if ( c == '"' || c == '\\' )
+                escaped.push_back( '\\' );
+            escaped.push_back( c );
+        }
+        return escaped;
+    }
+
+    // JSON has no NaN or infinity; property values can hold either, so they go out as null
+    std::string numberJSON( const double value )
+    {
+        if ( !std::isfinite( value ) )
+            return "null";
+        return fmt::format( "{}", value );
+    }
+
+    const char* aggregateName( const QuerySpec::Aggregate aggregate )
+    {
+        switch ( aggregate )
+        {
+            case QuerySpec::Aggregate::Count:   return "count";
+            case QuerySpec::Aggregate::Min:     return "min";
+            case QuerySpec::Aggregate::Max:     return "max";
+            case QuerySpec::Aggregate::Sum:     return "sum";
+            case QuerySpec::Aggregate::Mean:    return "mean";
+            case QuerySpec::Aggregate::Frames:  return "frames";
+        }
+        return "";
+    }
+
+    double aggregateValue( const QuerySpec::Aggregate aggregate, const Aggregate& result )
+    {
+        switch ( aggregate )
+        {
+            case QuerySpec::Aggregate::Count:   return static_cast<double>( result.m_count );
+            case QuerySpec::Aggregate::Min:     return result.m_min;
+            case QuerySpec::Aggregate::Max:     return result.m_max;
+            case QuerySpec::Aggregate::Sum:     return result.m_sum;
+            case QuerySpec::Aggregate::Mean:    return result.m_sum / static_cast<double>( result.m_count );
+            case QuerySpec::Aggregate::Frames:  return static_cast<double>( result.m_count );
+        }
+        return 0.0;
+    }
+
+    void writeResults( FILE* output, const QuerySpec& query, const std::vector< std::string >& classNames, const PartialAggregate& merged )
+    {
+        std::vector< std::pair< AggregateKey, Aggregate > > results( merged.begin(), merged.end() );
+        std::sort( results.begin(), results.end(), [&]( const auto& lhs, const auto& rhs )
+        {
+            if ( lhs.first.m_bucket != rhs.first.m_bucket )
+                return lhs.first.m_bucket < rhs.first.m_bucket;
+            return classNames[lhs.first.m_class] < classNames[rhs.first.m_class];
+        } );
+
+        const bool bFrames = ( query.m_aggregate == QuerySpec::Aggregate::Frames );
+        const bool bJSON   = ( query.m_format == QuerySpec::Format::JSON );
+
+        if ( bJSON )
+            fputs( "[\n", output );
+        else if ( bFrames )
+            fputs( "frame,class,matches,min,max\n", output );
+        else
+            fmt::print( output, "first_frame,last_frame,class,count,{}\n", aggregateName( query.m_aggregate ) );
+
+        for ( std::size_t idx = 0; idx < results.size(); idx++ )
+        {
+            const AggregateKey& key    = results[idx].first;
+            const Aggregate&    result = results[idx].second;
+            const std::string&  name   = classNames[key.m_class];
+
+            if ( bFrames )
+            {
+                if ( bJSON )
+                    fmt::print( output, "  {{ \"frame\": {}, \"class\": \"{}\", \"matches\": {}, \"min\": {}, \"max\": {} }}", key.m_bucket, escapeJSON( name ), result.m_count, numberJSON( result.m_min ), numberJSON( result.m_max ) );
+                else
+                    fmt::print( output, "{},{},{},{},{}\n", key.m_bucket, name, result.m_count, result.m_min, result.m_max );
+            }
+            else
+            {
+                const uint64_t firstFrame = key.m_bucket * query.m_bucketFrames + 1;
+                const uint64_t lastFrame  = firstFrame + query.m_bucketFrames - 1;
+                const double   value      = aggregateValue( query.m_aggregate, result );
+
+                if ( bJSON )
+                    fmt::print( output, "  {{ \"first_frame\": {}, \"last_frame\": {}, \"class\": \"{}\", \"count\": {}, \"{}\": {} }}", firstFrame, lastFrame, escapeJSON( name ), result.m_count, aggregateName( query.m_aggregate ), numberJSON( value ) );
+                else
+                    fmt::print( output, "{},{},{},{},{}\n", firstFrame, lastFrame, name, result.m_count, value );
+            }
+
+            if ( bJSON )
+                fputs( ( idx + 1 < results.size() ) ? ",\n" : "\n", output );
+        }
+
+        if ( bJSON )
+            fputs( "]\n", output );
+    }
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool QuerySpec::parsePredicate( const std::string& text, QuerySpec& spec )
+{
+    static const std::pair< const char*, Compare > operators[] =
+    {
+        // two character operators first, so "<=" isn't read as "<" followed by "=..."
+        { "<=", Compare::LessEqual },
+        { ">=", Compare::GreaterEqual },
+        { "==", Compare::Equal },
+        { "!=", Compare::NotEqual },
+        { "<",  Compare::Less },
+        { ">",  Compare::Greater },
+    };
+
+    for ( const auto& [symbol, compare] : operators )
+    {
+        const std::size_t symbolLength = std::strlen( symbol );
+        if ( text.compare( 0, symbolLength, symbol ) != 0 )
+            continue;
+
+        const std::string number = text.substr( symbolLength );
+        char* parseEnd = nullptr;
+        const double threshold = std::strtod( number.c_str(), &parseEnd );
+        if ( number.empty() || parseEnd == nullptr || *parseEnd != '\0' )
+            return false;
+
+        spec.m_hasPredicate = true;
+        spec.m_compare      = compare;
+        spec.m_threshold    = threshold;
+        return true;
+    }
+    return false;
+}
+
+bool QuerySpec::parseAggregate( const std::string& text, Aggregate& aggregate )
+{
+    for ( const Aggregate candidate : { Aggregate::Count, Aggregate::Min, Aggregate::Max, Aggregate::Sum, Aggregate::Mean, Aggregate::Frames } )
+    {
+        if ( text == aggregateName( candidate ) )
+        {
+            aggregate = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+int runQuery( const std::string& pxdFile, const QuerySpec& query, const std::string& outputFile, const uint32_t threadCount )
+{
+    auto source = Op::FileBlockSource::open( pxdFile );
+    if ( !source )
+    {
+        spdlog::error( "unable to open [{}]", pxdFile );
+        return 1;
+    }
+
+    Op::BlockReader reader( std::move( source ) );
+    Op::EventCursor< Op::BlockReader > cursor( reader );
+
+    physx::pvdsdk::StreamInitialization init;
+    if ( !cursor.readInitialization( init ) )
+        return 1;
+
+    Op::WorkerPool workers( threadCount );
+    spdlog::info( "Querying [{}] on {} worker threads", pxdFile, workers.threadCount() );
+
+    const ankerl::unordered_dense::set< std::string > classFilter( query.m_classes.begin(), query.m_classes.end() );
+
+    // class names are only touched on this thread; rows carry an index into here
+    std::vector< std::string > classNames;
+    ankerl::unordered_dense::map< uint64_t, uint32_t > classIndices;   // SceneTable class key -> classNames
+
+    // partials live in a deque so the ones already handed to a worker don't move as more are added
+    std::deque< PartialAggregate >  partials;
+    std::deque< std::future< void > > inFlight;
+    const std::size_t maxInFlight = static_cast<std::size_t>( workers.threadCount() ) * 2;
+
+    auto shard = std::make_shared< std::vector< ProjectedRow > >();
+    uint64_t shardFirstFrame = 0;
+
+    const auto submitShard = [&]()
+    {
+        if ( shard->empty() )
+            return;
+
+        // bound how much projected data is queued up ahead of the workers
+        while ( inFlight.size() >= maxInFlight )
+        {
+            inFlight.front().get();
+            inFlight.pop_front();
+        }
+
+        PartialAggregate& partial = partials.emplace_back();
+        inFlight.push_back( workers.submit( [&query, &partial, rows = std::move( shard )]()
+        {
+            aggregateShard( query, *rows, partial );
+        } ) );
+
+        shard = std::make_shared< std::vector< ProjectedRow > >();
+    };
+
+    Op::SceneState scene;
+
+    const auto projectFrame = [&]( const uint64_t frame )
+    {
+        uint32_t propertyHandle = 0;
+        if ( frame == 0 || !scene.findHandle( query.m_property, propertyHandle ) )
+            return;
+
+        if ( frame - shardFirstFrame >= cShardFrames || shard->size() >= cShardMaxRows )
+        {
+            submitShard();
+            shardFirstFrame = frame;
+        }
+
+        scene.forEachTable( [&]( const Op::SceneTable& table )
+        {
+            if ( !classFilter.empty() && !classFilter.contains( table.className() ) )
+                return;
+
+            const Op::SceneColumn* column = table.column( propertyHandle );
+            if ( column == nullptr )
+                return;
+
+            auto [classIt, bNewClass] = classIndices.try_emplace( table.classKey(), static_cast<uint32_t>( classNames.size() ) );
+            if ( bNewClass )
+                classNames.push_back( table.className() );
+            const uint32_t classIndex = classIt->second;
+
+            table.forEachLive( [&]( const uint32_t slot, const uint64_t )
+            {
+                uint32_t size = 0;
+                const uint8_t* bytes = column->valueBytes( slot, size );
+
+                float value;
+                if ( bytes != nullptr && project( query, bytes, size, value ) )
+                    shard->push_back( { frame, classIndex, value } );
+            } );
+        } );
+    };
+
+    // the scene as it stands when the next frame section opens is the end state of the previous frame
+    uint64_t frame = 0;
+
+    Op::EventView view;
+    while ( cursor.next( view ) )
+    {
+        std::visit( [&]( const auto& _event ) { scene.apply( _event ); }, view.m_event );
+
+        if ( scene.currentFrame() != frame )
+        {
+            projectFrame( frame );
+            frame = scene.currentFrame();
+        }
+    }
+    projectFrame( frame );
+    submitShard();
+
+    for ( auto& task : inFlight )
+        task.get();
+
+    if ( cursor.failed() )
+        spdlog::warn( "stream could not be fully decoded, results cover the first {} frames", frame );
+
+    PartialAggregate merged;
+    for ( const PartialAggregate& partial : partials )
+    {
+        for ( const auto& [key, aggregate] : partial )
+            merged[key].merge( aggregate );
+    }
+
+    spdlog::info( "{} frames, {} shards, {} result rows", frame, partials.size(), merged.size() );
+
+    FILE* output = stdout;
+    if ( !outputFile.empty() )
+    {
+        output = fopen( outputFile.c_str(), "w" );
+        if ( output == nullptr )
+        {
+            spdlog::error( "unable to write results to [{}]", outputFile );
+            return 1;
+        }
+    }
+
+    writeResults( output, query, classNames, merged );
+
+    if ( output != stdout )
+        fclose( output );
+    return 0;
+}
@@ -0,0 +1,69 @@
+//
+//   ____                ___ _   _____ 
+//  / __ \___  ___ ___  / _ \ | / / _ \
+// / /_/ / _ \/ -_) _ \/ ___/ |/ / // /
+// \____/ .__/\__/_//_/_/   |___/____/ 
+//     /_/  https://github.com/ishani/OpenPVD
+// 
+// filter / projection / aggregate queries over a capture. The stream can only be decoded front to back, so the
+// decoding thread rebuilds the scene with Op::SceneState and, at the end of every frame, projects the queried
+// property of each live instance down to a single number; those rows are batched into frame-range shards which
+// worker threads filter and fold into partial aggregates keyed by ( frame bucket, class ). The partials are merged
+// once the stream is done, so buckets split across shards come out whole. Decoding and projection stay serial - each
+// frame's scene depends on all of the stream before it - so the workers only take filtering and aggregation off the
+// decoding thread
+//
+
+#pragma once
+
+struct QuerySpec
+{
+    enum class Aggregate
+    {
+        Count,
+        Min,
+        Max,
+        Sum,
+        Mean,
+        Frames,         // list the individual frames with matching instances
+    };
+
+    enum class Compare
+    {
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual,
+    };
+
+    enum class Format
+    {
+        CSV,
+        JSON,
+    };
+
+    std::vector< std::string >  m_classes;                  // empty to include every class that has the property
+    std::string                 m_property;
+
+    // the property value is read as an array of floats; either one component of it, or the length of the 3-vector
+    // starting at that component (eg. component 5 of a PxTransform is position.y)
+    uint32_t                    m_component     = 0;
+    bool                        m_length        = false;
+
+    bool                        m_hasPredicate  = false;
+    Compare                     m_compare       = Compare::Less;
+    double                      m_threshold     = 0.0;
+
+    Aggregate                   m_aggregate     = Aggregate::Max;
+    uint32_t                    m_bucketFrames  = 1;
+    Format                      m_format        = Format::CSV;
+
+    // "<-1000", ">=0.5", "!=0" etc.
+    static bool parsePredicate( const std::string& text, QuerySpec& spec );
+    static bool parseAggregate( const std::string& text, Aggregate& aggregate );
+};
+
+// run the query over a capture file, writing the results to outputFile (or stdout if empty)
+int runQuery( const std::string& pxdFile, const QuerySpec& query, const std::string& outputFile, const uint32_t threadCount );